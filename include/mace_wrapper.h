@@ -1,6 +1,12 @@
 #ifndef MACE_WRAPPER_H
 #define MACE_WRAPPER_H
 
+#include <stddef.h>
+
+#ifdef MACE_WITH_MPI
+#include <mpi.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -30,6 +36,24 @@ MACEHandle mace_init(const char* model_path,
                      const char* device,
                      int enable_cueq);
 
+/**
+ * Initialize MACE calculator with a chosen inference precision
+ * @param precision: "float32", "float64", "bfloat16" or "int8" (NULL for
+ *                   float32). "bfloat16" runs the interaction and product
+ *                   blocks under bf16 autocast (AMX/AVX512-BF16 through oneDNN
+ *                   on CPU) while energies and position gradients stay
+ *                   float32. "int8" (CPU only) dynamically quantizes the
+ *                   linear and readout layers for screening runs. "auto"
+ *                   starts in float32 and switches adaptively, see
+ *                   mace_set_precision
+ * @return: Handle to MACE calculator, NULL on failure
+ */
+MACEHandle mace_init_with_precision(const char* model_path,
+                                    const char* model_type,
+                                    const char* device,
+                                    int enable_cueq,
+                                    const char* precision);
+
 /**
  * Calculate energy and forces for atomic configuration
  * @param handle: MACE calculator handle
@@ -57,6 +81,260 @@ void mace_calculate_periodic(MACEHandle handle,
                              const int* pbc,
                              MACEResult* result);
 
+/**
+ * Energy and forces together with per-atom energies and per-atom virials
+ * from the same evaluation (one forward and one backward pass).
+ * Per-atom energies are the model's node energies; they sum to the total.
+ * Per-atom virials split each edge's -r_ij (x) dE/dr_ij evenly between
+ * atoms i and j. They sum to the total virial, which equals
+ * -stress * volume for periodic cells. Suitable for heat-flux
+ * calculations.
+ * @param cell: 3x3 cell matrix, or NULL for a non-periodic system
+ * @param pbc: Periodic boundary [x, y, z], required with cell
+ * @param energy: Output total energy in eV
+ * @param forces: Output forces [num_atoms*3] in eV/Å (caller allocates)
+ * @param atom_energies: Output [num_atoms] in eV (may be NULL)
+ * @param atom_virials: Output [num_atoms*9] in eV, row-major 3x3 per atom
+ *                      (may be NULL; the extra gradient is skipped)
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_calculate_atomic(MACEHandle handle,
+                          const double* positions,
+                          const int* atomic_numbers,
+                          int num_atoms,
+                          const double* cell,
+                          const int* pbc,
+                          double* energy,
+                          double* forces,
+                          double* atom_energies,
+                          double* atom_virials);
+
+/**
+ * Forces on a subset of atoms only, e.g. the QM/MM boundary or an adsorbate
+ * on a large slab. The model runs on the atoms within twice the receptive
+ * field (num_interactions x r_max) of the subset, periodic images
+ * included, instead of the whole system. The forces are exact. Falls back
+ * to a full evaluation when that region is not smaller than the system.
+ * No total energy is produced.
+ * @param cell: 3x3 cell matrix, or NULL for a non-periodic system
+ * @param pbc: Periodic boundary [x, y, z], required with cell
+ * @param subset: Indices of the atoms whose forces are needed [num_subset]
+ * @param forces: Output [num_subset*3] in eV/Å, in subset order
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_calculate_subset_forces(MACEHandle handle,
+                                 const double* positions,
+                                 const int* atomic_numbers,
+                                 int num_atoms,
+                                 const double* cell,
+                                 const int* pbc,
+                                 const int* subset,
+                                 int num_subset,
+                                 double* forces);
+
+/**
+ * Full Hessian d2E/dx_i dx_j for vibrational analysis of small systems.
+ * Computed in float64 by double backward through one model evaluation.
+ * Rows are taken in batches, about 3N/32 extra backward passes, instead
+ * of 6N finite-difference calculations. "bfloat16" and "int8" handles
+ * load the unconverted model in float64 on first use and keep it.
+ * @param cell: 3x3 cell matrix, or NULL for a non-periodic system
+ * @param pbc: Periodic boundary [x, y, z], required with cell
+ * @param forces: Output forces [num_atoms*3] in eV/Å (may be NULL)
+ * @param hessian: Output [(3*num_atoms)^2] in eV/Å², row-major and
+ *                 symmetrized (caller allocates)
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_calculate_hessian(MACEHandle handle,
+                           const double* positions,
+                           const int* atomic_numbers,
+                           int num_atoms,
+                           const double* cell,
+                           const int* pbc,
+                           double* forces,
+                           double* hessian);
+
+/**
+ * Hessian-vector products H v without forming H, for dimer and other
+ * curvature-based methods on large systems. Costs one model evaluation
+ * plus one double backward per vector.
+ * @param vectors: Input [num_vectors * num_atoms * 3]
+ * @param forces: Output forces [num_atoms*3] in eV/Å (may be NULL)
+ * @param products: Output [num_vectors * num_atoms * 3] in eV/Å²
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_hessian_vector_product(MACEHandle handle,
+                                const double* positions,
+                                const int* atomic_numbers,
+                                int num_atoms,
+                                const double* cell,
+                                const int* pbc,
+                                const double* vectors,
+                                int num_vectors,
+                                double* forces,
+                                double* products);
+
+/**
+ * Single-precision mace_calculate: float32 positions in, float32 forces out.
+ * Half the bytes of the double API and no per-atom conversion in the wrapper.
+ * On a float32 model the positions stay float32 up to the model's input
+ * tensor (only the neighbor search uses a double copy) and the forces come
+ * back in float32; on a float64 model they are widened once. Bypasses the
+ * result cache and atom reordering, which work on double coordinates.
+ * @param positions: Atomic positions [num_atoms*3] in Angstroms
+ * @param energy: Output total energy in eV (kept in double)
+ * @param forces: Output forces [num_atoms*3] in eV/Å (caller allocates)
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_calculate_f32(MACEHandle handle,
+                       const float* positions,
+                       const int* atomic_numbers,
+                       int num_atoms,
+                       double* energy,
+                       float* forces);
+
+/* Single-precision mace_calculate_periodic, see mace_calculate_f32 */
+int mace_calculate_periodic_f32(MACEHandle handle,
+                                const float* positions,
+                                const int* atomic_numbers,
+                                int num_atoms,
+                                const float* cell,
+                                const int* pbc,
+                                double* energy,
+                                float* forces);
+
+/**
+ * mace_calculate with structure-of-arrays layout: positions and forces as
+ * separate component arrays. The components are passed to the model as
+ * one numpy.stack of zero-copy views (no per-atom Python lists); forces
+ * are transposed back with SIMD shuffles. With the result cache on (see
+ * mace_set_result_cache) lookups behave as for mace_calculate. Atom
+ * reordering (mace_set_reordering) does not apply: the zero-copy views
+ * pass atoms to the model in the caller's order.
+ * @param x, y, z: Position components [num_atoms] in Angstroms
+ * @param energy: Output total energy in eV
+ * @param fx, fy, fz: Output force components [num_atoms] in eV/Å
+ *                    (caller allocates)
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_calculate_soa(MACEHandle handle,
+                       const double* x,
+                       const double* y,
+                       const double* z,
+                       const int* atomic_numbers,
+                       int num_atoms,
+                       double* energy,
+                       double* fx,
+                       double* fy,
+                       double* fz);
+
+/* mace_calculate_periodic with structure-of-arrays layout, see mace_calculate_soa */
+int mace_calculate_periodic_soa(MACEHandle handle,
+                                const double* x,
+                                const double* y,
+                                const double* z,
+                                const int* atomic_numbers,
+                                int num_atoms,
+                                const double* cell,
+                                const int* pbc,
+                                double* energy,
+                                double* fx,
+                                double* fy,
+                                double* fz);
+
+/**
+ * Width of the ghost shell for mace_calculate_local: num_interactions x
+ * r_max of the model, in Angstroms. -1 on failure.
+ */
+double mace_get_ghost_cutoff(MACEHandle handle);
+
+/**
+ * Evaluate one domain of a decomposed system: local atoms followed by
+ * ghost atoms (copies of atoms owned elsewhere, or periodic images) that
+ * cover mace_get_ghost_cutoff() around every local atom. The domain is
+ * treated as non-periodic; periodicity enters through the ghosts.
+ * @param positions: [(num_local + num_ghost) * 3], locals first
+ * @param energy: Output energy of the local atoms in eV; summed over all
+ *                domains it gives the total energy
+ * @param forces: Output [(num_local + num_ghost) * 3] in eV/Å. Ghost rows
+ *                are contributions to the atoms they are copies of and must
+ *                be added to those (reverse communication, as with LAMMPS
+ *                newton on); mace_calculate_mpi does this over MPI
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_calculate_local(MACEHandle handle,
+                         int num_local,
+                         int num_ghost,
+                         const int* atomic_numbers,
+                         const double* positions,
+                         double* energy,
+                         double* forces);
+
+/* Radial cutoff r_max of the model in Angstroms, -1 on failure */
+double mace_get_cutoff(MACEHandle handle);
+
+/**
+ * mace_calculate_local with a caller-supplied neighbor graph, for MD codes
+ * that own the neighbor list (see lammps/pair_mace.cpp). Species and edges
+ * are kept resident in the library and only re-read when topology_changed
+ * is set, e.g. after reneighboring; other steps pass positions only.
+ * @param atomic_numbers: [num_local + num_ghost], read when topology_changed
+ * @param num_edges: Number of directed edges; every pair within r_max must
+ *                   appear in both directions. Pairs out to r_max + skin may
+ *                   be included (their contribution is exactly zero)
+ * @param edge_index: [2 * num_edges], senders then receivers, indexing
+ *                    locals and ghosts; read when topology_changed
+ * @param topology_changed: 1 on the first call and whenever atoms, species
+ *                          or edges changed, 0 to reuse the previous graph
+ * @param energy: Output energy of the local atoms in eV
+ * @param node_energies: Output per-atom energies of the local atoms
+ *                       [num_local] in eV (may be NULL)
+ * @param forces: Output [(num_local + num_ghost) * 3] in eV/Å; ghost rows
+ *                belong to the atoms the ghosts are copies of
+ * @param virials: Output per-atom virials of the local energy
+ *                 [(num_local + num_ghost) * 9] in eV, row-major 3x3, split
+ *                 per edge as in mace_calculate_atomic; ghost rows belong to
+ *                 the atoms the ghosts are copies of (may be NULL)
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_calculate_local_graph(MACEHandle handle,
+                               int num_local,
+                               int num_ghost,
+                               const int* atomic_numbers,
+                               const double* positions,
+                               int num_edges,
+                               const int* edge_index,
+                               int topology_changed,
+                               double* energy,
+                               double* node_energies,
+                               double* forces,
+                               double* virials);
+
+#ifdef MACE_WITH_MPI
+/**
+ * mace_calculate_local on every rank of comm plus the reverse exchange of
+ * ghost forces and the energy sum (library built with MPI=1). Collective:
+ * all ranks must call it, including ranks without atoms.
+ * @param ghost_rank: Owner rank of each ghost [num_ghost]
+ * @param ghost_index: Index of each ghost's atom among its owner's local
+ *                     atoms [num_ghost]
+ * @param energy: Output total energy over all ranks in eV
+ * @param forces: Output forces on the local atoms [num_local * 3] in eV/Å;
+ *                may be NULL only on ranks without local atoms
+ * @return: 1 on success, 0 on all ranks if any rank failed
+ */
+int mace_calculate_mpi(MACEHandle handle,
+                       MPI_Comm comm,
+                       int num_local,
+                       int num_ghost,
+                       const int* atomic_numbers,
+                       const double* positions,
+                       const int* ghost_rank,
+                       const int* ghost_index,
+                       double* energy,
+                       double* forces);
+#endif
+
 /* Free forces array */
 void mace_free_forces(double* forces);
 
@@ -69,6 +347,457 @@ void mace_destroy(MACEHandle handle);
 /* Get error message */
 const char* mace_get_error(MACEHandle handle);
 
+/**
+ * Compute MACE edge features with the library's native SIMD kernels
+ * @param vectors: Edge vectors [x0,y0,z0,x1,...] in Angstroms
+ * @param num_edges: Number of edges
+ * @param lmax: Maximum spherical harmonic degree (0..3)
+ * @param r_max: Radial cutoff in Angstroms
+ * @param num_bessel: Number of Bessel basis functions
+ * @param cutoff_p: Order of the polynomial cutoff envelope
+ * @param sh: Output [num_edges, (lmax+1)^2] component-normalized spherical
+ *            harmonics in e3nn ordering (NULL to skip)
+ * @param sh_grad: Output [num_edges, (lmax+1)^2, 3] derivatives w.r.t. the
+ *                 edge vector (NULL to skip)
+ * @param radial: Output [num_edges, num_bessel] Bessel basis times cutoff
+ *                envelope (NULL to skip)
+ * @param radial_grad: Output [num_edges, num_bessel] derivatives w.r.t. the
+ *                     edge length (NULL to skip)
+ * @return: 1 on success, 0 on invalid arguments
+ */
+int mace_edge_features(const double* vectors,
+                       int num_edges,
+                       int lmax,
+                       double r_max,
+                       int num_bessel,
+                       int cutoff_p,
+                       double* sh,
+                       double* sh_grad,
+                       double* radial,
+                       double* radial_grad);
+
+/**
+ * Evaluate the model's spherical harmonics and radial basis with the
+ * native kernels instead of torch ops (CPU tensors only)
+ * @param enable: 1 to use native kernels, 0 to restore the torch modules
+ * @return: 1 if native edge featurization is active, 0 otherwise
+ */
+int mace_set_native_features(MACEHandle handle, int enable);
+
+/**
+ * Select the precision of subsequent calculations on this handle
+ * @param precision: "float32", "float64", or "auto". "auto" evaluates in
+ *                   float32 and uses float64 while the largest atomic force of
+ *                   the previous call is below the adaptive threshold (back to
+ *                   float32 above twice the threshold). The float64 model is
+ *                   converted from the loaded one, not reloaded. A float32
+ *                   handle casts its weights in place (float32 values
+ *                   round-trip exactly), so only one copy is resident. A
+ *                   float64 handle keeps its weights and holds an extra
+ *                   float32 copy (half its size) only while float32 is in
+ *                   use. Handles created as "bfloat16" or "int8" cannot
+ *                   switch.
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_set_precision(MACEHandle handle, const char* precision);
+
+/**
+ * Set the force threshold for "auto" precision
+ * @param fmax: Largest atomic force norm in eV/Å (default 0.05)
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_set_adaptive_threshold(MACEHandle handle, double fmax);
+
+/* Precision used by the last calculation ("float32", "float64", ...) */
+const char* mace_get_active_precision(MACEHandle handle);
+
+/* Atomic system owned by the caller; arrays are updated in place */
+typedef struct {
+    int num_atoms;                  /* Number of atoms */
+    const int* atomic_numbers;      /* [Z0,Z1,...] */
+    double* positions;              /* [x0,y0,z0,x1,...] Å */
+    double* velocities;             /* [vx0,vy0,vz0,...] Å/fs, NULL to draw
+                                       Maxwell-Boltzmann velocities */
+    double* forces;                 /* Output forces eV/Å, may be NULL */
+    double cell[9];                 /* [a_x,a_y,a_z,b_x,...,c_z] */
+    int pbc[3];                     /* Periodic boundary [x, y, z] */
+    double energy;                  /* Output potential energy in eV */
+} MACESystem;
+
+/* Molecular dynamics settings */
+typedef struct {
+    const char* integrator;         /* "verlet", "langevin", or "nose-hoover" */
+    double timestep;                /* fs */
+    double temperature;             /* K, thermostat target and initial velocities */
+    double friction;                /* Langevin friction in 1/fs */
+    double thermostat_time;         /* Nosé–Hoover damping time in fs (0 = 100 steps) */
+    int seed;                       /* Seed for initial velocities and Langevin
+                                       noise; equal seeds give equal trajectories */
+} MACEMDParams;
+
+/* Frame callback; the system holds the current frame. Return nonzero to stop. */
+typedef int (*MACEMDCallback)(int step, const MACESystem* system, void* user_data);
+
+/**
+ * Run molecular dynamics inside the library. Positions, velocities and
+ * forces stay on the model side and the neighbor list is reused between
+ * steps; the caller only sees frames at the requested stride.
+ * @param system: Initial state; receives the final state
+ * @param n_steps: Number of integration steps
+ * @param params: Integrator settings
+ * @param callback: Called at step 0 and every `stride` steps (NULL for none)
+ * @param stride: Callback interval in steps
+ * @param user_data: Passed through to the callback
+ * @return: Number of steps taken, -1 on failure (see mace_get_error)
+ */
+int mace_run_md(MACEHandle handle,
+                MACESystem* system,
+                int n_steps,
+                const MACEMDParams* params,
+                MACEMDCallback callback,
+                int stride,
+                void* user_data);
+
+/* Multiple time stepping settings */
+typedef struct {
+    int respa_steps;                /* Fast steps per MACE evaluation */
+    MACEHandle inner;               /* Smaller MACE model for the fast force, or
+                                       NULL for a native pair potential fitted
+                                       to MACE forces at the start */
+    double inner_cutoff;            /* Pair potential cutoff in Å (0 = min(4, r_max)) */
+    int fit_frames;                 /* Rattled frames for the pair fit (0 = 4) */
+} MACERESPAParams;
+
+/**
+ * Run multiple time stepping (impulse r-RESPA) MD inside the library. Each
+ * outer step evaluates MACE once and takes respa_steps steps of
+ * params->timestep on the cheap inner force; the MACE minus inner force is
+ * applied as an impulse, so MACE is evaluated respa_steps times less often
+ * than with mace_run_md at the same inner timestep.
+ * @param system: Initial state; receives the final state
+ * @param n_steps: Number of outer (MACE) steps
+ * @param params: Inner timestep and thermostat ("verlet" or "langevin")
+ * @param respa: Multiple time stepping settings
+ * @param callback: Called at step 0 and every `stride` outer steps with
+ *                  MACE forces and energy (NULL for none)
+ * @return: Number of outer steps taken, -1 on failure (see mace_get_error)
+ */
+int mace_run_respa(MACEHandle handle,
+                   MACESystem* system,
+                   int n_steps,
+                   const MACEMDParams* params,
+                   const MACERESPAParams* respa,
+                   MACEMDCallback callback,
+                   int stride,
+                   void* user_data);
+
+/**
+ * Relax a structure inside the library with persistent optimizer state and
+ * neighbor-list reuse
+ * @param system: Initial structure; receives the final positions, cell,
+ *                forces and energy (velocities are ignored). The cell of a
+ *                non-periodic system is left as it was
+ * @param method: "fire" or "lbfgs"
+ * @param fmax: Convergence threshold on the largest force in eV/Å (and on
+ *              stress in eV/Å^3 when relaxing the cell)
+ * @param max_steps: Maximum optimizer steps
+ * @param relax_cell: 1 to relax the cell too (fully periodic systems only)
+ * @param converged: Set to 1 if fmax was reached, 0 otherwise (may be NULL)
+ * @return: Number of optimizer steps, -1 on failure (see mace_get_error)
+ */
+int mace_relax(MACEHandle handle,
+               MACESystem* system,
+               const char* method,
+               double fmax,
+               int max_steps,
+               int relax_cell,
+               int* converged);
+
+/**
+ * Pass atoms to the model in space-filling-curve order so that neighbor
+ * gathers and scatters in message passing stay cache-local. Applies to
+ * mace_calculate and mace_calculate_periodic; inputs and forces keep the
+ * caller's order. The permutation is kept between calls and recomputed
+ * every resort_interval calls or when the atom count or species change.
+ * @param curve: "hilbert", "morton", or "none" (NULL) to disable
+ * @param resort_interval: Calls between re-sorts (<= 0 for 100)
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_set_reordering(MACEHandle handle, const char* curve, int resort_interval);
+
+/**
+ * Enable the per-handle result cache for mace_calculate and
+ * mace_calculate_periodic. Bit-identical configurations (positions,
+ * atomic numbers, cell, pbc) are answered from memory without entering
+ * Python; least recently used entries are evicted beyond max_bytes.
+ * Changing precision or feature settings clears the cache.
+ * @param max_bytes: Memory cap in bytes, 0 disables and frees the cache
+ * @return: 1 on success, 0 on failure
+ */
+int mace_set_result_cache(MACEHandle handle, size_t max_bytes);
+
+/**
+ * Bound the memory of mace_calculate and mace_calculate_periodic. Systems
+ * whose estimated graph exceeds max_bytes are cut into spatial blocks;
+ * each block is evaluated with a halo of num_interactions * r_max and only
+ * its core atoms' energies are kept, while force contributions on halo
+ * atoms are added to their owners. The stitched energy and forces match a
+ * single evaluation to floating-point noise. The block size is the largest
+ * whose estimated peak memory fits max_bytes.
+ * @param max_bytes: Peak memory budget in bytes, 0 to evaluate in one graph
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_set_memory_budget(MACEHandle handle, size_t max_bytes);
+
+/**
+ * Evaluate large systems in mace_calculate and mace_calculate_periodic as
+ * spatial domains with halos, num_workers of them concurrently on threads
+ * that share the model. Systems too small for domains to pay off are
+ * evaluated in one piece. Forces are reduced into the caller's array in a
+ * fixed order, so results do not depend on scheduling. Combined with
+ * mace_set_memory_budget, each worker gets an equal share of the budget.
+ * @param num_workers: Concurrent domains, <= 1 disables
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_set_domain_decomposition(MACEHandle handle, int num_workers);
+
+/* Result cache counters */
+typedef struct {
+    long long hits;                 /* Calculations served from the cache */
+    long long misses;               /* Lookups that ran the model */
+    long long evictions;            /* Entries dropped for the memory cap */
+    long long entries;              /* Entries currently stored */
+    size_t bytes;                   /* Approximate memory in use */
+} MACECacheStats;
+
+/* Fill stats; 1 on success, 0 on failure */
+int mace_get_cache_stats(MACEHandle handle, MACECacheStats* stats);
+
+/* Drop all cached results (counters are kept) */
+void mace_clear_result_cache(MACEHandle handle);
+
+/**
+ * Let mace_run_md and mace_relax skip model calls by extrapolating energy
+ * and forces from the last evaluations (polynomial in the cumulative path
+ * length of the coordinates, so uneven steps are handled). The model is
+ * called when the estimated force error exceeds force_tol, when an atom
+ * moved more than max_displacement since the last call, or after max_skip
+ * consecutive predictions (a check whose error is recorded). Relaxations
+ * use it with FIRE only (LBFGS keeps model forces for its curvature
+ * history) and confirm convergence with model forces.
+ * @param force_tol: Largest estimated atomic force error in eV/Å, <= 0 disables
+ * @param max_displacement: Largest atomic displacement in Å between model calls
+ * @param max_skip: Predictions before a forced model call
+ * @param order: Extrapolation order (2 = quadratic through 3 evaluations)
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_set_force_extrapolation(MACEHandle handle,
+                                 double force_tol,
+                                 double max_displacement,
+                                 int max_skip,
+                                 int order);
+
+/* Force extrapolation counters since it was last configured */
+typedef struct {
+    int evaluations;                /* Model calls */
+    int skipped;                    /* Steps served by extrapolation */
+    double skip_ratio;              /* skipped / (evaluations + skipped) */
+    int checks;                     /* Forced calls compared with a prediction */
+    double max_error;               /* Largest atomic force error on checks, eV/Å */
+    double rms_error;               /* RMS over checks of that error, eV/Å */
+} MACEExtrapolationStats;
+
+/* Fill stats; 1 on success, 0 on failure */
+int mace_get_extrapolation_stats(MACEHandle handle, MACEExtrapolationStats* stats);
+
+/**
+ * Register a system with fixed atoms on the handle (replaces any previous
+ * one). Edges among frozen atoms are cached and, when the receptive field
+ * (num_interactions x r_max) is small against the frozen region, only the
+ * mobile atoms and a buffer around them are evaluated; frozen-atom energy
+ * and force contributions that cannot change are reused.
+ * @param system: Species, initial positions, cell and pbc (velocities,
+ *                forces and energy are ignored)
+ * @param frozen: Per-atom mask [num_atoms], 1 = fixed in place
+ * @param skip_frozen_forces: 1 to return zero forces on frozen atoms and
+ *                            skip their gradients
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_register_system(MACEHandle handle,
+                         const MACESystem* system,
+                         const int* frozen,
+                         int skip_frozen_forces);
+
+/**
+ * Calculate the registered system at new positions
+ * @param positions: All atomic positions [num_atoms*3] in Å; frozen atoms
+ *                   keep their registered positions
+ * @param result: Output result structure, free with mace_free_result
+ */
+void mace_calculate_registered(MACEHandle handle,
+                               const double* positions,
+                               MACEResult* result);
+
+/* Nudged elastic band settings (0 selects the default) */
+typedef struct {
+    double spring;                  /* Spring constant in eV/Å^2 (0.1) */
+    int climb;                      /* 1 for a climbing image on the highest image */
+    double fmax;                    /* Convergence on the largest NEB force in eV/Å (0.05) */
+    int max_steps;                  /* Maximum FIRE steps (500) */
+    double max_step;                /* Largest band displacement per step in Å (0.2) */
+} MACENEBOptions;
+
+/**
+ * Optimize a nudged elastic band inside the library. Every iteration
+ * evaluates all movable images as one batched graph; improved-tangent
+ * spring and climbing-image projections and the FIRE update run in C++.
+ * @param images: Band including both end points (fixed). Species, cell and
+ *                pbc are taken from images[0]; positions must be continuous
+ *                between neighbouring images. Receives the optimized band,
+ *                model energies and (where non-NULL) model forces
+ * @param n_images: Number of images including end points (>= 3)
+ * @param barrier: Output highest image energy minus the first image energy
+ *                 in eV (may be NULL)
+ * @param converged: Set to 1 if fmax was reached, 0 otherwise (may be NULL)
+ * @return: Number of FIRE steps, -1 on failure (see mace_get_error)
+ */
+int mace_neb(MACEHandle handle,
+             MACESystem* images,
+             int n_images,
+             const MACENEBOptions* options,
+             double* barrier,
+             int* converged);
+
+/* Finite-displacement phonon settings (0 selects the default) */
+typedef struct {
+    double displacement;            /* Atomic displacement in Å (0.01) */
+    double symprec;                 /* Symmetry tolerance in Å (1e-5) */
+    int max_batch_atoms;            /* Atoms per batched model pass (20000) */
+} MACEPhononOptions;
+
+/**
+ * Force constants of a periodic supercell by finite displacements, in one
+ * call. As in phonopy, only one atom per symmetry orbit is displaced, and
+ * only along directions its site symmetry does not relate (x, y, z until
+ * their images span space; -d only when no site operation maps d onto
+ * it), so a conventional fcc cell needs one displaced supercell. The
+ * displaced supercells are evaluated as batched graphs; the missing rows
+ * are rebuilt from the site-symmetry and space-group operations. Symmetry
+ * reduction needs the spglib Python package; without it every atom is
+ * displaced along +-x, +-y and +-z. Use float64 precision for production
+ * phonons.
+ * @param supercell: Periodic supercell (velocities/forces are ignored)
+ * @param options: Settings, NULL for defaults
+ * @param force_constants: Output [(3*num_atoms)^2] in eV/Å², row-major
+ *                         with the same layout as mace_calculate_hessian
+ * @param num_displacements: Output number of displaced supercells
+ *                           evaluated (may be NULL)
+ * @return: 1 on success, 0 on failure (see mace_get_error)
+ */
+int mace_phonon_force_constants(MACEHandle handle,
+                                const MACESystem* supercell,
+                                const MACEPhononOptions* options,
+                                double* force_constants,
+                                int* num_displacements);
+
+/* Opaque Monte Carlo state bound to a calculator handle */
+typedef void* MACEMCHandle;
+
+/**
+ * Create a Monte Carlo state that caches per-atom energies of a system.
+ * Trial moves recompute only atoms within the model's receptive field
+ * (num_interactions x r_max) of the moved atoms, so a move costs the same
+ * regardless of system size. Destroy before the calculator handle.
+ * @param system: Initial configuration (velocities/forces are ignored)
+ * @return: MC handle, NULL on failure (see mace_get_error)
+ */
+MACEMCHandle mace_mc_create(MACEHandle handle, const MACESystem* system);
+
+/**
+ * Propose a trial move; any previous unresolved proposal is rejected
+ * @param num_moved: Number of atoms changed by the move
+ * @param indices: Indices of the changed atoms [num_moved]
+ * @param new_positions: New positions [num_moved*3] in Å, NULL to keep
+ * @param new_numbers: New atomic numbers [num_moved] (swaps), NULL to keep
+ * @param energy: Output total energy of the trial configuration in eV
+ * @return: 1 on success, 0 on failure
+ */
+int mace_mc_propose(MACEMCHandle mc,
+                    int num_moved,
+                    const int* indices,
+                    const double* new_positions,
+                    const int* new_numbers,
+                    double* energy);
+
+/**
+ * Evaluate many independent trial moves against the committed configuration
+ * (left unchanged). Each trial's receptive-field cluster is packed with the
+ * others into a few batched model passes, which keeps the threads busy
+ * where single-move proposals are too small to.
+ * @param num_trials: Number of trial moves K
+ * @param moved_counts: Atoms changed by each trial [K], NULL for one each
+ * @param indices: Changed atom indices of all trials, concatenated
+ * @param new_positions: New positions [sum(moved_counts)*3] in Å, NULL to keep
+ * @param new_numbers: New atomic numbers [sum(moved_counts)], NULL to keep
+ * @param delta_energies: Output energy change of each trial in eV [K]
+ * @return: 1 on success, 0 on failure
+ */
+int mace_mc_evaluate_trials(MACEMCHandle mc,
+                            int num_trials,
+                            const int* moved_counts,
+                            const int* indices,
+                            const double* new_positions,
+                            const int* new_numbers,
+                            double* delta_energies);
+
+/* Commit the pending proposal into the cache; 1 on success */
+int mace_mc_accept(MACEMCHandle mc);
+
+/* Roll back the pending proposal; 1 on success */
+int mace_mc_reject(MACEMCHandle mc);
+
+/* Total energy of the committed configuration in eV */
+double mace_mc_energy(MACEMCHandle mc);
+
+/* Destroy Monte Carlo state */
+void mace_mc_destroy(MACEMCHandle mc);
+
+/* Opaque handle to the Python-free native engine */
+typedef void* MACENativeHandle;
+
+/**
+ * Load a model exported with python/export_native_model.py into the native
+ * C++ engine (no Python, torch or ASE at runtime)
+ * @param model_path: Path to the exported .bin model
+ * @param dtype: "float32" or "float64" (NULL for float32)
+ * @param num_threads: OpenMP threads, <= 0 for the OpenMP default
+ * @return: Handle or NULL on failure (see mace_native_get_error(NULL))
+ */
+MACENativeHandle mace_native_init(const char* model_path,
+                                  const char* dtype,
+                                  int num_threads);
+
+/**
+ * Calculate energy and forces with the native engine
+ * @param cell: 3x3 cell matrix, NULL for isolated systems
+ * @param pbc: Periodic boundary [x, y, z], NULL for isolated systems
+ * @param result: Output result structure, free with mace_free_result
+ */
+void mace_native_calculate(MACENativeHandle handle,
+                           const double* positions,
+                           const int* atomic_numbers,
+                           int num_atoms,
+                           const double* cell,
+                           const int* pbc,
+                           MACEResult* result);
+
+/* Destroy native engine */
+void mace_native_destroy(MACENativeHandle handle);
+
+/* Get native engine error message; with a NULL handle, the reason the last
+   mace_native_init on the calling thread failed */
+const char* mace_native_get_error(MACENativeHandle handle);
+
 #ifdef __cplusplus
 }
 #endif
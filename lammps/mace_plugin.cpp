@@ -0,0 +1,28 @@
+/* LAMMPS plugin registration of pair_style mace */
+
+#include "lammpsplugin.h"
+#include "version.h"
+
+#include "pair_mace.h"
+
+using namespace LAMMPS_NS;
+
+static Pair *mace_creator(LAMMPS *lmp)
+{
+  return new PairMACE(lmp);
+}
+
+extern "C" void lammpsplugin_init(void *lmp, void *handle, void *regfunc)
+{
+  lammpsplugin_t plugin;
+  lammpsplugin_regfunc register_plugin = (lammpsplugin_regfunc) regfunc;
+
+  plugin.version = LAMMPS_VERSION;
+  plugin.style = "pair";
+  plugin.name = "mace";
+  plugin.info = "MACE machine-learning potential via libmace_wrapper";
+  plugin.author = "mace_wrapper";
+  plugin.creator.v1 = (lammpsplugin_factory1 *) &mace_creator;
+  plugin.handle = handle;
+  (*register_plugin)(&plugin, lmp);
+}
@@ -0,0 +1,247 @@
+/* ----------------------------------------------------------------------
+   pair_style mace: MACE models through libmace_wrapper
+
+   Each rank evaluates its local atoms plus ghosts out to
+   num_interactions * r_max (+ skin). Node energies of local atoms are the
+   energy; gradients on ghosts are returned as ghost forces and summed into
+   their owners by LAMMPS's reverse communication (newton pair on). The
+   global virial follows from f dot r over locals and ghosts; per-atom
+   virials split each edge's virial between its two atoms. Species and the
+   full neighbor list (with ghost neighbors) are passed to the library only
+   after reneighboring; other steps pass positions only.
+------------------------------------------------------------------------- */
+
+#include "pair_mace.h"
+
+#include "atom.h"
+#include "comm.h"
+#include "error.h"
+#include "force.h"
+#include "memory.h"
+#include "neigh_list.h"
+#include "neighbor.h"
+#include "update.h"
+
+#include "mace_wrapper.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace LAMMPS_NS;
+
+static const char *const ELEMENTS[] = {
+    "H",  "He", "Li", "Be", "B",  "C",  "N",  "O",  "F",  "Ne", "Na", "Mg", "Al", "Si", "P",
+    "S",  "Cl", "Ar", "K",  "Ca", "Sc", "Ti", "V",  "Cr", "Mn", "Fe", "Co", "Ni", "Cu", "Zn",
+    "Ga", "Ge", "As", "Se", "Br", "Kr", "Rb", "Sr", "Y",  "Zr", "Nb", "Mo", "Tc", "Ru", "Rh",
+    "Pd", "Ag", "Cd", "In", "Sn", "Sb", "Te", "I",  "Xe", "Cs", "Ba", "La", "Ce", "Pr", "Nd",
+    "Pm", "Sm", "Eu", "Gd", "Tb", "Dy", "Ho", "Er", "Tm", "Yb", "Lu", "Hf", "Ta", "W",  "Re",
+    "Os", "Ir", "Pt", "Au", "Hg", "Tl", "Pb", "Bi", "Po", "At", "Rn", "Fr", "Ra", "Ac", "Th",
+    "Pa", "U",  "Np", "Pu", "Am", "Cm", "Bk", "Cf", "Es", "Fm", "Md", "No", "Lr", "Rf", "Db",
+    "Sg", "Bh", "Hs", "Mt", "Ds", "Rg", "Cn", "Nh", "Fl", "Mc", "Lv", "Ts", "Og"};
+
+/* Atomic number of an element symbol or a plain number, 0 if unknown */
+static int atomic_number(const char *name)
+{
+  char *end = nullptr;
+  long z = std::strtol(name, &end, 10);
+  if (end != name && *end == '\0') return (z > 0 && z <= 118) ? static_cast<int>(z) : 0;
+  for (int i = 0; i < 118; ++i)
+    if (std::strcmp(name, ELEMENTS[i]) == 0) return i + 1;
+  return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+PairMACE::PairMACE(LAMMPS *lmp) :
+    Pair(lmp), handle(nullptr), device("cpu"), precision("float32"), cueq(0), cutoff(0.0),
+    ghost_cutoff(0.0), last_build(-1)
+{
+  single_enable = 0;
+  restartinfo = 0;
+  one_coeff = 1;
+  manybody_flag = 1;
+}
+
+PairMACE::~PairMACE()
+{
+  if (handle) mace_destroy(handle);
+  if (allocated) {
+    memory->destroy(setflag);
+    memory->destroy(cutsq);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PairMACE::compute(int eflag, int vflag)
+{
+  ev_init(eflag, vflag);
+
+  const int nlocal = atom->nlocal;
+  const int nall = nlocal + atom->nghost;
+  if (nall == 0) return;
+  const bool rebuild = neighbor->ncalls != last_build;
+  if (rebuild) build_graph();
+
+  forces.resize(3 * static_cast<size_t>(nall));
+  node_energies.resize(nlocal);
+  if (vflag_atom) node_virials.resize(9 * static_cast<size_t>(nall));
+  double energy = 0.0;
+  if (!mace_calculate_local_graph(handle, nlocal, nall - nlocal, numbers.data(), &atom->x[0][0],
+                                  static_cast<int>(edges.size() / 2), edges.data(), rebuild ? 1 : 0,
+                                  &energy, eflag_atom ? node_energies.data() : nullptr,
+                                  forces.data(), vflag_atom ? node_virials.data() : nullptr))
+    error->one(FLERR, "MACE evaluation failed: {}", mace_get_error(handle));
+
+  double **f = atom->f;
+  for (int i = 0; i < nall; ++i) {
+    f[i][0] += forces[3 * i + 0];
+    f[i][1] += forces[3 * i + 1];
+    f[i][2] += forces[3 * i + 2];
+  }
+
+  if (eflag_global) eng_vdwl += energy;
+  if (eflag_atom)
+    for (int i = 0; i < nlocal; ++i) eatom[i] += node_energies[i];
+
+  // Ghost rows are summed into their owners by reverse communication
+  if (vflag_atom) {
+    for (int i = 0; i < nall; ++i) {
+      const double *w = &node_virials[9 * static_cast<size_t>(i)];
+      vatom[i][0] += w[0];
+      vatom[i][1] += w[4];
+      vatom[i][2] += w[8];
+      vatom[i][3] += 0.5 * (w[1] + w[3]);
+      vatom[i][4] += 0.5 * (w[2] + w[6]);
+      vatom[i][5] += 0.5 * (w[5] + w[7]);
+    }
+  }
+
+  if (vflag_fdotr) virial_fdotr_compute();
+}
+
+/* ----------------------------------------------------------------------
+   species of locals + ghosts and the directed edge list (senders, then
+   receivers) from the full neighbor list including ghost neighbors;
+   pairs out to r_max + skin are kept so the graph stays valid until the
+   next reneighboring
+------------------------------------------------------------------------- */
+
+void PairMACE::build_graph()
+{
+  const int nall = atom->nlocal + atom->nghost;
+  const int *type = atom->type;
+  numbers.resize(nall);
+  for (int i = 0; i < nall; ++i) numbers[i] = type2z[type[i]];
+
+  const int inum = list->inum + list->gnum;
+  const int *ilist = list->ilist;
+  const int *numneigh = list->numneigh;
+  int **firstneigh = list->firstneigh;
+
+  std::vector<int> receivers;
+  edges.clear();
+  for (int ii = 0; ii < inum; ++ii) {
+    const int i = ilist[ii];
+    const int *jlist = firstneigh[i];
+    for (int jj = 0; jj < numneigh[i]; ++jj) {
+      edges.push_back(i);
+      receivers.push_back(jlist[jj] & NEIGHMASK);
+    }
+  }
+  edges.insert(edges.end(), receivers.begin(), receivers.end());
+  last_build = neighbor->ncalls;
+}
+
+/* ----------------------------------------------------------------------
+   pair_style mace [device cpu|cuda] [precision float32|float64|auto] [cueq yes|no]
+------------------------------------------------------------------------- */
+
+void PairMACE::settings(int narg, char **arg)
+{
+  int iarg = 0;
+  while (iarg < narg) {
+    if (iarg + 2 > narg) error->all(FLERR, "Illegal pair_style mace command");
+    if (strcmp(arg[iarg], "device") == 0) {
+      device = arg[iarg + 1];
+    } else if (strcmp(arg[iarg], "precision") == 0) {
+      precision = arg[iarg + 1];
+    } else if (strcmp(arg[iarg], "cueq") == 0) {
+      cueq = utils::logical(FLERR, arg[iarg + 1], false, lmp);
+    } else {
+      error->all(FLERR, "Unknown pair_style mace keyword: {}", arg[iarg]);
+    }
+    iarg += 2;
+  }
+}
+
+/* ----------------------------------------------------------------------
+   pair_coeff * * <model file | small | medium | large> <element per type>
+------------------------------------------------------------------------- */
+
+void PairMACE::coeff(int narg, char **arg)
+{
+  if (!allocated) allocate();
+
+  const int ntypes = atom->ntypes;
+  if (narg != 3 + ntypes)
+    error->all(FLERR, "Pair style mace needs pair_coeff * * <model> followed by one element per type");
+  if (strcmp(arg[0], "*") != 0 || strcmp(arg[1], "*") != 0)
+    error->all(FLERR, "Pair style mace requires pair_coeff * *");
+
+  type2z.assign(ntypes + 1, 0);
+  for (int t = 1; t <= ntypes; ++t) {
+    type2z[t] = atomic_number(arg[2 + t]);
+    if (type2z[t] == 0) error->all(FLERR, "Unknown element {} for pair style mace", arg[2 + t]);
+  }
+
+  if (handle) mace_destroy(handle);
+  const char *model = arg[2];
+  const bool pretrained = !strcmp(model, "small") || !strcmp(model, "medium") || !strcmp(model, "large");
+  handle = mace_init_with_precision(pretrained ? nullptr : model, pretrained ? model : "medium",
+                                    device.c_str(), cueq, precision.c_str());
+  if (!handle) error->one(FLERR, "Could not load MACE model {}", model);
+  cutoff = mace_get_cutoff(handle);
+  ghost_cutoff = mace_get_ghost_cutoff(handle);
+  if (cutoff <= 0.0 || ghost_cutoff <= 0.0) error->one(FLERR, "MACE error: {}", mace_get_error(handle));
+  last_build = -1;
+
+  for (int i = 1; i <= ntypes; ++i)
+    for (int j = i; j <= ntypes; ++j) setflag[i][j] = 1;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PairMACE::init_style()
+{
+  if (force->newton_pair == 0) error->all(FLERR, "Pair style mace requires newton pair on");
+  if (strcmp(update->unit_style, "metal") != 0) error->all(FLERR, "Pair style mace requires metal units");
+  if (!handle) error->all(FLERR, "Pair style mace requires pair_coeff * * <model> <elements>");
+
+  // Full list with neighbors of ghosts: messages pass through ghost atoms
+  neighbor->add_request(this, NeighConst::REQ_FULL | NeighConst::REQ_GHOST);
+
+  // Local node energies see atoms up to num_interactions * r_max away
+  comm->cutghostuser = std::max(comm->cutghostuser, ghost_cutoff + neighbor->skin);
+  last_build = -1;
+}
+
+/* ---------------------------------------------------------------------- */
+
+double PairMACE::init_one(int, int)
+{
+  return cutoff;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PairMACE::allocate()
+{
+  allocated = 1;
+  const int n = atom->ntypes + 1;
+  memory->create(setflag, n, n, "pair:setflag");
+  for (int i = 1; i < n; ++i)
+    for (int j = i; j < n; ++j) setflag[i][j] = 0;
+  memory->create(cutsq, n, n, "pair:cutsq");
+}
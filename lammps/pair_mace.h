@@ -0,0 +1,59 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   pair_style mace: MACE models through libmace_wrapper
+
+   Built as a LAMMPS plugin (make lammps), loaded with
+   "plugin load mace_lammps_plugin.so".
+------------------------------------------------------------------------- */
+
+#ifdef PAIR_CLASS
+// clang-format off
+PairStyle(mace,PairMACE);
+// clang-format on
+#else
+
+#ifndef LMP_PAIR_MACE_H
+#define LMP_PAIR_MACE_H
+
+#include "pair.h"
+
+#include <string>
+#include <vector>
+
+namespace LAMMPS_NS {
+
+class PairMACE : public Pair {
+ public:
+  PairMACE(class LAMMPS *);
+  ~PairMACE() override;
+
+  void compute(int, int) override;
+  void settings(int, char **) override;
+  void coeff(int, char **) override;
+  void init_style() override;
+  double init_one(int, int) override;
+
+ protected:
+  void *handle;               // MACEHandle of this rank
+  std::string device;
+  std::string precision;
+  int cueq;
+  double cutoff;              // model r_max
+  double ghost_cutoff;        // num_interactions * r_max
+  std::vector<int> type2z;    // LAMMPS type -> atomic number
+
+  // Resident between timesteps; rebuilt when LAMMPS reneighbors
+  std::vector<int> numbers;
+  std::vector<int> edges;
+  std::vector<double> forces;
+  std::vector<double> node_energies;
+  std::vector<double> node_virials;  // [nall * 9], only for per-atom virials
+  bigint last_build;         // neighbor->ncalls of the resident graph
+
+  void allocate();
+  void build_graph();
+};
+
+}    // namespace LAMMPS_NS
+
+#endif
+#endif
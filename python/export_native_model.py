@@ -0,0 +1,591 @@
+"""Export a MACE model to the flat binary read by the native C++ engine
+
+Usage:
+    python export_native_model.py --model small --output mace_small.bin
+    python export_native_model.py --model small --output mace_small.bin \\
+        --validate --lib ../lib/libmace_native.so [--structures test.xyz]
+
+The exporter evaluates every equivariant layer of the model on probe inputs
+and stores the effective weights, so the engine does not need e3nn's
+normalization conventions. Supported: ScaleShiftMACE with
+RealAgnosticInteractionBlock / RealAgnosticResidualInteractionBlock, plain
+(non-cuEquivariance) symmetric contractions, max_ell <= 3 and untrained
+Bessel frequencies. Each exported block is checked against torch.
+"""
+import argparse
+import ctypes
+import math
+import os
+import struct
+import sys
+
+import numpy as np
+import torch
+
+from mace.calculators import mace_mp, MACECalculator
+
+FORMAT_VERSION = 1
+SUPPORTED_BLOCKS = ("RealAgnosticInteractionBlock", "RealAgnosticResidualInteractionBlock")
+
+
+class _Writer:
+    """Collects named tensors and writes the MACENAT1 container"""
+
+    def __init__(self):
+        self.tensors = {}
+
+    def floats(self, name, value):
+        self.tensors[name] = np.ascontiguousarray(np.asarray(value, dtype=np.float64))
+
+    def ints(self, name, value):
+        self.tensors[name] = np.ascontiguousarray(np.asarray(value, dtype=np.int64))
+
+    def save(self, path):
+        with open(path, "wb") as f:
+            f.write(b"MACENAT1")
+            f.write(struct.pack("<I", len(self.tensors)))
+            for name, array in self.tensors.items():
+                encoded = name.encode()
+                f.write(struct.pack("<I", len(encoded)))
+                f.write(encoded)
+                kind = 0 if array.dtype == np.float64 else 1
+                f.write(struct.pack("<II", kind, array.ndim))
+                f.write(struct.pack(f"<{array.ndim}q", *array.shape))
+                f.write(array.astype("<f8" if kind == 0 else "<i8").tobytes())
+
+
+def _silu(x):
+    return x / (1.0 + math.exp(-x))
+
+
+def _check(name, expected, actual, tol):
+    expected = np.asarray(expected, dtype=np.float64)
+    actual = np.asarray(actual, dtype=np.float64)
+    err = np.abs(expected - actual).max() / max(1.0, np.abs(expected).max())
+    if err > tol:
+        raise RuntimeError(f"{name}: export mismatch (relative error {err:.2e})")
+
+
+# ------------------------------------------------------------------------
+# Irreps layout: e3nn stores [mul][2l+1] per irrep, the engine [2l+1][C]
+# ------------------------------------------------------------------------
+
+def _block_ls(irreps, channels, what):
+    ls = []
+    for mul, ir in irreps:
+        if mul != channels:
+            raise RuntimeError(f"{what}: irreps {irreps} do not have {channels} channels per irrep")
+        ls.append(ir.l)
+    return ls
+
+
+def _e3nn_index(irreps, block, channel, m):
+    offset = 0
+    for b, (mul, ir) in enumerate(irreps):
+        if b == block:
+            return offset + channel * ir.dim + m
+        offset += mul * ir.dim
+    raise IndexError(block)
+
+
+def _to_blocks(x, irreps):
+    """[..., e3nn dim] -> [..., engine dim]"""
+    parts, offset = [], 0
+    for mul, ir in irreps:
+        field = x[..., offset:offset + mul * ir.dim]
+        field = field.reshape(*x.shape[:-1], mul, ir.dim).swapaxes(-1, -2)
+        parts.append(field.reshape(*x.shape[:-1], mul * ir.dim))
+        offset += mul * ir.dim
+    return np.concatenate(parts, axis=-1)
+
+
+def _block_offsets(ls, channels):
+    offsets, total = [], 0
+    for l in ls:
+        offsets.append(total)
+        total += (2 * l + 1) * channels
+    return offsets, total
+
+
+# ------------------------------------------------------------------------
+# Probes
+# ------------------------------------------------------------------------
+
+def _probe_linear(fn, irreps_in, irreps_out, channels, sets=1):
+    """Effective block weights of a linear equivariant map fn(x, set)"""
+    dim_in = irreps_in.dim
+    pairs, weights = [], []
+    matrices = []
+    with torch.no_grad():
+        for s in range(sets):
+            eye = torch.eye(dim_in, dtype=torch.float64)
+            matrices.append(fn(eye, s).double().numpy())
+
+    for bi, (_, ir_in) in enumerate(irreps_in):
+        for bo, (_, ir_out) in enumerate(irreps_out):
+            if ir_in != ir_out:
+                continue
+            rows = [_e3nn_index(irreps_in, bi, u, 0) for u in range(channels)]
+            cols = [_e3nn_index(irreps_out, bo, v, 0) for v in range(channels)]
+            w = np.stack([m[np.ix_(rows, cols)] for m in matrices])
+            if np.abs(w).max() == 0.0:
+                continue
+            pairs.append((bi, bo))
+            weights.append(w)
+
+    if weights:
+        weights = np.stack(weights)   # [pairs, sets, C, C]
+    else:
+        weights = np.zeros((0, sets, channels, channels))
+    if sets == 1:
+        weights = weights[:, 0]
+    return np.asarray(pairs, dtype=np.int64).reshape(-1, 2), weights
+
+
+def _apply_linear(pairs, weights, x, ls_in, ls_out, channels, s=0):
+    """Engine-layout reference: used to self-check the probes"""
+    off_in, _ = _block_offsets(ls_in, channels)
+    off_out, dim_out = _block_offsets(ls_out, channels)
+    y = np.zeros((x.shape[0], dim_out))
+    for p, (bi, bo) in enumerate(pairs):
+        w = weights[p, s] if weights.ndim == 4 else weights[p]
+        d = 2 * ls_in[bi] + 1
+        xi = x[:, off_in[bi]:off_in[bi] + d * channels].reshape(-1, d, channels)
+        y[:, off_out[bo]:off_out[bo] + d * channels] += (xi @ w).reshape(-1, d * channels)
+    return y
+
+
+def _export_linear(writer, name, fn, irreps_in, irreps_out, channels, sets=1):
+    pairs, weights = _probe_linear(fn, irreps_in, irreps_out, channels, sets)
+    writer.ints(name + ".pairs", pairs)
+    writer.floats(name + ".weights", weights)
+
+    ls_in = [ir.l for _, ir in irreps_in]
+    ls_out = [ir.l for _, ir in irreps_out]
+    x = torch.randn(4, irreps_in.dim, dtype=torch.float64)
+    for s in range(sets):
+        with torch.no_grad():
+            expected = fn(x, s).double().numpy()
+        actual = _apply_linear(pairs, weights, _to_blocks(x.numpy(), irreps_in), ls_in, ls_out, channels, s)
+        _check(name, _to_blocks(expected, irreps_out), actual, 1e-8)
+
+
+def _export_radial(writer, name, mlp):
+    if type(mlp).__name__ != "FullyConnectedNet":
+        raise RuntimeError(f"{name}: unsupported radial network {type(mlp).__name__}")
+    layers = list(mlp.children())
+    act_scale = None
+    for i, layer in enumerate(layers):
+        weight = layer.weight.detach().double()
+        if layer.act is not None:
+            w = weight / math.sqrt(layer.h_in * layer.var_in)
+            with torch.no_grad():
+                scale = float(layer.act(torch.tensor([1.0], dtype=torch.float64))[0]) / _silu(1.0)
+            scale *= math.sqrt(layer.var_out)
+            if act_scale is not None and abs(scale - act_scale) > 1e-9:
+                raise RuntimeError(f"{name}: layers use different activations")
+            act_scale = scale
+        else:
+            if i != len(layers) - 1:
+                raise RuntimeError(f"{name}: hidden layer without activation")
+            w = weight / math.sqrt(layer.h_in * layer.var_in / layer.var_out)
+        writer.floats(f"{name}.w{i}", w.numpy())
+    writer.ints(name + ".num_layers", [len(layers)])
+    writer.floats(name + ".act_scale", [act_scale if act_scale is not None else 1.0])
+
+    x = torch.rand(5, layers[0].h_in, dtype=torch.float64)
+    h = x.numpy()
+    for i in range(len(layers)):
+        h = h @ writer.tensors[f"{name}.w{i}"]
+        if i != len(layers) - 1:
+            h = act_scale * h / (1.0 + np.exp(-h))
+    with torch.no_grad():
+        _check(name, mlp(x.to(layers[0].weight.dtype)).double().numpy(), h, 1e-6)
+
+
+def _export_conv_tp(writer, name, tp, channels, lmax_sh):
+    irreps_node, irreps_sh, irreps_mid = tp.irreps_in1, tp.irreps_in2, tp.irreps_out
+    for l, (mul, ir) in enumerate(irreps_sh):
+        if mul != 1 or ir.l != l:
+            raise RuntimeError(f"{name}: edge attributes {irreps_sh} are not 0..lmax harmonics")
+
+    dtype = torch.float64
+    paths, coeffs = [], []
+    weight_offset = 0
+    for ins in tp.instructions:
+        if not ins.has_weight:
+            raise RuntimeError(f"{name}: unweighted tensor-product path")
+        if ins.connection_mode != "uvu" or tuple(ins.path_shape) != (channels, 1):
+            raise RuntimeError(f"{name}: unsupported connection mode {ins.connection_mode}")
+        l1 = irreps_node[ins.i_in1].ir.l
+        l2 = irreps_sh[ins.i_in2].ir.l
+        l3 = irreps_mid[ins.i_out].ir.l
+        d1, d2, d3 = 2 * l1 + 1, 2 * l2 + 1, 2 * l3 + 1
+
+        x1 = torch.zeros(d1 * d2, irreps_node.dim, dtype=dtype)
+        x2 = torch.zeros(d1 * d2, irreps_sh.dim, dtype=dtype)
+        w = torch.zeros(d1 * d2, tp.weight_numel, dtype=dtype)
+        for m1 in range(d1):
+            for m2 in range(d2):
+                row = m1 * d2 + m2
+                x1[row, _e3nn_index(irreps_node, ins.i_in1, 0, m1)] = 1.0
+                x2[row, _e3nn_index(irreps_sh, ins.i_in2, 0, m2)] = 1.0
+                w[row, weight_offset] = 1.0
+        with torch.no_grad():
+            out = tp(x1, x2, w).double().numpy()
+
+        path = len(paths)
+        paths.append((ins.i_in1, l2, ins.i_out, weight_offset // channels))
+        for m1 in range(d1):
+            for m2 in range(d2):
+                for m3 in range(d3):
+                    value = out[m1 * d2 + m2, _e3nn_index(irreps_mid, ins.i_out, 0, m3)]
+                    if abs(value) > 1e-12:
+                        coeffs.append((path, m1, m2, m3, value))
+        weight_offset += channels
+
+    writer.ints(name + ".paths", np.asarray(paths, dtype=np.int64).reshape(-1, 4))
+    writer.floats(name + ".coeffs", np.asarray(coeffs, dtype=np.float64).reshape(-1, 5))
+
+    # Self-check against torch on random inputs
+    ls_node = [ir.l for _, ir in irreps_node]
+    ls_mid = [ir.l for _, ir in irreps_mid]
+    off_node, _ = _block_offsets(ls_node, channels)
+    off_mid, dim_mid = _block_offsets(ls_mid, channels)
+    x1 = torch.randn(3, irreps_node.dim, dtype=dtype)
+    x2 = torch.randn(3, irreps_sh.dim, dtype=dtype)
+    w = torch.randn(3, tp.weight_numel, dtype=dtype)
+    with torch.no_grad():
+        expected = _to_blocks(tp(x1, x2, w).double().numpy(), irreps_mid)
+    xb = _to_blocks(x1.numpy(), irreps_node)
+    actual = np.zeros((3, dim_mid))
+    for path, m1, m2, m3, value in coeffs:
+        bi, l2, bo, wi = paths[path]
+        for c in range(channels):
+            actual[:, off_mid[bo] + m3 * channels + c] += (
+                value * x2[:, l2 * l2 + m2].numpy() * w[:, wi * channels + c].numpy()
+                * xb[:, off_node[bi] + m1 * channels + c])
+    _check(name, expected, actual, 1e-8)
+    return len(paths)
+
+
+def _export_symmetric_contraction(writer, name, sc, channels, num_elements, dim_a):
+    outputs = []
+    for j, contraction in enumerate(sc.contractions):
+        l_out = sc.irreps_out[j].ir.l
+        correlation = int(contraction.correlation)
+        if correlation > 4:
+            raise RuntimeError(f"{name}: correlation {correlation} > 4")
+        prefix = f"{name}.out{j}."
+        writer.ints(prefix + "block", [j])
+        writer.ints(prefix + "correlation", [correlation])
+        terms_by_nu = []
+        for nu in range(1, correlation + 1):
+            u = getattr(contraction, f"U_matrix_{nu}").detach().double().numpy()
+            if u.ndim == nu + 1:
+                u = u[None]
+            if u.shape[0] != 2 * l_out + 1 or any(s != dim_a for s in u.shape[1:nu + 1]):
+                raise RuntimeError(f"{name}: unexpected U_matrix_{nu} shape {u.shape}")
+            if nu == correlation:
+                weights = contraction.weights_max
+            else:
+                weights = contraction.weights[correlation - 1 - nu]
+            weights = weights.detach().double().numpy()
+            if weights.shape[0] != num_elements or weights.shape[2] != channels:
+                raise RuntimeError(f"{name}: unexpected weight shape {weights.shape}")
+
+            # The product of features is symmetric, so merge permuted indices
+            merged = {}
+            for index in zip(*np.nonzero(np.abs(u) > 1e-12)):
+                key = (index[0],) + tuple(sorted(index[1:nu + 1])) + (index[nu + 1],)
+                merged[key] = merged.get(key, 0.0) + u[index]
+            rows = [list(k[:nu + 1]) + [k[nu + 1], v] for k, v in merged.items() if abs(v) > 1e-12]
+            writer.floats(prefix + f"u{nu}", np.asarray(rows, dtype=np.float64).reshape(-1, nu + 3))
+            writer.floats(prefix + f"w{nu}", weights)
+            terms_by_nu.append((rows, weights))
+        outputs.append((l_out, terms_by_nu))
+    writer.ints(name + ".num_out", [len(outputs)])
+
+    # Self-check against torch with one-hot element attributes
+    x = torch.randn(num_elements, channels, dim_a, dtype=torch.float64)
+    attrs = torch.eye(num_elements, dtype=torch.float64)
+    with torch.no_grad():
+        expected = sc(x.to(_dtype_of(sc)), attrs.to(_dtype_of(sc))).double().numpy()
+    xs = x.numpy()
+    actual = []
+    for l_out, terms_by_nu in outputs:
+        b = np.zeros((num_elements, 2 * l_out + 1, channels))
+        for nu, (rows, weights) in enumerate(terms_by_nu, start=1):
+            for row in rows:
+                m, idx, k, value = int(row[0]), [int(i) for i in row[1:nu + 1]], int(row[nu + 1]), row[nu + 2]
+                prod = value * weights[:, k, :]
+                for i in idx:
+                    prod = prod * xs[:, :, i]
+                b[:, m, :] += prod
+        actual.append(b.swapaxes(1, 2).reshape(num_elements, -1))
+    _check(name, expected, np.concatenate(actual, axis=1), 1e-6)
+
+
+def _dtype_of(module):
+    for p in module.parameters():
+        return p.dtype
+    return torch.float64
+
+
+def _export_readout(writer, name, readout, channels, head):
+    kind = type(readout).__name__
+    if kind == "LinearReadoutBlock":
+        irreps_in = readout.linear.irreps_in
+        eye = torch.eye(irreps_in.dim, dtype=_dtype_of(readout))
+        with torch.no_grad():
+            out = readout.linear(eye).double().numpy()
+        writer.ints(name + ".kind", [0])
+        writer.floats(name + ".w", out[[_e3nn_index(irreps_in, 0, c, 0) for c in range(channels)], head])
+        return
+    if kind != "NonLinearReadoutBlock":
+        raise RuntimeError(f"{name}: unsupported readout {kind}")
+
+    irreps_in = readout.linear_1.irreps_in
+    dtype = _dtype_of(readout)
+    with torch.no_grad():
+        w1 = readout.linear_1(torch.eye(irreps_in.dim, dtype=dtype)).double().numpy()
+        hidden = w1.shape[1]
+        w2 = readout.linear_2(torch.eye(hidden, dtype=dtype)).double().numpy()[:, head]
+        act = readout.non_linearity(torch.ones(1, hidden, dtype=dtype)).double().numpy()
+    w1 = w1[[_e3nn_index(irreps_in, 0, c, 0) for c in range(channels)]]
+    act_scale = act[0, 0] / _silu(1.0)
+    if not np.allclose(act, act[0, 0]):
+        raise RuntimeError(f"{name}: readout gate is not a uniform SiLU")
+    writer.ints(name + ".kind", [1])
+    writer.floats(name + ".w1", w1)
+    writer.floats(name + ".w2", w2)
+    writer.floats(name + ".act_scale", [act_scale])
+
+
+def export_model(model, path, head=0):
+    """Write `model` in the native engine format"""
+    model = model.double().eval()
+    if type(model).__name__ != "ScaleShiftMACE":
+        raise RuntimeError(f"Unsupported model class {type(model).__name__}")
+    if getattr(model, "pair_repulsion", False):
+        raise RuntimeError("ZBL pair repulsion is not supported by the native engine")
+    if getattr(model.radial_embedding, "distance_transform", None) is not None:
+        raise RuntimeError("Radial distance transforms are not supported by the native engine")
+
+    writer = _Writer()
+    bessel = model.radial_embedding.bessel_fn
+    cutoff = model.radial_embedding.cutoff_fn
+    r_max = float(model.r_max)
+    num_bessel = int(bessel.bessel_weights.numel())
+    expected = math.pi / r_max * torch.arange(1, num_bessel + 1, dtype=torch.float64)
+    if not torch.allclose(bessel.bessel_weights.detach().double(), expected, rtol=1e-5, atol=1e-6):
+        raise RuntimeError("Trained Bessel frequencies are not supported by the native engine")
+
+    lmax_sh = int(model.spherical_harmonics._lmax)
+    atomic_numbers = [int(z) for z in model.atomic_numbers]
+    num_elements = len(atomic_numbers)
+    embedding_irreps = model.node_embedding.linear.irreps_out
+    channels = embedding_irreps[0].mul
+
+    writer.ints("meta.version", [FORMAT_VERSION])
+    writer.floats("meta.r_max", [r_max])
+    writer.ints("meta.num_bessel", [num_bessel])
+    writer.ints("meta.cutoff_p", [int(cutoff.p)])
+    writer.ints("meta.lmax_sh", [lmax_sh])
+    writer.ints("meta.channels", [channels])
+    writer.ints("meta.num_interactions", [len(model.interactions)])
+    scale = model.scale_shift.scale.detach().double().reshape(-1)
+    shift = model.scale_shift.shift.detach().double().reshape(-1)
+    writer.floats("meta.scale", [float(scale[min(head, scale.numel() - 1)])])
+    writer.floats("meta.shift", [float(shift[min(head, shift.numel() - 1)])])
+
+    writer.ints("atomic_numbers", atomic_numbers)
+    e0 = model.atomic_energies_fn.atomic_energies.detach().double()
+    writer.floats("atomic_energies", (e0[head] if e0.ndim == 2 else e0).numpy())
+    with torch.no_grad():
+        embedding = model.node_embedding(torch.eye(num_elements, dtype=torch.float64)).numpy()
+    _block_ls(embedding_irreps, channels, "node embedding")
+    writer.floats("embedding", embedding[:, :channels])
+
+    sh_irreps = model.spherical_harmonics.irreps_out
+    for t, (block, product, readout) in enumerate(zip(model.interactions, model.products, model.readouts)):
+        kind = type(block).__name__
+        if kind not in SUPPORTED_BLOCKS:
+            raise RuntimeError(f"Unsupported interaction block {kind}")
+        residual = kind == "RealAgnosticResidualInteractionBlock"
+        p = f"layers.{t}."
+
+        irreps_node = block.linear_up.irreps_in
+        irreps_mid = block.conv_tp.irreps_out
+        irreps_message = block.linear.irreps_out
+        irreps_hidden = product.linear.irreps_out
+        writer.ints(p + "node_ls", _block_ls(irreps_node, channels, p + "node"))
+        writer.ints(p + "mid_ls", _block_ls(irreps_mid, channels, p + "mid"))
+        writer.ints(p + "hidden_ls", _block_ls(irreps_hidden, channels, p + "hidden"))
+        if _block_ls(irreps_message, channels, p + "message") != list(range(lmax_sh + 1)):
+            raise RuntimeError(f"{p}message irreps {irreps_message} do not match the harmonics {sh_irreps}")
+
+        def onehot(n, s):
+            attrs = torch.zeros(n, num_elements, dtype=torch.float64)
+            attrs[:, s] = 1.0
+            return attrs
+
+        _export_linear(writer, p + "linear_up", lambda x, s: block.linear_up(x),
+                       irreps_node, irreps_node, channels)
+        _export_radial(writer, p + "radial", block.conv_tp_weights)
+        _export_conv_tp(writer, p + "conv_tp", block.conv_tp, channels, lmax_sh)
+
+        avg = float(block.avg_num_neighbors)
+        if residual:
+            _export_linear(writer, p + "linear", lambda x, s: block.linear(x) / avg,
+                           irreps_mid, irreps_message, channels)
+            _export_linear(writer, p + "skip", lambda x, s: block.skip_tp(x, onehot(x.shape[0], s)),
+                           irreps_node, irreps_hidden, channels, sets=num_elements)
+        else:
+            # The element-dependent skip_tp acts on the message; fold it into linear
+            _export_linear(writer, p + "linear",
+                           lambda x, s: block.skip_tp(block.linear(x) / avg, onehot(x.shape[0], s)),
+                           irreps_mid, irreps_message, channels, sets=num_elements)
+            writer.ints(p + "skip.pairs", np.zeros((0, 2)))
+            writer.floats(p + "skip.weights", np.zeros((0, num_elements, channels, channels)))
+
+        writer.ints(p + "product.use_sc", [1 if product.use_sc else 0])
+        if product.use_sc and not residual:
+            raise RuntimeError(f"{p}product uses a residual the interaction does not provide")
+        _export_symmetric_contraction(writer, p + "product", product.symmetric_contractions,
+                                      channels, num_elements, irreps_message.dim // channels)
+        _export_linear(writer, p + "product.linear", lambda x, s: product.linear(x),
+                       irreps_hidden, irreps_hidden, channels)
+        _export_readout(writer, p + "readout", readout, channels, head)
+
+    writer.save(path)
+    return writer
+
+
+# ------------------------------------------------------------------------
+# Validation against the Python calculator
+# ------------------------------------------------------------------------
+
+class _MACEResult(ctypes.Structure):
+    _fields_ = [("energy", ctypes.c_double),
+                ("forces", ctypes.POINTER(ctypes.c_double)),
+                ("num_atoms", ctypes.c_int),
+                ("success", ctypes.c_int),
+                ("error_msg", ctypes.c_char * 512)]
+
+
+def load_native(lib_path, model_path, dtype="float64", num_threads=0):
+    """ctypes view of libmace_native and a handle for model_path"""
+    lib = ctypes.CDLL(lib_path)
+    lib.mace_native_init.restype = ctypes.c_void_p
+    lib.mace_native_init.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int]
+    lib.mace_native_calculate.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int,
+                                          ctypes.c_void_p, ctypes.c_void_p, ctypes.POINTER(_MACEResult)]
+    lib.mace_native_destroy.argtypes = [ctypes.c_void_p]
+    lib.mace_native_get_error.restype = ctypes.c_char_p
+    lib.mace_native_get_error.argtypes = [ctypes.c_void_p]
+    lib.mace_free_result.argtypes = [ctypes.POINTER(_MACEResult)]
+
+    handle = lib.mace_native_init(model_path.encode(), dtype.encode(), num_threads)
+    if not handle:
+        raise RuntimeError("Native engine failed to load the exported model: "
+                           + lib.mace_native_get_error(None).decode())
+    return lib, handle
+
+
+def native_calculate(lib, handle, atoms, positions=None):
+    """Energy and forces [n, 3] of `atoms` (or of `atoms` at `positions`) from the native engine"""
+    n = len(atoms)
+    if positions is None:
+        positions = atoms.get_positions()
+    positions = np.ascontiguousarray(positions, dtype=np.float64)
+    numbers = np.ascontiguousarray(atoms.get_atomic_numbers(), dtype=np.int32)
+    cell = np.ascontiguousarray(atoms.get_cell().array, dtype=np.float64)
+    pbc = np.ascontiguousarray(atoms.get_pbc(), dtype=np.int32)
+    result = _MACEResult()
+    lib.mace_native_calculate(handle, positions.ctypes.data, numbers.ctypes.data, n,
+                              cell.ctypes.data if pbc.any() else None,
+                              pbc.ctypes.data if pbc.any() else None,
+                              ctypes.byref(result))
+    if not result.success:
+        raise RuntimeError(result.error_msg.decode())
+    forces = np.ctypeslib.as_array(result.forces, shape=(n * 3,)).reshape(n, 3).copy()
+    energy = result.energy
+    lib.mace_free_result(ctypes.byref(result))
+    return energy, forces
+
+
+def validate(model_path, lib_path, calculator, structures, dtype="float64", num_threads=0):
+    """Compare the native engine with the Python calculator; returns max errors"""
+    lib, handle = load_native(lib_path, model_path, dtype, num_threads)
+
+    max_de, max_df = 0.0, 0.0
+    try:
+        for atoms in structures:
+            n = len(atoms)
+            energy, forces = native_calculate(lib, handle, atoms)
+
+            atoms = atoms.copy()
+            atoms.calc = calculator
+            de = abs(energy - atoms.get_potential_energy()) / n
+            df = np.abs(forces - atoms.get_forces()).max()
+            max_de, max_df = max(max_de, de), max(max_df, df)
+            print(f"{atoms.get_chemical_formula():>20s}  |dE|/atom {de:.2e} eV  max|dF| {df:.2e} eV/A")
+    finally:
+        lib.mace_native_destroy(handle)
+    return max_de, max_df
+
+
+def _random_structures(atomic_numbers, count=3, seed=0):
+    from ase import Atoms
+    rng = np.random.default_rng(seed)
+    structures = []
+    for k in range(count):
+        n = 8 + 4 * k
+        numbers = rng.choice(atomic_numbers[:4], size=n)
+        # Keep atoms at least ~1.5 A apart on a jittered grid
+        grid = np.stack(np.meshgrid(*[np.arange(3)] * 3, indexing="ij"), -1).reshape(-1, 3)
+        positions = grid[rng.choice(len(grid), size=n, replace=False)] * 2.0
+        positions = positions + rng.normal(scale=0.1, size=positions.shape)
+        periodic = k % 2 == 1
+        structures.append(Atoms(numbers=numbers, positions=positions,
+                                cell=np.eye(3) * 6.0 if periodic else None, pbc=periodic))
+    return structures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--model", default="small",
+                        help="mace_mp model name (small/medium/large) or path to a .model file")
+    parser.add_argument("--output", required=True, help="Output .bin path")
+    parser.add_argument("--head", type=int, default=0, help="Head index for multi-head models")
+    parser.add_argument("--validate", action="store_true", help="Compare the native engine with Python")
+    parser.add_argument("--lib", default=os.path.join(os.path.dirname(__file__), "..", "lib", "libmace_native.so"))
+    parser.add_argument("--structures", help="Structures (any ASE format) for --validate")
+    parser.add_argument("--dtype", default="float64", choices=["float32", "float64"])
+    args = parser.parse_args()
+
+    if os.path.exists(args.model):
+        calculator = MACECalculator(model_paths=args.model, device="cpu", default_dtype="float64")
+    else:
+        calculator = mace_mp(model=args.model, device="cpu", default_dtype="float64")
+    model = calculator.models[0]
+
+    export_model(model, args.output, head=args.head)
+    print(f"Exported {args.model} to {args.output}")
+
+    if args.validate:
+        if args.structures:
+            from ase.io import read
+            structures = read(args.structures, index=":")
+        else:
+            structures = _random_structures([int(z) for z in model.atomic_numbers])
+        max_de, max_df = validate(args.output, args.lib, calculator, structures, args.dtype)
+        print(f"Max |dE|/atom {max_de:.2e} eV, max |dF| {max_df:.2e} eV/A")
+        tol_e, tol_f = (1e-6, 1e-5) if args.dtype == "float64" else (1e-4, 1e-3)
+        if max_de > tol_e or max_df > tol_f:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
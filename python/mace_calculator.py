@@ -1,5 +1,13 @@
 """MACE calculator module for C API"""
+import concurrent.futures
+import contextlib
+import copy
+import itertools
+import math
+import warnings
+
 import numpy as np
+import torch
 
 # Apply WSL2 patch for cuEquivariance before importing MACE
 try:
@@ -9,29 +17,369 @@ except ImportError:
 
 from mace.calculators import mace_mp, MACECalculator
 from ase import Atoms
+from ase.calculators.calculator import Calculator, all_changes
+
+# Native kernels are registered by the C++ library; absent when imported standalone
+try:
+    import _mace_native
+except ImportError:
+    _mace_native = None
+
+_session = None
+
+PRECISIONS = ("float32", "float64", "bfloat16", "int8")
+_TORCH_DTYPES = {"float32": torch.float32, "float64": torch.float64,
+                 "bfloat16": torch.float32, "int8": torch.float32}
+
+
+def create_calculator(model_path=None, model_type="medium", device="cuda",
+                      enable_cueq=True, precision="float32"):
+    """Build a MACE calculator running at the given precision"""
+    if precision not in PRECISIONS:
+        raise ValueError(f"Unknown precision '{precision}', expected one of {PRECISIONS}")
+    if precision == "int8" and not device.startswith("cpu"):
+        raise ValueError("int8 precision is only available on CPU")
+    # Autocast never touches float64 tensors, so bf16 and int8 run on the float32 model
+    dtype = "float64" if precision == "float64" else "float32"
+
+    if model_path is not None:
+        calculator = MACECalculator(
+            model_paths=model_path,
+            device=device,
+            default_dtype=dtype,
+            enable_cueq=enable_cueq
+        )
+    else:
+        calculator = mace_mp(
+            model=model_type,
+            device=device,
+            default_dtype=dtype,
+            enable_cueq=enable_cueq
+        )
+
+    if precision == "bfloat16":
+        for model in calculator.models:
+            enable_bfloat16(model)
+    elif precision == "int8":
+        for model in calculator.models:
+            enable_int8(model)
+    return calculator
+
+
+@contextlib.contextmanager
+def _default_dtype(dtype):
+    # MACECalculator builds its input tensors with the torch default dtype,
+    # so it must match the model of the precision being evaluated
+    previous = torch.get_default_dtype()
+    torch.set_default_dtype(dtype)
+    try:
+        yield
+    finally:
+        torch.set_default_dtype(previous)
+
+
+class MACESession:
+    """Calculator state owned by one C API handle
+
+    mode is a fixed precision or "auto". In auto mode the session evaluates
+    in float32 and moves to float64 once the largest atomic force of the
+    previous call drops below `threshold`, returning to float32 when it rises
+    above twice the threshold. The float64 model is converted from the
+    already loaded float32 one, not reloaded; see calculator().
+    """
+
+    def __init__(self, model_path=None, model_type="medium", device="cuda",
+                 enable_cueq=True, precision="float32"):
+        base = "float32" if precision == "auto" else precision
+        self.model_args = (model_path, model_type, device, enable_cueq)
+        self.calculators = {base: create_calculator(*self.model_args, base)}
+        self.base = base
+        self.reference_calculator = None
+        self.mode = base
+        self.active = base
+        self.threshold = 0.05
+        self.last_fmax = None
+        self.native_edge_features = False
+        self.extrapolation = None
+        self.extrapolation_stats = ExtrapolationStats()
+        self.registered = None
+        self.memory_budget = None
+        self.domain_workers = 1
+        self.local_graph = None
+        self.last_blocks = 1
+        if precision == "auto":
+            self.set_precision("auto")
+
+    def set_precision(self, precision):
+        if precision not in ("float32", "float64", "auto"):
+            raise ValueError(f"Cannot switch to '{precision}'; expected float32, float64 or auto")
+        if precision != self.base and self.base not in ("float32", "float64"):
+            raise ValueError(f"A {self.base} handle cannot switch precision")
+        self.mode = precision
+
+    def set_adaptive_threshold(self, fmax):
+        if not fmax > 0:
+            raise ValueError("Adaptive threshold must be positive")
+        self.threshold = float(fmax)
+
+    def set_force_extrapolation(self, force_tol, max_displacement=0.1, max_skip=10, order=2):
+        """Let in-library MD and relaxation skip model calls, see ForceExtrapolator"""
+        if not force_tol > 0:
+            self.extrapolation = None
+        elif max_skip < 1 or order < 1:
+            raise ValueError("max_skip and order must be at least 1")
+        else:
+            self.extrapolation = {"force_tol": float(force_tol),
+                                  "max_displacement": float(max_displacement),
+                                  "max_skip": int(max_skip), "order": int(order)}
+        self.extrapolation_stats = ExtrapolationStats()
+
+    def set_memory_budget(self, max_bytes):
+        """Evaluate systems whose graph would exceed max_bytes in blocks, see ChunkedEvaluation"""
+        if max_bytes < 0:
+            raise ValueError("Memory budget must not be negative")
+        self.memory_budget = int(max_bytes) or None
+
+    def set_domain_decomposition(self, workers):
+        """Evaluate large systems as concurrent spatial domains, see ChunkedEvaluation"""
+        self.domain_workers = max(1, int(workers))
+
+    def _make_extrapolator(self):
+        if self.extrapolation is None:
+            return None
+        return ForceExtrapolator(stats=self.extrapolation_stats, **self.extrapolation)
+
+    def _choose_precision(self):
+        if self.mode != "auto":
+            return self.mode
+        if self.last_fmax is None:
+            return "float32"
+        limit = self.threshold * (2.0 if self.active == "float64" else 1.0)
+        return "float64" if self.last_fmax < limit else "float32"
+
+    def calculator(self, precision):
+        """Calculator evaluating in `precision`; one copy of the weights is
+        resident at a time
+
+        A float32 handle casts its models to float64 in place and back, which
+        is exact since float32 values round-trip through float64. A float64
+        handle keeps its models as the master and builds the float32 copy on
+        demand, dropping it when float64 is used again.
+        """
+        if precision not in self.calculators:
+            if self.base == "float32":
+                (calculator,) = self.calculators.values()
+                for model in calculator.models:
+                    model.to(_TORCH_DTYPES[precision])
+                calculator.results = {}
+                calculator.atoms = None
+                self.calculators = {precision: calculator}
+            else:
+                source = self.calculators[self.base]
+                derived = copy.copy(source)
+                derived.models = [copy.deepcopy(m).to(_TORCH_DTYPES[precision]) for m in source.models]
+                derived.results = {}
+                derived.atoms = None
+                if self.native_edge_features:
+                    for model in derived.models:
+                        _swap_edge_modules(model, True)
+                self.calculators[precision] = derived
+        elif precision == self.base and len(self.calculators) > 1:
+            self.calculators = {precision: self.calculators[precision]}
+        return self.calculators[precision]
+
+    def gradient_calculator(self):
+        """float64 calculator for second derivatives
+
+        float32 and float64 handles use calculator("float64"). bfloat16 and
+        int8 handles load the unconverted model in float64 once and keep it,
+        instead of copying their wrapped or quantized model per call.
+        """
+        if self.base in ("float32", "float64"):
+            return self.calculator("float64")
+        if self.reference_calculator is None:
+            self.reference_calculator = create_calculator(*self.model_args, "float64")
+        return self.reference_calculator
+
+    def resident_calculator(self):
+        """Any loaded calculator, for dtype-independent attributes (r_max,
+        interactions) without a precision switch"""
+        return next(iter(self.calculators.values()))
+
+    def compute(self, positions, atomic_numbers, cell=None, pbc=None):
+        """Compute energy and forces"""
+        energy, forces = self.compute_array(positions, atomic_numbers, cell, pbc)
+        return {
+            'energy': energy,
+            'forces': forces.tolist()
+        }
+
+    def compute_array(self, positions, atomic_numbers, cell=None, pbc=None, dtype=np.float64):
+        """Energy and forces as an [n, 3] array of dtype
+
+        float32 positions on a float32 model (the single-precision API) skip
+        the ASE calculator, which widens coordinates to float64: they become
+        the model's positions tensor as they are and the forces come back in
+        float32.
+        """
+        positions = np.asarray(positions)
+        if positions.dtype != np.float32:
+            positions = np.array(positions, dtype=np.float64)
+        atomic_numbers = np.array(atomic_numbers, dtype=np.int32)
+
+        precision = self._choose_precision()
+        calculator = self.calculator(precision)
+        chunked = None
+        if self.memory_budget is not None or self.domain_workers > 1:
+            chunked = ChunkedEvaluation(self, calculator, atomic_numbers, positions, cell, pbc,
+                                        self.memory_budget, self.domain_workers)
+        self.last_blocks = 1 if chunked is None else chunked.num_blocks
+        single = positions.dtype == np.float32 and _TORCH_DTYPES[precision] == torch.float32
+
+        with _default_dtype(_TORCH_DTYPES[precision]):
+            if self.last_blocks > 1:
+                energy, forces = chunked.compute()
+            elif single:
+                system = ResidentSystem(self, atomic_numbers, positions, cell, pbc, skin=0.0)
+                out = system.evaluate()
+                energy = float(out["energy"].detach().sum())
+                forces = out["forces"].detach().cpu().numpy()
+            else:
+                atoms = Atoms(
+                    numbers=atomic_numbers,
+                    positions=positions,
+                    cell=cell,
+                    pbc=pbc if pbc is not None else [False, False, False]
+                )
+                atoms.calc = calculator
+                energy = atoms.get_potential_energy()
+                forces = atoms.get_forces()
+
+        self.active = precision
+        self.last_fmax = float(np.linalg.norm(forces, axis=1).max()) if len(forces) else 0.0
+        return float(energy), np.ascontiguousarray(forces, dtype=dtype)
+
+    def compute_atomic(self, positions, atomic_numbers, cell=None, pbc=None, virials=False):
+        """Energy, forces, per-atom energies and optionally per-atom virials;
+        see ResidentSystem.compute_atomic"""
+        system = ResidentSystem(self, atomic_numbers, positions, cell, pbc, skin=0.0)
+        return system.compute_atomic(virials)
+
+    def hessian(self, positions, atomic_numbers, cell=None, pbc=None):
+        """Forces and full Hessian; see ResidentSystem.hessian"""
+        return ResidentSystem(self, atomic_numbers, positions, cell, pbc, skin=0.0).hessian()
+
+    def hessian_vector_product(self, positions, atomic_numbers, cell, pbc, vectors):
+        """Forces and Hessian-vector products; see ResidentSystem.hessian_vector_product"""
+        system = ResidentSystem(self, atomic_numbers, positions, cell, pbc, skin=0.0)
+        return system.hessian_vector_product(vectors)
+
+    def force_constants(self, *args, **kwargs):
+        """See force_constants()"""
+        return force_constants(self, *args, **kwargs)
+
+    def compute_subset(self, positions, atomic_numbers, cell, pbc, subset):
+        """See subset_forces()"""
+        return subset_forces(self, atomic_numbers, positions, cell, pbc, subset)
+
+    def run_md(self, *args, **kwargs):
+        """See run_md()"""
+        return run_md(self, *args, **kwargs)
+
+    def relax(self, *args, **kwargs):
+        """See relax()"""
+        return relax(self, *args, **kwargs)
+
+    def run_respa(self, *args, **kwargs):
+        """See run_respa()"""
+        return run_respa(self, *args, **kwargs)
+
+    def compute_batch(self, atomic_numbers, positions_list, cell=None, pbc=None):
+        """Energies [B] and forces [B, n, 3] of B configurations of one system"""
+        structures = [(atomic_numbers, np.asarray(p, dtype=np.float64).reshape(-1, 3), cell, pbc)
+                      for p in positions_list]
+        energies, forces = batched_energy_forces(self, structures)
+        return energies, np.stack(forces)
+
+    def ghost_cutoff(self):
+        """Ghost shell width needed by compute_local (num_interactions * r_max)"""
+        return receptive_field(self)
+
+    def compute_local(self, atomic_numbers, positions, num_local):
+        """Energy of the first num_local atoms and forces on all atoms
+
+        The remaining atoms are ghosts: copies of atoms owned elsewhere (or
+        periodic images) covering ghost_cutoff() around the local ones. The
+        ghost rows of the forces belong to the atoms they are copies of.
+        """
+        numbers = np.asarray(atomic_numbers, dtype=np.int64)
+        core = np.zeros(len(numbers), dtype=bool)
+        core[:num_local] = True
+
+        precision = self._choose_precision()
+        calculator = self.calculator(precision)
+        param = next(calculator.models[0].parameters())
+        with _default_dtype(_TORCH_DTYPES[precision]):
+            energy, grad = cluster_energy_gradient(calculator, numbers, positions, core,
+                                                   param.dtype, param.device)
+        self.active = precision
+        return energy, -grad
+
+    def cutoff(self):
+        """Radial cutoff r_max of the model in Angstroms"""
+        return float(self.resident_calculator().r_max)
+
+    def compute_local_graph(self, atomic_numbers, positions, edge_index, num_local, rebuild,
+                            node_energies=False, virials=False):
+        """See LocalGraph.compute; the graph stays resident between calls"""
+        if self.local_graph is None:
+            self.local_graph = LocalGraph(self)
+        return self.local_graph.compute(atomic_numbers, positions, edge_index, num_local,
+                                        rebuild, node_energies, virials)
+
+    def register_system(self, atomic_numbers, positions, cell=None, pbc=None, frozen=None,
+                        skip_frozen_forces=False):
+        """Register a system with frozen atoms for compute_registered()"""
+        self.registered = FrozenRegion(self, atomic_numbers, positions, cell, pbc,
+                                       frozen, skip_frozen_forces)
+
+    def compute_registered(self, positions):
+        """Energy and forces of the registered system at new mobile positions"""
+        if self.registered is None:
+            raise RuntimeError("No system registered")
+        energy, forces = self.registered.compute(positions)
+        return {'energy': energy, 'forces': forces}
+
+    def monte_carlo(self, atomic_numbers, positions, cell=None, pbc=None):
+        """Create an MCState for incremental trial moves"""
+        return MCState(self, atomic_numbers, positions, cell, pbc)
+
+    def set_native_edge_features(self, enable=True):
+        """Evaluate spherical harmonics and radial basis with the library's SIMD kernels"""
+        if enable and _mace_native is None:
+            return False
+
+        active = False
+        for calculator in self.calculators.values():
+            for model in calculator.models:
+                active |= _swap_edge_modules(model, enable)
+        self.native_edge_features = active
+        return active
+
+
+def create_session(model_path=None, model_type="medium", device="cuda",
+                   enable_cueq=True, precision="float32"):
+    """Create the per-handle session used by the C API"""
+    return MACESession(model_path, model_type, device, enable_cueq, precision)
 
-_calculator = None
 
 def initialize_mace(model_path=None, model_type="medium", device="cuda",
                    enable_cueq=True, dtype="float32"):
-    """Initialize global MACE calculator"""
-    global _calculator
+    """Initialize global MACE calculator; dtype is one of PRECISIONS or auto"""
+    global _session
 
     try:
-        if model_path is not None:
-            _calculator = MACECalculator(
-                model_paths=model_path,
-                device=device,
-                default_dtype=dtype,
-                enable_cueq=enable_cueq
-            )
-        else:
-            _calculator = mace_mp(
-                model=model_type,
-                device=device,
-                default_dtype=dtype,
-                enable_cueq=enable_cueq
-            )
+        _session = create_session(model_path, model_type, device, enable_cueq, dtype)
         return True
     except Exception as e:
         print(f"MACE initialization failed: {e}")
@@ -39,25 +387,2023 @@ def initialize_mace(model_path=None, model_type="medium", device="cuda",
 
 def compute_energy_forces(positions, atomic_numbers, cell=None, pbc=None):
     """Compute energy and forces"""
-    if _calculator is None:
+    if _session is None:
         raise RuntimeError("MACE not initialized")
+    return _session.compute(positions, atomic_numbers, cell, pbc)
+
+
+# ============================================================
+# Native edge featurization
+# ============================================================
+
+def _check_first_order():
+    # The native kernels only provide first derivatives
+    if torch.is_grad_enabled():
+        raise RuntimeError("native edge features do not support higher-order derivatives")
+
+
+class _NativeSphericalHarmonicsFunction(torch.autograd.Function):
+    @staticmethod
+    def forward(ctx, vectors, lmax):
+        sh, dsh = _mace_native.spherical_harmonics(
+            vectors.detach().numpy(), lmax, vectors.requires_grad)
+        if dsh is not None:
+            ctx.save_for_backward(torch.from_numpy(dsh))
+        return torch.from_numpy(sh)
+
+    @staticmethod
+    def backward(ctx, grad_sh):
+        _check_first_order()
+        (dsh,) = ctx.saved_tensors
+        return torch.einsum("ek,ekc->ec", grad_sh, dsh), None
+
+
+class _NativeBesselFunction(torch.autograd.Function):
+    @staticmethod
+    def forward(ctx, lengths, r_max, num_basis):
+        basis, dbasis = _mace_native.bessel_basis(
+            lengths.detach().reshape(-1).numpy(), r_max, num_basis, lengths.requires_grad)
+        ctx.lengths_shape = lengths.shape
+        if dbasis is not None:
+            ctx.save_for_backward(torch.from_numpy(dbasis))
+        return torch.from_numpy(basis)
+
+    @staticmethod
+    def backward(ctx, grad_basis):
+        _check_first_order()
+        (dbasis,) = ctx.saved_tensors
+        grad = (grad_basis * dbasis).sum(dim=-1)
+        return grad.reshape(ctx.lengths_shape), None, None
+
+
+class _NativeCutoffFunction(torch.autograd.Function):
+    @staticmethod
+    def forward(ctx, lengths, r_max, p):
+        envelope, denvelope = _mace_native.polynomial_cutoff(
+            lengths.detach().reshape(-1).numpy(), r_max, p, lengths.requires_grad)
+        if denvelope is not None:
+            ctx.save_for_backward(torch.from_numpy(denvelope).reshape(lengths.shape))
+        return torch.from_numpy(envelope).reshape(lengths.shape)
+
+    @staticmethod
+    def backward(ctx, grad_envelope):
+        _check_first_order()
+        (denvelope,) = ctx.saved_tensors
+        return grad_envelope * denvelope, None, None
+
+
+class NativeSphericalHarmonics(torch.nn.Module):
+    """Drop-in for e3nn SphericalHarmonics(normalize=True, normalization="component")"""
+
+    def __init__(self, original):
+        super().__init__()
+        self.original = original
+        self.irreps_out = original.irreps_out
+        self.lmax = int(original._lmax)
+
+    @staticmethod
+    def supports(module):
+        return (getattr(module, "normalize", False)
+                and getattr(module, "normalization", None) == "component"
+                and getattr(module, "_is_range_lmax", False)
+                and getattr(module, "_lmax", 99) <= 3)
+
+    def forward(self, vectors):
+        if vectors.device.type != "cpu":
+            return self.original(vectors)
+        sh = _NativeSphericalHarmonicsFunction.apply(vectors.reshape(-1, 3), self.lmax)
+        return sh.reshape(*vectors.shape[:-1], sh.shape[-1])
+
+
+class NativeBesselBasis(torch.nn.Module):
+    """Drop-in for mace.modules.radial.BesselBasis with untrained weights"""
+
+    def __init__(self, original):
+        super().__init__()
+        self.original = original
+        self.r_max = float(original.r_max)
+        self.num_basis = int(original.bessel_weights.numel())
+
+    @staticmethod
+    def supports(module):
+        if type(module).__name__ != "BesselBasis":
+            return False
+        # The kernel relies on evenly spaced k*pi/r_max frequencies
+        weights = module.bessel_weights.detach().cpu().double()
+        r_max = float(module.r_max)
+        expected = math.pi / r_max * torch.arange(1, weights.numel() + 1, dtype=torch.float64)
+        return torch.allclose(weights, expected, rtol=1e-5, atol=1e-6)
+
+    def forward(self, lengths):
+        if lengths.device.type != "cpu":
+            return self.original(lengths)
+        return _NativeBesselFunction.apply(lengths, self.r_max, self.num_basis)
+
+
+class NativePolynomialCutoff(torch.nn.Module):
+    """Drop-in for mace.modules.radial.PolynomialCutoff"""
+
+    def __init__(self, original):
+        super().__init__()
+        self.original = original
+        self.r_max = float(original.r_max)
+        self.p = int(original.p)
+
+    @staticmethod
+    def supports(module):
+        return type(module).__name__ == "PolynomialCutoff"
+
+    def forward(self, lengths):
+        if lengths.device.type != "cpu":
+            return self.original(lengths)
+        return _NativeCutoffFunction.apply(lengths, self.r_max, self.p)
+
+
+def _swap_edge_modules(model, enable):
+    """Swap the model's edge featurization modules; returns True if any native module is active"""
+    slots = [(model, "spherical_harmonics", NativeSphericalHarmonics)]
+    radial = getattr(model, "radial_embedding", None)
+    if radial is not None:
+        slots.append((radial, "bessel_fn", NativeBesselBasis))
+        slots.append((radial, "cutoff_fn", NativePolynomialCutoff))
+
+    active = False
+    for owner, name, native_cls in slots:
+        current = getattr(owner, name, None)
+        if current is None:
+            continue
+        try:
+            if enable and not isinstance(current, native_cls) and native_cls.supports(current):
+                setattr(owner, name, native_cls(current))
+            elif not enable and isinstance(current, native_cls):
+                setattr(owner, name, current.original)
+        except (AttributeError, RuntimeError) as e:
+            # Scripted or compiled models cannot have submodules replaced
+            warnings.warn(f"Native edge features unavailable for {name}: {e}", RuntimeWarning)
+        active |= isinstance(getattr(owner, name), native_cls)
+    return active
+
+
+def set_native_edge_features(enable=True):
+    """Evaluate spherical harmonics and radial basis with the library's SIMD kernels"""
+    if _session is None:
+        raise RuntimeError("MACE not initialized")
+    return _session.set_native_edge_features(enable)
+
+
+# ============================================================
+# bfloat16 mixed precision
+# ============================================================
+
+def cpu_has_bf16():
+    """True if the CPU has native bf16 matmul (AMX or AVX512-BF16)"""
+    try:
+        with open("/proc/cpuinfo") as f:
+            flags = f.read()
+    except OSError:
+        return False
+    return "amx_bf16" in flags or "avx512_bf16" in flags
+
+
+def _restore_dtype(value, dtype):
+    if torch.is_tensor(value) and value.is_floating_point():
+        return value.to(dtype)
+    if isinstance(value, tuple):
+        return tuple(_restore_dtype(v, dtype) for v in value)
+    return value
+
+
+class BFloat16Block(torch.nn.Module):
+    """Runs a block under bf16 autocast and hands float32 results back to the model"""
+
+    def __init__(self, original):
+        super().__init__()
+        self.original = original
+
+    def forward(self, *args, **kwargs):
+        tensors = [v for v in list(args) + list(kwargs.values()) if torch.is_tensor(v)]
+        dtype = next((t.dtype for t in tensors if t.is_floating_point()), torch.float32)
+        device_type = tensors[0].device.type if tensors else "cpu"
+        with torch.autocast(device_type=device_type, dtype=torch.bfloat16):
+            out = self.original(*args, **kwargs)
+        return _restore_dtype(out, dtype)
+
+
+def enable_bfloat16(model):
+    """Run the interaction and product blocks (linear layers, tensor products,
+    symmetric contractions) in bf16; the embedding, edge features, readouts,
+    energy sums and position gradients stay in the model dtype"""
+    if next(model.parameters()).dtype != torch.float32:
+        raise ValueError("bfloat16 mode needs a float32 model")
+    if next(model.parameters()).device.type == "cpu" and not cpu_has_bf16():
+        warnings.warn("CPU lacks AMX/AVX512-BF16; bfloat16 mode will be emulated and slower", RuntimeWarning)
+
+    # oneDNN dispatches bf16 matmuls to AMX tiles when available
+    torch.backends.mkldnn.enabled = True
+    for blocks in (model.interactions, model.products):
+        for i, block in enumerate(blocks):
+            if not isinstance(block, BFloat16Block):
+                blocks[i] = BFloat16Block(block)
+
+
+# ============================================================
+# Dynamic int8 quantization
+# ============================================================
+
+def _select_quantized_engine():
+    supported = torch.backends.quantized.supported_engines
+    for engine in ("x86", "fbgemm", "qnnpack"):
+        if engine in supported:
+            torch.backends.quantized.engine = engine
+            return engine
+    raise RuntimeError("PyTorch was built without a quantized CPU engine")
+
+
+class _Int8MatmulFunction(torch.autograd.Function):
+    """int8 x int8 forward; the backward uses the dequantized weight, so
+    position gradients see the quantized model with straight-through activations"""
+
+    @staticmethod
+    def forward(ctx, x, packed, weight, reduce_range):
+        ctx.save_for_backward(weight)
+        return torch.ops.quantized.linear_dynamic(x.contiguous(), packed, reduce_range)
+
+    @staticmethod
+    def backward(ctx, grad_out):
+        weight, = ctx.saved_tensors
+        return grad_out @ weight, None, None, None
+
+
+class Int8Linear(torch.nn.Module):
+    """Dynamic int8 replacement for e3nn o3.Linear (per-channel weights,
+    activations quantized per call)"""
+
+    def __init__(self, original):
+        super().__init__()
+        self.irreps_in = original.irreps_in
+        self.irreps_out = original.irreps_out
+        self.reduce_range = torch.backends.quantized.engine in ("x86", "fbgemm")
+        dim_in = self.irreps_in.dim
+
+        param = next(original.parameters())
+        with torch.no_grad():
+            eye = torch.eye(dim_in, dtype=param.dtype, device=param.device)
+            bias = original(torch.zeros(1, dim_in, dtype=param.dtype, device=param.device))
+            dense = (original(eye) - bias).double().cpu()
+        self.register_buffer("bias", bias[0].float().cpu() if bias.abs().max() > 0 else None)
+
+        offsets_in = self._offsets(self.irreps_in)
+        offsets_out = self._offsets(self.irreps_out)
+        # Per-path int8 weights and their dequantized copies are buffers, so
+        # .to(), state_dict() and deepcopy carry them with the module
+        self.paths = []
+        self._packed = None
+        self.weight_error = 0.0
+        for i, (mul_in, ir_in) in enumerate(self.irreps_in):
+            for o, (mul_out, ir_out) in enumerate(self.irreps_out):
+                if ir_in != ir_out:
+                    continue
+                d = ir_in.dim
+                rows = offsets_in[i] + torch.arange(mul_in) * d
+                cols = offsets_out[o] + torch.arange(mul_out) * d
+                weight = dense[rows][:, cols].t().float().contiguous()   # [out, in]
+                if weight.abs().max() == 0:
+                    continue
+                scales = (weight.abs().amax(dim=1) / 127.0).clamp_min(1e-12).double()
+                qweight = torch.quantize_per_channel(weight, scales, torch.zeros_like(scales, dtype=torch.long),
+                                                     axis=0, dtype=torch.qint8)
+                dequant = qweight.dequantize()
+                err = float((dequant - weight).norm() / weight.norm())
+                self.weight_error = max(self.weight_error, err)
+                self.register_buffer(f"qweight_{len(self.paths)}", qweight)
+                self.register_buffer(f"weight_{len(self.paths)}", dequant)
+                self.paths.append((offsets_in[i], mul_in, o, mul_out, d))
+        self.out_dims = [mul * ir.dim for mul, ir in self.irreps_out]
+
+    def __getstate__(self):
+        # Prepacked weights are rebuilt from the buffers after a copy
+        state = self.__dict__.copy()
+        state["_packed"] = None
+        return state
+
+    def _apply(self, fn, *args, **kwargs):
+        self._packed = None
+        return super()._apply(fn, *args, **kwargs)
+
+    def _packed_weights(self):
+        """fbgemm/qnnpack prepacked weights of every path, built on first use"""
+        if self._packed is None:
+            self._packed = [torch.ops.quantized.linear_prepack(getattr(self, f"qweight_{k}"), None)
+                            for k in range(len(self.paths))]
+        return self._packed
+
+    @staticmethod
+    def _offsets(irreps):
+        offsets, total = [], 0
+        for mul, ir in irreps:
+            offsets.append(total)
+            total += mul * ir.dim
+        return offsets
+
+    def forward(self, x):
+        shape, dtype = x.shape[:-1], x.dtype
+        x = x.reshape(-1, self.irreps_in.dim).float()
+        n = x.shape[0]
+        parts = [None] * len(self.out_dims)
+        for k, ((offset, mul_in, o, mul_out, d), packed) in enumerate(zip(self.paths, self._packed_weights())):
+            weight = getattr(self, f"weight_{k}").float()
+            xi = x[:, offset:offset + mul_in * d].reshape(n, mul_in, d).transpose(1, 2).reshape(n * d, mul_in)
+            y = _Int8MatmulFunction.apply(xi, packed, weight, self.reduce_range)
+            y = y.reshape(n, d, mul_out).transpose(1, 2).reshape(n, mul_out * d)
+            parts[o] = y if parts[o] is None else parts[o] + y
+        out = torch.cat([p if p is not None else x.new_zeros(n, dim)
+                         for p, dim in zip(parts, self.out_dims)], dim=-1)
+        if self.bias is not None:
+            out = out + self.bias
+        return out.to(dtype).reshape(*shape, -1)
+
+
+def enable_int8(model):
+    """Quantize the o3.Linear layers of the interaction, product and readout
+    blocks; returns [(module name, relative weight error)]"""
+    from e3nn import o3
+
+    if next(model.parameters()).dtype != torch.float32:
+        raise ValueError("int8 mode needs a float32 model")
+    _select_quantized_engine()
+
+    report = []
+    for root_name in ("interactions", "products", "readouts"):
+        root = getattr(model, root_name)
+        targets = [(name, m) for name, m in root.named_modules() if isinstance(m, o3.Linear)]
+        for name, module in targets:
+            parent = root
+            *path, leaf = name.split(".")
+            for part in path:
+                parent = getattr(parent, part)
+            quantized = Int8Linear(module)
+            setattr(parent, leaf, quantized)
+            report.append((f"{root_name}.{name}", quantized.weight_error))
+    model.int8_report = report
+    return report
+
+
+# ============================================================
+# Resident systems and in-library molecular dynamics
+# ============================================================
+
+def _node_attrs(calculator, numbers, dtype, device):
+    """One-hot species encoding [n, num_elements] of the model's z table"""
+    zs = [int(z) for z in calculator.z_table.zs]
+    index = {z: i for i, z in enumerate(zs)}
+    try:
+        species = [index[int(z)] for z in numbers]
+    except KeyError as e:
+        raise ValueError(f"Atomic number {e.args[0]} is not supported by this model") from None
+    node_attrs = torch.zeros(len(species), len(zs), dtype=dtype, device=device)
+    node_attrs[torch.arange(len(species)), torch.tensor(species, dtype=torch.long)] = 1.0
+    return node_attrs
+
+
+class ResidentSystem:
+    """Model inputs for one structure kept as tensors between evaluations
+
+    The neighbor list is built with cutoff r_max + skin and reused until
+    atoms (or cell vectors) have moved far enough to invalidate it. Edges
+    beyond r_max are exact zeros of the polynomial cutoff, so results match
+    a fresh neighbor list.
+    """
+
+    def __init__(self, session, atomic_numbers, positions, cell=None, pbc=None, skin=0.5):
+        self.session = session
+        self.skin = float(skin)
+        self.numbers = np.asarray(atomic_numbers, dtype=np.int64)
+        # float32 coordinates stay float32 so a float32 model takes them unconverted
+        coordinates = np.float32 if np.asarray(positions).dtype == np.float32 else np.float64
+        self.positions = np.array(positions, dtype=coordinates).reshape(-1, 3)
+        self.pbc = np.array(pbc if pbc is not None else [False] * 3, dtype=bool)
+        self.cell = np.array(cell if cell is not None else np.zeros((3, 3)), dtype=np.float64).reshape(3, 3)
+        self.neighbor_builds = 0
+        self._edges = None
+        self._inputs = {}
+
+    @property
+    def num_atoms(self):
+        return len(self.numbers)
+
+    def update(self, positions=None, cell=None):
+        if positions is not None:
+            self.positions = np.array(positions, dtype=np.float64).reshape(-1, 3)
+        if cell is not None:
+            self.cell = np.array(cell, dtype=np.float64).reshape(3, 3)
+
+    def _needs_rebuild(self):
+        if self._edges is None:
+            return True
+        ref_positions, ref_cell, max_shift = self._edges["reference"]
+        drift = 2.0 * np.linalg.norm(self.positions - ref_positions, axis=1).max(initial=0.0)
+        drift += max_shift * np.linalg.norm(self.cell - ref_cell, axis=1).max()
+        return drift > self.skin
+
+    def _build_neighbors(self, r_max):
+        from mace.data.neighborhood import get_neighborhood
+
+        cell = self.cell if self.pbc.any() else None
+        edge_index, _, unit_shifts, *_ = get_neighborhood(
+            positions=self.positions.astype(np.float64, copy=False), cutoff=r_max + self.skin,
+            pbc=tuple(self.pbc), cell=cell)
+        max_shift = float(np.linalg.norm(unit_shifts, axis=1).max(initial=0.0))
+        self._edges = {
+            "edge_index": edge_index,
+            "unit_shifts": unit_shifts,
+            "reference": (self.positions.copy(), self.cell.copy(), max_shift),
+        }
+        self._inputs = {}
+        self.neighbor_builds += 1
+
+    def _static_inputs(self, calculator, dtype, device):
+        key = (id(calculator), dtype)
+        if key not in self._inputs:
+            self._inputs[key] = {
+                "node_attrs": _node_attrs(calculator, self.numbers, dtype, device),
+                "edge_index": torch.as_tensor(self._edges["edge_index"], dtype=torch.long, device=device),
+                "unit_shifts": torch.as_tensor(self._edges["unit_shifts"], dtype=dtype, device=device),
+                "batch": torch.zeros(self.num_atoms, dtype=torch.long, device=device),
+                "ptr": torch.tensor([0, self.num_atoms], dtype=torch.long, device=device),
+                "head": torch.zeros(1, dtype=torch.long, device=device),
+            }
+        return self._inputs[key]
+
+    def model_inputs(self, calculator, dtype, device):
+        """Input dict for `calculator`'s model at the current coordinates"""
+        if self._needs_rebuild():
+            self._build_neighbors(float(calculator.r_max))
+
+        data = dict(self._static_inputs(calculator, dtype, device))
+        cell = torch.as_tensor(self.cell, dtype=dtype, device=device)
+        data["positions"] = torch.as_tensor(self.positions, dtype=dtype, device=device)
+        data["cell"] = cell
+        data["shifts"] = data["unit_shifts"] @ cell
+        return data
+
+    def edge_vectors(self, r_max):
+        """Senders, receivers and edge vectors [E, 3] of the skin neighbor list"""
+        if self._needs_rebuild():
+            self._build_neighbors(r_max)
+        senders, receivers = self._edges["edge_index"]
+        vectors = (self.positions[receivers] - self.positions[senders]
+                   + self._edges["unit_shifts"] @ self.cell)
+        return senders, receivers, vectors
+
+    def evaluate(self, compute_force=True, compute_stress=False):
+        """Run the model on the current coordinates; returns the raw output dict"""
+        precision = self.session._choose_precision()
+        calculator = self.session.calculator(precision)
+        model = calculator.models[0]
+        param = next(model.parameters())
+        data = self.model_inputs(calculator, param.dtype, param.device)
+
+        with _default_dtype(_TORCH_DTYPES[precision]):
+            if compute_force:
+                out = model(data, training=False, compute_force=True, compute_stress=compute_stress)
+            else:
+                with torch.no_grad():
+                    out = model(data, training=False, compute_force=False)
+        self.session.active = precision
+        return out
+
+    def compute(self, compute_stress=False):
+        """Energy (eV), forces [n, 3] (eV/A) and, if requested, stress (Voigt-6, eV/A^3)"""
+        compute_stress = compute_stress and bool(self.pbc.all())
+        out = self.evaluate(compute_force=True, compute_stress=compute_stress)
+
+        energy = float(out["energy"].detach().sum())
+        forces = out["forces"].detach().cpu().double().numpy()
+        stress = None
+        if compute_stress and out.get("stress") is not None:
+            from ase.stress import full_3x3_to_voigt_6_stress
+            stress = full_3x3_to_voigt_6_stress(out["stress"].detach().cpu().double().numpy()[0])
+
+        self.session.last_fmax = float(np.linalg.norm(forces, axis=1).max(initial=0.0))
+        return energy, forces, stress
+
+    def node_energies(self):
+        """Per-atom energies [n] in eV (no gradients)"""
+        out = self.evaluate(compute_force=False)
+        return out["node_energy"].detach().cpu().double().numpy()
+
+    def compute_atomic(self, virials=False):
+        """Energy, forces, per-atom energies [n] and, if requested, per-atom
+        virials [n, 3, 3] (eV) from a single backward pass
+
+        The edge shifts enter the model only through the edge vectors r_e, so
+        their gradient is dE/dr_e. Each edge virial -r_e (x) dE/dr_e is split
+        evenly between its two atoms; the atom sum is the total virial
+        -dE/d(strain) whose negative over the volume is the stress.
+        """
+        precision = self.session._choose_precision()
+        calculator = self.session.calculator(precision)
+        model = calculator.models[0]
+        param = next(model.parameters())
+        data = self.model_inputs(calculator, param.dtype, param.device)
+        positions = data["positions"].clone().requires_grad_(True)
+        shifts = data["shifts"].clone().requires_grad_(virials)
+        data["positions"], data["shifts"] = positions, shifts
+
+        with _default_dtype(_TORCH_DTYPES[precision]), torch.enable_grad():
+            out = model(data, training=False, compute_force=False)
+            node_energy = out["node_energy"]
+            grads = torch.autograd.grad(node_energy.sum(), [positions, shifts] if virials else [positions])
+        self.session.active = precision
+
+        forces = -grads[0].detach().cpu().double().numpy()
+        atom_virials = None
+        if virials:
+            atom_virials = _atom_virials(data["edge_index"], positions, shifts, grads[1], self.num_atoms)
+
+        self.session.last_fmax = float(np.linalg.norm(forces, axis=1).max(initial=0.0))
+        node_energy = node_energy.detach().cpu().double().numpy()
+        return float(node_energy.sum()), forces, node_energy, atom_virials
+
+    @contextlib.contextmanager
+    def _gradient_graph(self):
+        """Positions leaf and dE/dx [n, 3] with its graph kept for a second
+        backward pass; float64, on the model's own edge modules since the
+        native kernels are first order only"""
+        calculator = self.session.gradient_calculator()
+        model = calculator.models[0]
+        param = next(model.parameters())
+        native = self.session.native_edge_features
+        if native:
+            _swap_edge_modules(model, False)
+        try:
+            data = self.model_inputs(calculator, param.dtype, param.device)
+            positions = data["positions"].clone().requires_grad_(True)
+            data["positions"] = positions
+            with _default_dtype(torch.float64), torch.enable_grad():
+                out = model(data, training=False, compute_force=False)
+                grad, = torch.autograd.grad(out["energy"].sum(), positions, create_graph=True)
+                yield positions, grad
+        finally:
+            if native:
+                _swap_edge_modules(model, True)
+
+    def hessian(self, batch=32):
+        """Forces [n, 3] and Hessian [3n, 3n] (eV/A^2) by double backward
+
+        Rows are taken in batches of unit vectors with batched gradients, so
+        the matrix costs about 3n / batch backward passes; models whose
+        operations cannot be batched fall back to one row per pass.
+        """
+        n3 = 3 * self.num_atoms
+        rows = []
+        with self._gradient_graph() as (positions, grad):
+            flat = grad.reshape(-1)
+            eye = torch.eye(n3, dtype=flat.dtype, device=flat.device)
+            try:
+                for start in range(0, n3, batch):
+                    block, = torch.autograd.grad(flat, positions, grad_outputs=eye[start:start + batch],
+                                                 retain_graph=True, is_grads_batched=True)
+                    rows.append(block.reshape(-1, n3))
+            except RuntimeError:
+                rows = [torch.autograd.grad(flat, positions, grad_outputs=e, retain_graph=True)[0].reshape(1, n3)
+                        for e in eye]
+            forces = -grad.detach().cpu().numpy()
+        h = torch.cat(rows).cpu().numpy()
+        return forces, 0.5 * (h + h.T)
+
+    def hessian_vector_product(self, vectors):
+        """Forces [n, 3] and products H v [k, n, 3] for k vectors [k, n, 3],
+        one double backward each"""
+        with self._gradient_graph() as (positions, grad):
+            vectors = torch.as_tensor(np.asarray(vectors, dtype=np.float64).reshape(-1, self.num_atoms, 3),
+                                      device=grad.device)
+            products = [torch.autograd.grad(grad, positions, grad_outputs=v, retain_graph=True)[0]
+                        for v in vectors]
+            forces = -grad.detach().cpu().numpy()
+        if not products:
+            return forces, np.zeros((0, self.num_atoms, 3))
+        return forces, torch.stack(products).cpu().numpy()
+
+
+class ExtrapolationStats:
+    """Counters of a ForceExtrapolator, accumulated per session"""
+
+    def __init__(self):
+        self.evaluations = 0
+        self.skipped = 0
+        self.checks = 0
+        self.max_error = 0.0
+        self.sum_sq_error = 0.0
+
+    @property
+    def skip_ratio(self):
+        total = self.evaluations + self.skipped
+        return self.skipped / total if total else 0.0
+
+    @property
+    def rms_error(self):
+        return math.sqrt(self.sum_sq_error / self.checks) if self.checks else 0.0
+
+
+class ForceExtrapolator:
+    """Predicts energies and forces from the last model evaluations
+
+    Each call is one step. Energy and forces are extrapolated with the
+    Lagrange polynomial through the last order+1 evaluations, as functions
+    of the cumulative path length |dx| travelled by the coordinates, so
+    uneven steps (FIRE's adaptive dt, relaxation step control) are handled
+    like the fixed steps of MD. The error
+    estimate is the largest atomic force difference from the order-1
+    polynomial through the newest points. The model is called when that
+    estimate exceeds force_tol (eV/A), when any atom moved more than
+    max_displacement (A) since the last evaluation, or after max_skip
+    consecutive predictions. The last case is a check: its prediction is
+    compared with the model and the error recorded in the stats.
+    """
+
+    def __init__(self, force_tol, max_displacement=0.1, max_skip=10, order=2, stats=None):
+        self.force_tol = force_tol
+        self.max_displacement = max_displacement
+        self.max_skip = max_skip
+        self.order = order
+        self.stats = stats if stats is not None else ExtrapolationStats()
+        self.history = []
+        self.path = 0.0
+        self.previous = None
+        self.run = 0
+
+    @staticmethod
+    def _lagrange(history, t):
+        times = [h[0] for h in history]
+        energy, forces = 0.0, 0.0
+        for j, (tj, _, ej, fj) in enumerate(history):
+            w = 1.0
+            for k, tk in enumerate(times):
+                if k != j:
+                    w *= (t - tk) / (tj - tk)
+            energy = energy + w * ej
+            forces = forces + w * fj
+        return energy, forces
+
+    def _predict(self, t):
+        energy, forces = self._lagrange(self.history, t)
+        _, lower = self._lagrange(self.history[1:], t)
+        error = float(np.linalg.norm(forces - lower, axis=1).max(initial=0.0))
+        return energy, forces, error
+
+    def __call__(self, system):
+        """Energy and forces at the system's current coordinates"""
+        if self.previous is not None:
+            self.path += float(np.linalg.norm(system.positions - self.previous))
+        self.previous = system.positions.copy()
+        t = self.path
+        if self.history and t == self.history[-1][0]:
+            return self.history[-1][2], self.history[-1][3]
+
+        prediction = None
+        if len(self.history) == self.order + 1:
+            moved = np.linalg.norm(system.positions - self.history[-1][1], axis=1).max(initial=0.0)
+            if moved <= self.max_displacement:
+                prediction = self._predict(t)
+                if prediction[2] <= self.force_tol and self.run < self.max_skip:
+                    self.run += 1
+                    self.stats.skipped += 1
+                    return float(prediction[0]), prediction[1]
+
+        energy, forces, _ = system.compute()
+        self.stats.evaluations += 1
+        if prediction is not None and prediction[2] <= self.force_tol:
+            error = float(np.linalg.norm(prediction[1] - forces, axis=1).max(initial=0.0))
+            self.stats.checks += 1
+            self.stats.max_error = max(self.stats.max_error, error)
+            self.stats.sum_sq_error += error ** 2
+        self.history = (self.history + [(t, system.positions.copy(), energy, forces)])[-(self.order + 1):]
+        self.run = 0
+        return energy, forces
+
+
+class _ResidentCalculator(Calculator):
+    """ASE calculator backed by a ResidentSystem (same atoms, changing coordinates)"""
+
+    implemented_properties = ["energy", "free_energy", "forces", "stress"]
+
+    def __init__(self, system, extrapolator=None):
+        super().__init__()
+        self.system = system
+        self.extrapolator = extrapolator
+
+    def calculate(self, atoms=None, properties=("energy",), system_changes=all_changes):
+        super().calculate(atoms, properties, system_changes)
+        self.system.update(self.atoms.get_positions(), self.atoms.get_cell().array)
+        if self.extrapolator is not None and "stress" not in properties:
+            energy, forces = self.extrapolator(self.system)
+            stress = None
+        else:
+            energy, forces, stress = self.system.compute(compute_stress="stress" in properties)
+        self.results = {"energy": energy, "free_energy": energy, "forces": forces}
+        if stress is not None:
+            self.results["stress"] = stress
+
+
+class _StopRun(Exception):
+    pass
 
-    positions = np.array(positions, dtype=np.float64)
-    atomic_numbers = np.array(atomic_numbers, dtype=np.int32)
 
-    atoms = Atoms(
-        numbers=atomic_numbers,
-        positions=positions,
-        cell=cell,
-        pbc=pbc if pbc is not None else [False, False, False]
-    )
+def _make_integrator(atoms, integrator, timestep, temperature, friction, thermostat_time, rng):
+    from ase import units
 
-    atoms.calc = _calculator
+    dt = timestep * units.fs
+    if integrator == "verlet":
+        from ase.md.verlet import VelocityVerlet
+        return VelocityVerlet(atoms, timestep=dt)
+    if integrator == "langevin":
+        from ase.md.langevin import Langevin
+        return Langevin(atoms, timestep=dt, temperature_K=temperature,
+                        friction=friction / units.fs, rng=rng)
+    if integrator in ("nose-hoover", "nosehoover", "nvt"):
+        tdamp = (thermostat_time if thermostat_time > 0 else 100.0 * timestep) * units.fs
+        try:
+            from ase.md.nose_hoover_chain import NoseHooverChainNVT
+            return NoseHooverChainNVT(atoms, timestep=dt, temperature_K=temperature, tdamp=tdamp)
+        except ImportError:
+            # Older ASE: NPT without a barostat is single-thermostat Nose-Hoover NVT
+            from ase.md.npt import NPT
+            return NPT(atoms, timestep=dt, temperature_K=temperature, externalstress=0.0,
+                       ttime=tdamp, pfactor=None)
+    raise ValueError(f"Unknown integrator '{integrator}', expected verlet, langevin or nose-hoover")
 
-    energy = atoms.get_potential_energy()
-    forces = atoms.get_forces()
+
+def run_md(session, atomic_numbers, positions, velocities, cell, pbc, n_steps,
+           integrator="verlet", timestep=1.0, temperature=300.0, friction=0.01,
+           thermostat_time=0.0, callback=None, stride=1, seed=None):
+    """Integrate n_steps inside the library
+
+    Velocities are in A/fs (None draws Maxwell-Boltzmann velocities at
+    `temperature`). callback(step, positions, velocities, forces, energy)
+    is called every `stride` steps, including step 0, and may return True to
+    stop early. Returns the final state and the number of steps taken.
+    `seed` drives the initial velocities and the Langevin noise, so a fixed
+    seed reproduces the trajectory.
+    With session.set_force_extrapolation() some steps use predicted forces.
+    """
+    from ase import units
+    from ase.md.velocitydistribution import MaxwellBoltzmannDistribution, Stationary
+
+    rng = np.random.default_rng(seed)
+    system = ResidentSystem(session, atomic_numbers, positions, cell, pbc)
+    atoms = Atoms(numbers=atomic_numbers, positions=system.positions,
+                  cell=system.cell if system.pbc.any() else None, pbc=system.pbc)
+    if velocities is not None:
+        atoms.set_velocities(np.asarray(velocities, dtype=np.float64).reshape(-1, 3) / units.fs)
+    else:
+        MaxwellBoltzmannDistribution(atoms, temperature_K=temperature, rng=rng)
+        Stationary(atoms)
+    atoms.calc = _ResidentCalculator(system, session._make_extrapolator())
+
+    dyn = _make_integrator(atoms, integrator, timestep, temperature, friction, thermostat_time, rng)
+
+    def observe():
+        if callback is None:
+            return
+        stop = callback(dyn.nsteps, atoms.get_positions(), atoms.get_velocities() * units.fs,
+                        atoms.get_forces(), atoms.get_potential_energy())
+        if stop:
+            raise _StopRun()
+
+    if callback is not None and stride > 0:
+        dyn.attach(observe, interval=stride)
+
+    try:
+        dyn.run(n_steps)
+    except _StopRun:
+        pass
+
+    return {
+        "positions": atoms.get_positions(),
+        "velocities": atoms.get_velocities() * units.fs,
+        "forces": atoms.get_forces(),
+        "energy": float(atoms.get_potential_energy()),
+        "steps": int(dyn.nsteps),
+        "neighbor_builds": system.neighbor_builds,
+    }
+
+
+def relax(session, atomic_numbers, positions, cell, pbc, method="fire", fmax=0.05,
+          max_steps=500, relax_cell=False):
+    """Geometry optimization next to the model
+
+    method is "fire" or "lbfgs". With relax_cell the cell is optimized too
+    (FrechetCellFilter, periodic systems only) and fmax also bounds the
+    stress in eV/A^3. Returns the final state, step count and convergence.
+    Force extrapolation, if enabled, is used with FIRE only: LBFGS builds
+    its curvature model from force differences, which predicted forces
+    would corrupt, and cell relaxation needs the stress. Convergence is
+    always confirmed with model forces.
+    """
+    from ase.optimize import FIRE, LBFGS
+
+    optimizers = {"fire": FIRE, "lbfgs": LBFGS}
+    if method.lower() not in optimizers:
+        raise ValueError(f"Unknown optimizer '{method}', expected fire or lbfgs")
+
+    system = ResidentSystem(session, atomic_numbers, positions, cell, pbc)
+    atoms = Atoms(numbers=atomic_numbers, positions=system.positions,
+                  cell=system.cell if system.pbc.any() else None, pbc=system.pbc)
+    extrapolator = session._make_extrapolator() if method.lower() == "fire" else None
+    atoms.calc = _ResidentCalculator(system, extrapolator)
+
+    target = atoms
+    if relax_cell:
+        if not system.pbc.all():
+            raise ValueError("Cell relaxation needs a fully periodic system")
+        try:
+            from ase.filters import FrechetCellFilter
+        except ImportError:
+            from ase.constraints import ExpCellFilter as FrechetCellFilter
+        target = FrechetCellFilter(atoms)
+
+    optimizer = optimizers[method.lower()](target, logfile=None)
+    converged = bool(optimizer.run(fmax=fmax, steps=max_steps))
+    if atoms.calc.extrapolator is not None:
+        # Convergence must hold for model forces, not extrapolated ones
+        atoms.calc.extrapolator = None
+        atoms.calc.results = {}
+        converged = bool(optimizer.run(fmax=fmax, steps=max(max_steps - optimizer.nsteps, 0)))
+
+    return {
+        "positions": atoms.get_positions(),
+        "cell": atoms.get_cell().array,
+        "forces": atoms.get_forces(),
+        "energy": float(atoms.get_potential_energy()),
+        "steps": int(optimizer.nsteps),
+        "converged": converged,
+        "neighbor_builds": system.neighbor_builds,
+    }
+
+
+# ============================================================
+# Multiple time stepping (RESPA)
+# ============================================================
+
+def _pair_basis(lengths, r_cut, num_basis, p):
+    """Cutoff-weighted Bessel basis [E, num_basis] and its r-derivative"""
+    if _mace_native is not None:
+        basis, dbasis = _mace_native.bessel_basis(lengths, r_cut, num_basis, True)
+        env, denv = _mace_native.polynomial_cutoff(lengths, r_cut, p, True)
+    else:
+        k = np.arange(1, num_basis + 1) * np.pi / r_cut
+        r = lengths[:, None]
+        pref = np.sqrt(2.0 / r_cut)
+        basis = pref * np.sin(k * r) / r
+        dbasis = pref * (k * np.cos(k * r) / r - np.sin(k * r) / r ** 2)
+        x = lengths / r_cut
+        env = (1.0 - (p + 1.0) * (p + 2.0) / 2.0 * x ** p + p * (p + 2.0) * x ** (p + 1)
+               - p * (p + 1.0) / 2.0 * x ** (p + 2))
+        denv = (-(p + 1.0) * (p + 2.0) / 2.0 * p * x ** (p - 1) + p * (p + 2.0) * (p + 1.0) * x ** p
+                - p * (p + 1.0) / 2.0 * (p + 2.0) * x ** (p + 1)) / r_cut
+        inside = lengths < r_cut
+        env, denv = env * inside, denv * inside
+    radial = basis * env[:, None]
+    dradial = dbasis * env[:, None] + basis * denv[:, None]
+    return radial, dradial
+
+
+class PairPotential:
+    """Species-pair radial potential used as the fast force of RESPA
+
+    E = 1/2 sum over directed edges of sum_b c[pair, b] R_b(r), with R_b the
+    Bessel basis times the polynomial cutoff at r_cut. Coefficients are
+    fitted by ridge least squares to MACE forces; evaluation runs in the
+    library's native kernel when available.
+    """
+
+    def __init__(self, atomic_numbers, r_cut=4.0, num_basis=8, p=6):
+        self.r_cut = float(r_cut)
+        self.num_basis = int(num_basis)
+        self.p = int(p)
+        zs, species = np.unique(np.asarray(atomic_numbers), return_inverse=True)
+        self.species = species
+        count = len(zs)
+        table = np.zeros((count, count), dtype=np.int64)
+        pairs = [(a, b) for a in range(count) for b in range(a, count)]
+        for t, (a, b) in enumerate(pairs):
+            table[a, b] = table[b, a] = t
+        self.pair_table = table
+        self.coefficients = np.zeros((len(pairs), self.num_basis))
+
+    def _edges(self, system, r_max):
+        senders, receivers, vectors = system.edge_vectors(r_max)
+        types = self.pair_table[self.species[senders], self.species[receivers]]
+        return senders, receivers, vectors, types
+
+    def _design(self, system, r_max):
+        """Matrix mapping flattened coefficients to forces [3n, pairs*basis]"""
+        senders, receivers, vectors, types = self._edges(system, r_max)
+        lengths = np.linalg.norm(vectors, axis=1)
+        _, dradial = _pair_basis(lengths, self.r_cut, self.num_basis, self.p)
+        n, cols = system.num_atoms, self.coefficients.size
+        design = np.zeros((n, 3, cols))
+        grad = 0.5 * dradial[:, None, :] * (vectors / lengths[:, None])[:, :, None]
+        col = types[:, None] * self.num_basis + np.arange(self.num_basis)
+        for k in range(3):
+            for b in range(self.num_basis):
+                np.add.at(design[:, k], (receivers, col[:, b]), -grad[:, k, b])
+                np.add.at(design[:, k], (senders, col[:, b]), grad[:, k, b])
+        return design.reshape(3 * n, cols)
+
+    def fit(self, system, frames=4, rattle=0.05, seed=0):
+        """Fit to MACE forces at the current and `frames` rattled coordinates"""
+        r_max = float(system.session.resident_calculator().r_max)
+        rng = np.random.default_rng(seed)
+        start = system.positions.copy()
+        rows, targets = [], []
+        for k in range(frames + 1):
+            shift = 0.0 if k == 0 else rng.normal(scale=rattle, size=start.shape)
+            system.update(start + shift)
+            _, forces, _ = system.compute()
+            rows.append(self._design(system, r_max))
+            targets.append(forces.ravel())
+        system.update(start)
+
+        a, y = np.concatenate(rows), np.concatenate(targets)
+        normal = a.T @ a
+        ridge = 1e-6 * np.trace(normal) / max(len(normal), 1)
+        coefficients = np.linalg.solve(normal + ridge * np.eye(len(normal)), a.T @ y)
+        self.coefficients = coefficients.reshape(self.coefficients.shape)
+        return self
+
+    def compute(self, system, r_max):
+        """Energy (eV) and forces [n, 3] (eV/A) at the system's coordinates"""
+        senders, receivers, vectors, types = self._edges(system, r_max)
+        if _mace_native is not None:
+            energy, forces = _mace_native.pair_potential(
+                vectors, senders.astype(np.int64), receivers.astype(np.int64), types,
+                self.coefficients, system.num_atoms, self.r_cut, self.p)
+            return float(energy), np.asarray(forces)
+
+        lengths = np.linalg.norm(vectors, axis=1)
+        radial, dradial = _pair_basis(lengths, self.r_cut, self.num_basis, self.p)
+        c = self.coefficients[types]
+        energy = 0.5 * float(np.sum(c * radial))
+        grad = (0.5 * np.sum(c * dradial, axis=1) / lengths)[:, None] * vectors
+        forces = np.zeros((system.num_atoms, 3))
+        np.add.at(forces, receivers, -grad)
+        np.add.at(forces, senders, grad)
+        return energy, forces
+
+
+def run_respa(session, atomic_numbers, positions, velocities, cell, pbc, n_steps,
+              integrator="verlet", timestep=1.0, temperature=300.0, friction=0.01,
+              respa_steps=4, inner=None, inner_cutoff=0.0, fit_frames=4,
+              callback=None, stride=1, seed=None):
+    """Impulse multiple time stepping (r-RESPA) with MACE as the slow force
+
+    Each of the n_steps outer steps evaluates MACE once and takes
+    `respa_steps` velocity Verlet steps of length `timestep` (fs) on a cheap
+    inner force; the MACE minus inner force is applied as a half kick at
+    both ends of the outer step. `inner` is another MACESession (e.g. a
+    smaller model) or None for a PairPotential fitted to MACE forces at the
+    start. "langevin" applies the thermostat on the inner steps (BAOAB).
+    callback(step, positions, velocities, forces, energy) sees MACE forces
+    and energies every `stride` outer steps and may return True to stop.
+    """
+    from ase import units
+    from ase.data import atomic_masses
+
+    if integrator not in ("verlet", "langevin"):
+        raise ValueError(f"RESPA supports verlet or langevin, not '{integrator}'")
+    respa_steps = max(int(respa_steps), 1)
+    rng = np.random.default_rng(seed)
+
+    outer = ResidentSystem(session, atomic_numbers, positions, cell, pbc)
+    masses = atomic_masses[outer.numbers][:, None]
+    accel = units.fs ** 2 / masses  # (eV/A)/amu -> A/fs^2
+    kT = units.kB * temperature
+
+    if velocities is not None:
+        v = np.array(velocities, dtype=np.float64).reshape(-1, 3)
+    else:
+        v = rng.normal(size=outer.positions.shape) * np.sqrt(kT / masses) * units.fs
+        v -= (masses * v).sum(axis=0) / masses.sum()
+
+    if inner is None:
+        r_max = float(session.resident_calculator().r_max)
+        r_cut = inner_cutoff if inner_cutoff > 0 else min(4.0, r_max)
+        pair = PairPotential(outer.numbers, r_cut=min(r_cut, r_max))
+        pair.fit(outer, frames=fit_frames if fit_frames > 0 else 4, seed=0 if seed is None else seed)
+        fast_system = outer
+
+        def fast_forces():
+            return pair.compute(fast_system, r_max)[1]
+    else:
+        fast_system = ResidentSystem(inner, atomic_numbers, outer.positions, cell, pbc)
+
+        def fast_forces():
+            fast_system.update(outer.positions)
+            return fast_system.compute()[1]
+
+    energy, forces, _ = outer.compute()
+    fast = fast_forces()
+    slow = forces - fast
+    dt, big_dt = timestep, timestep * respa_steps
+    c1 = np.exp(-friction * dt)
+    c2 = np.sqrt((1.0 - c1 ** 2) * kT / masses) * units.fs
+
+    step = 0
+    if callback is not None and stride > 0 and callback(0, outer.positions.copy(), v.copy(), forces, energy):
+        n_steps = 0
+    while step < n_steps:
+        v += 0.5 * big_dt * slow * accel
+        for _ in range(respa_steps):
+            v += 0.5 * dt * fast * accel
+            if integrator == "langevin":
+                outer.update(outer.positions + 0.5 * dt * v)
+                v = c1 * v + c2 * rng.normal(size=v.shape)
+                outer.update(outer.positions + 0.5 * dt * v)
+            else:
+                outer.update(outer.positions + dt * v)
+            fast = fast_forces()
+            v += 0.5 * dt * fast * accel
+        energy, forces, _ = outer.compute()
+        slow = forces - fast
+        v += 0.5 * big_dt * slow * accel
+        step += 1
+        if callback is not None and stride > 0 and step % stride == 0:
+            if callback(step, outer.positions.copy(), v.copy(), forces, energy):
+                break
 
     return {
-        'energy': float(energy),
-        'forces': forces.tolist()
+        "positions": outer.positions.copy(),
+        "velocities": v,
+        "forces": forces,
+        "energy": float(energy),
+        "steps": step,
+        "neighbor_builds": outer.neighbor_builds,
     }
+
+
+# ============================================================
+# Incremental Monte Carlo
+# ============================================================
+
+def receptive_field(session):
+    """Distance beyond which a displacement cannot change a node energy"""
+    calculator = session.resident_calculator()
+    return float(calculator.r_max) * len(calculator.models[0].interactions)
+
+
+def _lattice_frame(cell, pbc):
+    """Cell, its inverse and the lattice-plane spacing per axis; non-periodic
+    axes without a cell vector get a unit vector along that axis"""
+    cell = np.array(cell if cell is not None else np.zeros((3, 3)), dtype=np.float64).reshape(3, 3)
+    for a in range(3):
+        if np.linalg.norm(cell[a]) < 1e-9:
+            if pbc[a]:
+                raise ValueError("Periodic axis with a zero cell vector")
+            cell[a] = 0.0
+            cell[a, a] = 1.0
+    if abs(np.linalg.det(cell)) < 1e-9:
+        raise ValueError("Singular cell")
+    inv = np.linalg.inv(cell)
+    return cell, inv, 1.0 / np.linalg.norm(inv, axis=0)
+
+
+class _SpatialGrid:
+    """Bins of atom positions in fractional space for radius queries that
+    return every periodic image, so per-query cost is independent of N"""
+
+    def __init__(self, positions, cell, pbc, bin_size):
+        self.pbc = np.asarray(pbc, dtype=bool)
+        positions = np.asarray(positions, dtype=np.float64)
+        self.cell, self.inv, self.plane = _lattice_frame(cell, self.pbc)
+
+        frac = positions @ self.inv
+        self.lo = np.where(self.pbc, 0.0, frac.min(axis=0))
+        span = np.where(self.pbc, 1.0, np.maximum(frac.max(axis=0) - self.lo, 1e-6))
+        self.nbins = np.maximum(1, (span * self.plane / bin_size).astype(int))
+        self.width = span / self.nbins
+
+        self.wrapped = np.empty_like(positions)
+        self.bin_of = np.empty((len(positions), 3), dtype=int)
+        self.bins = {}
+        for i, p in enumerate(positions):
+            self._insert(i, p)
+
+    def _locate(self, position):
+        frac = position @ self.inv
+        shift = np.where(self.pbc, np.floor(frac), 0.0)
+        wrapped = position - shift @ self.cell
+        b = np.floor((frac - shift - self.lo) / self.width).astype(int)
+        return wrapped, np.clip(b, 0, self.nbins - 1)
+
+    def _insert(self, i, position):
+        wrapped, b = self._locate(position)
+        self.wrapped[i] = wrapped
+        self.bin_of[i] = b
+        self.bins.setdefault(tuple(b), []).append(i)
+
+    def move(self, i, position):
+        self.bins[tuple(self.bin_of[i])].remove(i)
+        self._insert(i, position)
+
+    def query(self, center, radius):
+        """{(atom, image shift): position} for all images within radius"""
+        center, base = self._locate(np.asarray(center, dtype=np.float64))
+        reach = np.ceil(radius / self.plane / self.width).astype(int)
+        ranges = []
+        for a in range(3):
+            if self.pbc[a]:
+                ranges.append(range(base[a] - reach[a], base[a] + reach[a] + 1))
+            else:
+                ranges.append(range(max(0, base[a] - reach[a]), min(self.nbins[a], base[a] + reach[a] + 1)))
+
+        found = {}
+        r2 = radius * radius
+        for b0 in ranges[0]:
+            for b1 in ranges[1]:
+                for b2 in ranges[2]:
+                    k = np.array([b0, b1, b2])
+                    shift = np.where(self.pbc, np.floor_divide(k, self.nbins), 0)
+                    members = self.bins.get(tuple(k - shift * self.nbins))
+                    if not members:
+                        continue
+                    members = np.asarray(members)
+                    p = self.wrapped[members] + shift @ self.cell
+                    d = p - center
+                    inside = np.einsum("ij,ij->i", d, d) < r2
+                    image = tuple(int(x) for x in shift)
+                    for j, q in zip(members[inside], p[inside]):
+                        found[(int(j), image)] = q
+        return found
+
+
+def _batch_graph(session, structures):
+    """Model, precision, input dict and node offsets for several structures
+
+    structures is a list of (numbers, positions, cell, pbc); their graphs are
+    concatenated into a single disjoint batch as in MACE's data loader.
+    """
+    precision = session._choose_precision()
+    calculator = session.calculator(precision)
+    model = calculator.models[0]
+    param = next(model.parameters())
+    dtype, device = param.dtype, param.device
+
+    parts = []
+    for numbers, positions, cell, pbc in structures:
+        system = ResidentSystem(session, numbers, positions, cell, pbc, skin=0.0)
+        parts.append(system.model_inputs(calculator, dtype, device))
+
+    sizes = [len(p["positions"]) for p in parts]
+    offsets = np.concatenate([[0], np.cumsum(sizes)])
+    data = {
+        "positions": torch.cat([p["positions"] for p in parts]),
+        "node_attrs": torch.cat([p["node_attrs"] for p in parts]),
+        "edge_index": torch.cat([p["edge_index"] + int(o) for p, o in zip(parts, offsets)], dim=1),
+        "shifts": torch.cat([p["shifts"] for p in parts]),
+        "unit_shifts": torch.cat([p["unit_shifts"] for p in parts]),
+        "cell": torch.cat([p["cell"] for p in parts]),
+        "batch": torch.repeat_interleave(torch.arange(len(parts), device=device),
+                                         torch.tensor(sizes, device=device)),
+        "ptr": torch.as_tensor(offsets, dtype=torch.long, device=device),
+        "head": torch.zeros(len(parts), dtype=torch.long, device=device),
+    }
+    return model, precision, data, offsets
+
+
+def batched_node_energies(session, structures):
+    """Per-atom energies of several structures in one model pass"""
+    model, precision, data, offsets = _batch_graph(session, structures)
+    with _default_dtype(_TORCH_DTYPES[precision]), torch.no_grad():
+        out = model(data, training=False, compute_force=False)
+    session.active = precision
+
+    energies = out["node_energy"].detach().cpu().double().numpy()
+    return [energies[offsets[k]:offsets[k + 1]] for k in range(len(structures))]
+
+
+def batched_energy_forces(session, structures):
+    """Energies [B] and per-structure forces of several structures in one model pass"""
+    model, precision, data, offsets = _batch_graph(session, structures)
+    with _default_dtype(_TORCH_DTYPES[precision]):
+        out = model(data, training=False, compute_force=True)
+    session.active = precision
+
+    energies = out["energy"].detach().cpu().double().numpy().reshape(-1)
+    forces = out["forces"].detach().cpu().double().numpy()
+    return energies, [forces[offsets[k]:offsets[k + 1]] for k in range(len(structures))]
+
+
+# ============================================================
+# Finite-displacement phonons
+# ============================================================
+
+def _crystal_symmetry(numbers, positions, cell, symprec):
+    """Space-group operations (rotations [k, 3, 3], translations [k, 3]) in
+    fractional coordinates; the identity alone when spglib is unavailable"""
+    identity = np.eye(3, dtype=int)[None], np.zeros((1, 3))
+    try:
+        import spglib
+    except ImportError:
+        return identity
+    frac = np.linalg.solve(cell.T, positions.T).T
+    symmetry = spglib.get_symmetry((cell, frac, numbers), symprec=symprec)
+    if symmetry is None:
+        return identity
+    return symmetry["rotations"], symmetry["translations"]
+
+
+def _atom_permutation(frac, numbers, cell, rotation, translation, symprec):
+    """perm[a] = atom that the operation carries atom a onto, or None"""
+    delta = (frac @ rotation.T + translation)[:, None, :] - frac[None, :, :]
+    delta -= np.rint(delta)
+    distance = np.linalg.norm(delta @ cell, axis=2)
+    perm = distance.argmin(axis=1)
+    if (distance[np.arange(len(frac)), perm] > symprec).any() or (numbers[perm] != numbers).any():
+        return None
+    if len(np.unique(perm)) != len(perm):
+        return None
+    return perm
+
+
+def _displacement_directions(rotations):
+    """Unit displacements of one atom, given the Cartesian rotations of its
+    site symmetry: x, y and z in turn as long as their images add a
+    direction, each with its opposite unless a rotation maps it there"""
+    directions, images, rank = [], np.zeros((0, 3)), 0
+    for d in np.eye(3):
+        extended = np.vstack([images] + [c @ d for c in rotations])
+        extended_rank = np.linalg.matrix_rank(extended, tol=1e-6)
+        if extended_rank == rank:
+            continue
+        images, rank = extended, extended_rank
+        directions.append(d)
+        if not any(np.allclose(c @ d, -d, atol=1e-6) for c in rotations):
+            directions.append(-d)
+        if rank == 3:
+            break
+    return directions
+
+
+def force_constants(session, atomic_numbers, positions, cell, displacement=0.01, symprec=1e-5,
+                    max_batch_atoms=20000):
+    """Force constants [3n, 3n] (eV/A^2) of a periodic supercell by finite
+    displacements; returns them and the number of displaced supercells
+
+    As in phonopy, only one atom per symmetry orbit is displaced, and only
+    along directions its site symmetry does not already relate: x, y, z in
+    turn until their images span space, and -d only when no site operation
+    maps d onto it (conventional fcc needs a single supercell). Displaced
+    supercells go through the model as batched graphs of up to
+    max_batch_atoms atoms. Each displaced atom's rows are the least-squares
+    fit F = -u Phi over all site-symmetry images of its displacements; the
+    set is closed under u -> -u, so this is a central difference. The rows
+    of the other atoms follow from the space-group operations,
+    Phi(g i, g j) = R Phi(i, j) R^T, and the result is symmetrized.
+    """
+    numbers = np.asarray(atomic_numbers, dtype=np.int64)
+    positions = np.asarray(positions, dtype=np.float64).reshape(-1, 3)
+    cell = np.asarray(cell, dtype=np.float64).reshape(3, 3)
+    n = len(numbers)
+    frac = np.linalg.solve(cell.T, positions.T).T
+
+    # Identity first, so every orbit is represented by its lowest index; it is
+    # not repeated, as every site operation must enter the row fits once
+    operations = [(np.arange(n), np.eye(3))]
+    for rotation, translation in zip(*_crystal_symmetry(numbers, positions, cell, symprec)):
+        perm = _atom_permutation(frac, numbers, cell, rotation, translation, symprec)
+        if perm is not None and not ((rotation == np.eye(3)).all() and (perm == np.arange(n)).all()):
+            operations.append((perm, cell.T @ rotation @ np.linalg.inv(cell.T)))
+    source = [None] * n
+    for a in range(n):
+        if source[a] is None:
+            for perm, cartesian in operations:
+                if source[perm[a]] is None:
+                    source[perm[a]] = (a, perm, cartesian)
+    representatives = [a for a in range(n) if source[a][0] == a]
+    stabilisers = {r: [(perm, c) for perm, c in operations if perm[r] == r] for r in representatives}
+
+    jobs = [(r, d) for r in representatives
+            for d in _displacement_directions([c for _, c in stabilisers[r]])]
+    per_batch = max(1, int(max_batch_atoms) // n)
+    forces = []
+    for start in range(0, len(jobs), per_batch):
+        structures = []
+        for r, d in jobs[start:start + per_batch]:
+            displaced = positions.copy()
+            displaced[r] += displacement * d
+            structures.append((numbers, displaced, cell, [True] * 3))
+        forces.extend(batched_energy_forces(session, structures)[1])
+
+    phi = np.zeros((n, n, 3, 3))
+    for r in representatives:
+        # Site operations carry displacement u of r with forces F to Ru, F'[perm j] = R F[j]
+        u, f = [], []
+        for (atom, d), computed in zip(jobs, forces):
+            if atom != r:
+                continue
+            for perm, cartesian in stabilisers[r]:
+                rotated = np.empty_like(computed)
+                rotated[perm] = computed @ cartesian.T
+                u.append(displacement * (cartesian @ d))
+                f.append(rotated)
+        phi[r] = -np.einsum("am,mjc->jac", np.linalg.pinv(np.array(u)), np.array(f))
+    for i in range(n):
+        r, perm, cartesian = source[i]
+        if r != i:
+            phi[i, perm] = np.einsum("ab,jbc,dc->jad", cartesian, phi[r], cartesian)
+    phi = 0.5 * (phi + phi.transpose(1, 0, 3, 2))
+    return phi.transpose(0, 2, 1, 3).reshape(3 * n, 3 * n), len(jobs)
+
+
+class MCState:
+    """Cached per-atom energies for local Monte Carlo moves
+
+    propose() recomputes only atoms whose energy can change: those within
+    the receptive field R (num_interactions * r_max) of a moved atom's old or
+    new position. They are evaluated on a non-periodic cluster holding every
+    atom image within 2R, which contains each of their full environments.
+    accept() commits the proposal into the cache, reject() discards it.
+    """
+
+    def __init__(self, session, atomic_numbers, positions, cell=None, pbc=None):
+        self.session = session
+        self.numbers = np.array(atomic_numbers, dtype=np.int64)
+        self.positions = np.array(positions, dtype=np.float64).reshape(-1, 3)
+        self.cell = np.array(cell if cell is not None else np.zeros((3, 3)), dtype=np.float64).reshape(3, 3)
+        self.pbc = np.array(pbc if pbc is not None else [False] * 3, dtype=bool)
+        self.radius = receptive_field(session) + 1e-6
+        self.node_energies = self._full_node_energies(self.numbers, self.positions)
+        self.grid = _SpatialGrid(self.positions, self.cell, self.pbc, self.radius)
+        self.pending = None
+        self.cluster_sizes = []
+
+    @property
+    def energy(self):
+        return float(self.node_energies.sum())
+
+    def _full_node_energies(self, numbers, positions):
+        system = ResidentSystem(self.session, numbers, positions, self.cell, self.pbc, skin=0.0)
+        return system.node_energies()
+
+    def _affected(self, centers, numbers):
+        """Core atom -> cluster index, and the cluster (numbers, positions)"""
+        points = {}
+        core = {}
+        for center in centers:
+            for key, p in self.grid.query(center, 2.0 * self.radius).items():
+                points.setdefault(key, p)
+            for key, p in self.grid.query(center, self.radius).items():
+                core.setdefault(key[0], key)
+        keys = list(points)
+        index = {key: i for i, key in enumerate(keys)}
+        cluster_numbers = numbers[[k[0] for k in keys]]
+        cluster_positions = np.array([points[k] for k in keys]).reshape(-1, 3)
+        return {atom: index[key] for atom, key in core.items()}, cluster_numbers, cluster_positions
+
+    def _prepare(self, indices, positions, numbers):
+        """Move the grid to a trial configuration and collect the structure
+        to evaluate: (indices, numbers, positions, job, core) where core maps
+        atoms to nodes of job, or is None when job is the full system"""
+        indices = np.atleast_1d(np.asarray(indices, dtype=np.int64))
+        new_numbers = self.numbers.copy()
+        new_positions = self.positions.copy()
+        if numbers is not None:
+            new_numbers[indices] = np.asarray(numbers, dtype=np.int64).reshape(-1)
+        if positions is not None:
+            new_positions[indices] = np.asarray(positions, dtype=np.float64).reshape(-1, 3)
+
+        centers = list(self.positions[indices]) + list(new_positions[indices])
+        for i in indices:
+            self.grid.move(i, new_positions[i])
+        core, cluster_numbers, cluster_positions = self._affected(centers, new_numbers)
+        self.cluster_sizes.append(len(cluster_numbers))
+
+        if len(cluster_numbers) >= len(self.numbers):
+            # Cluster as large as the system: a full evaluation is cheaper
+            job = (new_numbers, new_positions, self.cell, self.pbc)
+            core = None
+        else:
+            job = (cluster_numbers, cluster_positions, None, None)
+        return indices, new_numbers, new_positions, job, core
+
+    def _updates(self, energies, core):
+        if core is None:
+            return {i: energies[i] for i in range(len(energies))}
+        return {atom: energies[i] for atom, i in core.items()}
+
+    def propose(self, indices, positions=None, numbers=None):
+        """Trial move of atoms `indices` to new positions and/or species;
+        returns the trial total energy"""
+        if self.pending is not None:
+            self.reject()
+        indices, new_numbers, new_positions, job, core = self._prepare(indices, positions, numbers)
+        energies = batched_node_energies(self.session, [job])[0]
+        updates = self._updates(energies, core)
+
+        delta = sum(e - self.node_energies[a] for a, e in updates.items())
+        self.pending = (indices, new_numbers, new_positions, updates)
+        return self.energy + float(delta)
+
+    def evaluate_trials(self, trials, max_batch_atoms=20000):
+        """Energy differences of independent trial moves in batched model passes
+
+        trials is a list of (indices, positions or None, numbers or None)
+        relative to the committed configuration, which is left unchanged.
+        """
+        if self.pending is not None:
+            self.reject()
+        jobs, cores = [], []
+        for indices, positions, numbers in trials:
+            indices, _, _, job, core = self._prepare(indices, positions, numbers)
+            for i in indices:
+                self.grid.move(i, self.positions[i])
+            jobs.append(job)
+            cores.append(core)
+
+        deltas = np.empty(len(jobs))
+        start = 0
+        while start < len(jobs):
+            # Pack as many trial graphs per model pass as max_batch_atoms allows
+            stop, atoms = start, 0
+            while stop < len(jobs) and (stop == start or atoms + len(jobs[stop][0]) <= max_batch_atoms):
+                atoms += len(jobs[stop][0])
+                stop += 1
+            for k, energies in enumerate(batched_node_energies(self.session, jobs[start:stop]), start):
+                updates = self._updates(energies, cores[k])
+                deltas[k] = sum(e - self.node_energies[a] for a, e in updates.items())
+            start = stop
+        return deltas
+
+    def accept(self):
+        if self.pending is None:
+            raise RuntimeError("No pending move")
+        indices, numbers, positions, updates = self.pending
+        self.numbers, self.positions = numbers, positions
+        for atom, e in updates.items():
+            self.node_energies[atom] = e
+        self.pending = None
+
+    def reject(self):
+        if self.pending is None:
+            raise RuntimeError("No pending move")
+        for i in self.pending[0]:
+            self.grid.move(i, self.positions[i])
+        self.pending = None
+
+
+# ============================================================
+# Frozen-atom regions
+# ============================================================
+
+class FrozenRegion:
+    """A registered system whose frozen atoms never move
+
+    Edges between frozen atoms are kept from one rebuild to the next; each
+    step only filters the candidate edges of mobile atoms (built with
+    r_max + skin). A rebuild happens once a mobile atom has moved more than
+    skin/2. When the receptive field R (num_interactions * r_max) is small
+    against the frozen region, only a non-periodic cluster is evaluated:
+    every atom image within 2R + skin of a mobile atom, of which the atoms
+    within R + skin/2 (the core) contribute energies. Energies and force
+    contributions of the other atoms cannot change and are taken from one
+    full evaluation per rebuild. Otherwise the whole system is evaluated
+    with the cached edges. With skip_frozen_forces, forces on frozen atoms
+    are returned as zero and no gradient is taken for them.
+    """
+
+    def __init__(self, session, atomic_numbers, positions, cell=None, pbc=None,
+                 frozen=None, skip_frozen_forces=False, skin=1.0):
+        self.session = session
+        self.numbers = np.asarray(atomic_numbers, dtype=np.int64)
+        self.positions = np.array(positions, dtype=np.float64).reshape(-1, 3)
+        self.cell = np.array(cell if cell is not None else np.zeros((3, 3)), dtype=np.float64).reshape(3, 3)
+        self.pbc = np.array(pbc if pbc is not None else [False] * 3, dtype=bool)
+        self.frozen = np.zeros(len(self.numbers), dtype=bool) if frozen is None else \
+            np.asarray(frozen, dtype=bool).reshape(-1)
+        if len(self.frozen) != len(self.numbers):
+            raise ValueError("Frozen mask must have one entry per atom")
+        self.mobile = np.flatnonzero(~self.frozen)
+        self.skip_frozen_forces = bool(skip_frozen_forces)
+        self.skin = float(skin)
+        self.radius = receptive_field(session)
+        self.rebuilds = 0
+        self.cluster_size = None
+        self._graph = None
+
+    def _neighbors(self, positions, cutoff, periodic):
+        from mace.data.neighborhood import get_neighborhood
+
+        if periodic:
+            edge_index, shifts, unit_shifts, *_ = get_neighborhood(
+                positions=positions, cutoff=cutoff, pbc=tuple(self.pbc), cell=self.cell)
+        else:
+            edge_index, shifts, unit_shifts, *_ = get_neighborhood(
+                positions=positions, cutoff=cutoff, pbc=(False, False, False), cell=None)
+        return edge_index, shifts, unit_shifts
+
+    def _cluster(self):
+        """Cluster nodes (atom, image offset) and core node of each core atom,
+        or None when the cluster would not be smaller than the system"""
+        grid = _SpatialGrid(self.positions, self.cell, self.pbc, self.radius)
+        points, core = {}, {}
+        for center in self.positions[self.mobile]:
+            for key, p in grid.query(center, 2.0 * self.radius + self.skin).items():
+                points.setdefault(key, p)
+                if len(points) >= len(self.numbers):
+                    return None
+            for key, _ in grid.query(center, self.radius + 0.5 * self.skin).items():
+                core.setdefault(key[0], key)
+        keys = list(points)
+        index = {key: i for i, key in enumerate(keys)}
+        atoms = np.array([k[0] for k in keys], dtype=np.int64)
+        offsets = np.array([points[k] for k in keys]).reshape(-1, 3) - self.positions[atoms]
+        return atoms, offsets, np.array(sorted(index[key] for key in core.values()), dtype=np.int64)
+
+    def _rebuild(self, calculator, dtype, device):
+        r_max = float(calculator.r_max)
+        cluster = self._cluster() if len(self.mobile) else None
+        if cluster is None:
+            atoms = np.arange(len(self.numbers))
+            offsets = np.zeros((len(atoms), 3))
+            core = atoms
+        else:
+            atoms, offsets, core = cluster
+        node_positions = self.positions[atoms] + offsets
+        edge_index, shifts, unit_shifts = self._neighbors(node_positions, r_max + self.skin, cluster is None)
+
+        senders, receivers = edge_index
+        mobile_node = ~self.frozen[atoms]
+        involves_mobile = mobile_node[senders] | mobile_node[receivers]
+        lengths = np.linalg.norm(node_positions[receivers] - node_positions[senders] + shifts, axis=1)
+        fixed = ~involves_mobile & (lengths < r_max)
+
+        def tensor(x, kind=dtype):
+            return torch.as_tensor(np.ascontiguousarray(x), dtype=kind, device=device)
+
+        graph = {
+            "key": (id(calculator), dtype),
+            "atoms": tensor(atoms, torch.long),
+            "offsets": tensor(offsets),
+            "core": tensor(core, torch.long),
+            "node_attrs": _node_attrs(calculator, self.numbers[atoms], dtype, device),
+            "fixed_index": tensor(edge_index[:, fixed], torch.long),
+            "fixed_shifts": tensor(shifts[fixed]),
+            "fixed_unit_shifts": tensor(unit_shifts[fixed]),
+            "candidate_index": tensor(edge_index[:, involves_mobile], torch.long),
+            "candidate_shifts": tensor(shifts[involves_mobile]),
+            "candidate_unit_shifts": tensor(unit_shifts[involves_mobile]),
+            "r_max": r_max,
+            "reference": self.positions[self.mobile].copy(),
+            "const_energy": 0.0,
+            "const_forces": None,
+        }
+        self.cluster_size = None if cluster is None else len(atoms)
+        self._graph = graph
+        self.rebuilds += 1
+
+        if cluster is not None:
+            # Atoms outside the core keep their energies until the next rebuild
+            full = FrozenRegion(self.session, self.numbers, self.positions, self.cell, self.pbc,
+                                np.ones(len(self.numbers), dtype=bool), skin=0.0)
+            full._rebuild(calculator, dtype, device)
+            outside = np.ones(len(self.numbers), dtype=bool)
+            outside[atoms[core]] = False
+            energy, forces = full._evaluate(calculator, mask=outside,
+                                            forces=not self.skip_frozen_forces)
+            graph["const_energy"] = energy
+            graph["const_forces"] = None if self.skip_frozen_forces else forces
+
+    def _evaluate(self, calculator, mask=None, forces=True):
+        """Energy of the selected atoms (core nodes when mask is None) and
+        minus its gradient w.r.t. all atom positions"""
+        graph = self._graph
+        model = calculator.models[0]
+        dtype = graph["offsets"].dtype
+        device = graph["offsets"].device
+
+        positions = torch.as_tensor(self.positions, dtype=dtype, device=device)
+        leaf = None
+        if forces and not self.skip_frozen_forces:
+            leaf = positions.requires_grad_(True)
+        elif forces and len(self.mobile):
+            leaf = positions[self.mobile].detach().requires_grad_(True)
+            positions = positions.clone()
+            positions[self.mobile] = leaf
+        node_positions = positions[graph["atoms"]] + graph["offsets"]
+
+        index, shifts, unit_shifts = graph["candidate_index"], graph["candidate_shifts"], graph["candidate_unit_shifts"]
+        if index.shape[1]:
+            with torch.no_grad():
+                vectors = node_positions[index[1]] - node_positions[index[0]] + shifts
+                keep = torch.linalg.norm(vectors, dim=1) < graph["r_max"]
+            index, shifts, unit_shifts = index[:, keep], shifts[keep], unit_shifts[keep]
+
+        num_nodes = len(node_positions)
+        data = {
+            "positions": node_positions,
+            "node_attrs": graph["node_attrs"],
+            "edge_index": torch.cat([graph["fixed_index"], index], dim=1),
+            "shifts": torch.cat([graph["fixed_shifts"], shifts]),
+            "unit_shifts": torch.cat([graph["fixed_unit_shifts"], unit_shifts]),
+            "cell": torch.as_tensor(self.cell, dtype=dtype, device=device),
+            "batch": torch.zeros(num_nodes, dtype=torch.long, device=device),
+            "ptr": torch.tensor([0, num_nodes], dtype=torch.long, device=device),
+            "head": torch.zeros(1, dtype=torch.long, device=device),
+        }
+        with torch.enable_grad():
+            out = model(data, training=False, compute_force=False)
+            node_energy = out["node_energy"]
+            if mask is None:
+                selected = node_energy[graph["core"]].sum()
+            else:
+                selected = node_energy[torch.as_tensor(mask, device=device)].sum()
+            result = np.zeros((len(self.numbers), 3))
+            if leaf is not None:
+                grad, = torch.autograd.grad(selected, leaf, allow_unused=True)
+                if grad is not None:
+                    grad = grad.detach().cpu().double().numpy()
+                    if leaf.shape[0] == len(self.numbers):
+                        result = -grad
+                    else:
+                        result[self.mobile] = -grad
+        return float(selected.detach()), result
+
+    def compute(self, positions=None):
+        """Energy (eV) and forces [n, 3] (eV/A); frozen entries of positions are ignored"""
+        if positions is not None:
+            positions = np.asarray(positions, dtype=np.float64).reshape(-1, 3)
+            self.positions[self.mobile] = positions[self.mobile]
+
+        precision = self.session._choose_precision()
+        calculator = self.session.calculator(precision)
+        param = next(calculator.models[0].parameters())
+        graph = self._graph
+        if (graph is None or graph["key"] != (id(calculator), param.dtype)
+                or 2.0 * np.linalg.norm(self.positions[self.mobile] - graph["reference"],
+                                        axis=1).max(initial=0.0) > self.skin):
+            self._rebuild(calculator, param.dtype, param.device)
+            graph = self._graph
+
+        with _default_dtype(_TORCH_DTYPES[precision]):
+            energy, forces = self._evaluate(calculator)
+        energy += graph["const_energy"]
+        if graph["const_forces"] is not None:
+            forces = forces + graph["const_forces"]
+        if self.skip_frozen_forces:
+            forces[self.frozen] = 0.0
+
+        self.session.active = precision
+        self.session.last_fmax = float(np.linalg.norm(forces, axis=1).max(initial=0.0))
+        return energy, forces
+
+
+# ============================================================
+# Memory-bounded chunked evaluation
+# ============================================================
+
+def graph_bytes_per_atom(calculator, neighbors):
+    """Estimated peak bytes per graph node of an energy and forces pass
+
+    Counts the per-edge tensor-product weights and messages and the node
+    features of every interaction, three times over for activations, saved
+    tensors and their gradients.
+    """
+    model = calculator.models[0]
+    itemsize = next(model.parameters()).element_size()
+    edge, node = 0, 0
+    for interaction in model.interactions:
+        tp = getattr(interaction, "conv_tp", None)
+        edge += int(getattr(tp, "weight_numel", 0))
+        edge += int(getattr(getattr(interaction, "irreps_mid", None), "dim", 0))
+        node += int(getattr(getattr(interaction, "irreps_out", None), "dim", 0))
+    if edge == 0:
+        edge = 4096     # Layout not recognized (e.g. cuEquivariance kernels)
+    return 3 * itemsize * (neighbors * edge + 4 * node)
+
+
+def _cluster_inputs(calculator, numbers, edge_index, dtype, device):
+    """Static model inputs of a non-periodic graph with the given edges"""
+    num_nodes = len(numbers)
+    num_edges = edge_index.shape[1]
+    return {
+        "node_attrs": _node_attrs(calculator, numbers, dtype, device),
+        "edge_index": torch.as_tensor(np.ascontiguousarray(edge_index), dtype=torch.long, device=device),
+        "shifts": torch.zeros(num_edges, 3, dtype=dtype, device=device),
+        "unit_shifts": torch.zeros(num_edges, 3, dtype=dtype, device=device),
+        "cell": torch.zeros(3, 3, dtype=dtype, device=device),
+        "batch": torch.zeros(num_nodes, dtype=torch.long, device=device),
+        "ptr": torch.tensor([0, num_nodes], dtype=torch.long, device=device),
+        "head": torch.zeros(1, dtype=torch.long, device=device),
+    }
+
+
+def _atom_virials(edge_index, positions, shifts, shift_grad, num_nodes):
+    """Per-node virials [n, 3, 3] (eV): each edge's -r_e (x) dE/dr_e split
+    evenly between its two nodes; dE/dr_e is the gradient of the edge shifts"""
+    senders, receivers = edge_index
+    vectors = (positions[receivers] - positions[senders] + shifts).detach()
+    edge_virial = -0.5 * vectors[:, :, None] * shift_grad.detach()[:, None, :]
+    virials = torch.zeros(num_nodes, 3, 3, dtype=edge_virial.dtype, device=edge_virial.device)
+    virials.index_add_(0, senders, edge_virial).index_add_(0, receivers, edge_virial)
+    return virials.cpu().double().numpy()
+
+
+def _core_energy_gradient(model, inputs, node_positions, num_core=None, core=None, virials=False):
+    """Node energies, summed core energy, its gradient [n, 3] w.r.t. all
+    node positions and, if requested, the per-node virials of the core
+    energy (else None); the core is the first num_core nodes or a mask"""
+    dtype = inputs["cell"].dtype
+    device = inputs["cell"].device
+    positions = torch.tensor(node_positions, dtype=dtype, device=device, requires_grad=True)
+    shifts = inputs["shifts"].clone().requires_grad_(True) if virials else inputs["shifts"]
+    data = dict(inputs)
+    data["positions"], data["shifts"] = positions, shifts
+    with torch.enable_grad():
+        out = model(data, training=False, compute_force=False)
+        node_energy = out["node_energy"]
+        if core is not None:
+            energy = node_energy[torch.as_tensor(core, device=device)].sum()
+        else:
+            energy = node_energy[:num_core].sum()
+        grads = torch.autograd.grad(energy, [positions, shifts] if virials else [positions])
+    node_virials = None
+    if virials:
+        node_virials = _atom_virials(data["edge_index"], positions, shifts, grads[1], len(node_positions))
+    return node_energy.detach(), float(energy.detach()), grads[0].detach().cpu().double().numpy(), node_virials
+
+
+def cluster_energy_gradient(calculator, numbers, node_positions, core, dtype, device):
+    """Summed energy of the core nodes of a non-periodic cluster and its
+    gradient [n, 3] with respect to every node position"""
+    from mace.data.neighborhood import get_neighborhood
+
+    node_positions = np.asarray(node_positions, dtype=np.float64).reshape(-1, 3)
+    edge_index, *_ = get_neighborhood(
+        positions=node_positions, cutoff=float(calculator.r_max), pbc=(False, False, False), cell=None)
+    inputs = _cluster_inputs(calculator, numbers, edge_index, dtype, device)
+    _, energy, grad, _ = _core_energy_gradient(calculator.models[0], inputs, node_positions, core=core)
+    return energy, grad
+
+
+def subset_forces(session, atomic_numbers, positions, cell, pbc, subset):
+    """Forces [k, 3] (eV/A) on the atoms listed in subset only
+
+    The force on atom i collects the gradients of the node energies within
+    the receptive field R of i, and those energies need their own R
+    environments. The model therefore runs on a non-periodic cluster of
+    every atom image within 2R of the subset, summing the node energies
+    within R of it and differentiating with respect to the subset atoms'
+    own nodes; other images of an atom are separate nodes, so this is the
+    exact periodic force. Falls back to a full evaluation when the cluster
+    is not smaller than the system.
+    """
+    numbers = np.asarray(atomic_numbers, dtype=np.int64)
+    positions = np.asarray(positions, dtype=np.float64).reshape(-1, 3)
+    subset = np.asarray(subset, dtype=np.int64).reshape(-1)
+    if subset.size and (subset.min() < 0 or subset.max() >= len(numbers)):
+        raise ValueError("Subset atom index out of range")
+    pbc = np.array(pbc if pbc is not None else [False] * 3, dtype=bool)
+
+    radius = receptive_field(session)
+    grid = _SpatialGrid(positions, cell, pbc, radius)
+    targets = np.unique(subset)
+    nodes = {}
+    for i in targets:
+        nodes.update(grid.query(grid.wrapped[i], 2.0 * radius))
+    if len(nodes) >= len(numbers):
+        _, forces = session.compute_array(positions, numbers, cell, pbc)
+        return forces[subset]
+
+    keys = list(nodes)
+    atoms = np.array([k[0] for k in keys], dtype=np.int64)
+    node_positions = np.array([nodes[k] for k in keys])
+    centers = grid.wrapped[targets]
+    core = np.zeros(len(keys), dtype=bool)
+    for start in range(0, len(keys), 4096):
+        d = node_positions[start:start + 4096, None, :] - centers[None, :, :]
+        core[start:start + 4096] = np.einsum("ijk,ijk->ij", d, d).min(axis=1) < radius * radius
+
+    precision = session._choose_precision()
+    calculator = session.calculator(precision)
+    param = next(calculator.models[0].parameters())
+    with _default_dtype(_TORCH_DTYPES[precision]):
+        _, grad = cluster_energy_gradient(calculator, numbers[atoms], node_positions, core,
+                                          param.dtype, param.device)
+    session.active = precision
+
+    row = {k: n for n, k in enumerate(keys)}
+    return -grad[[row[(int(i), (0, 0, 0))] for i in subset]]
+
+
+class LocalGraph:
+    """Resident graph of local plus ghost atoms with caller-supplied edges
+
+    Used by MD codes that own the neighbor list (the LAMMPS pair style).
+    Species encodings and edge tensors are rebuilt only when the caller
+    reports a topology change (reneighboring); other steps only copy the
+    positions. Edges may extend to r_max + skin: beyond r_max the
+    polynomial cutoff is exactly zero.
+    """
+
+    def __init__(self, session):
+        self.session = session
+        self.rebuilds = 0
+        self._key = None
+        self._inputs = None
+
+    def compute(self, atomic_numbers, positions, edge_index, num_local, rebuild, node_energies=False,
+                virials=False):
+        """Local energy, local node energies (or None), forces on all atoms
+        and per-atom virials [n, 3, 3] of the local energy on all atoms (or
+        None); like the forces, ghost rows belong to the ghosts' owners"""
+        precision = self.session._choose_precision()
+        calculator = self.session.calculator(precision)
+        model = calculator.models[0]
+        param = next(model.parameters())
+        positions = np.asarray(positions, dtype=np.float64).reshape(-1, 3)
+
+        key = (id(calculator), param.dtype, len(positions))
+        if rebuild or self._key != key:
+            if atomic_numbers is None or edge_index is None:
+                raise ValueError("Species and edges are required after a topology change")
+            numbers = np.asarray(atomic_numbers, dtype=np.int64)
+            edges = np.asarray(edge_index, dtype=np.int64).reshape(2, -1)
+            if len(numbers) != len(positions):
+                raise ValueError("One atomic number per local and ghost atom is required")
+            if edges.size and (edges.min() < 0 or edges.max() >= len(numbers)):
+                raise ValueError("Edge index out of range")
+            self._inputs = _cluster_inputs(calculator, numbers, edges, param.dtype, param.device)
+            self._key = key
+            self.rebuilds += 1
+
+        with _default_dtype(_TORCH_DTYPES[precision]):
+            node_energy, energy, grad, node_virials = _core_energy_gradient(
+                model, self._inputs, positions, num_core=num_local, virials=virials)
+        self.session.active = precision
+        local = node_energy[:num_local].cpu().double().numpy() if node_energies else None
+        return energy, local, -grad, node_virials
+
+
+@contextlib.contextmanager
+def _intra_op_threads(count):
+    previous = torch.get_num_threads()
+    torch.set_num_threads(count)
+    try:
+        yield
+    finally:
+        torch.set_num_threads(previous)
+
+
+class ChunkedEvaluation:
+    """Energy and forces of a large system in spatial blocks
+
+    Space is cut into blocks along the cell axes (the bounding box along
+    non-periodic ones). Each block is evaluated as a non-periodic cluster of
+    its core atoms plus every atom image within the receptive field
+    R = num_interactions * r_max (the halo). Core node energies are exact
+    and are summed; the gradient of the block's core energy is taken with
+    respect to all cluster nodes, halo included, and added to the atoms the
+    nodes are images of. Every node energy enters exactly one block, so the
+    stitched energy and forces equal a single evaluation up to summation
+    order. The block count is the smallest for which the estimated cluster
+    memory stays within max_bytes.
+
+    With workers > 1 the system is cut into at least that many domains
+    (as long as a domain stays smaller than the system) and domains are
+    evaluated concurrently on a thread pool; torch releases the GIL inside
+    the model, and the workers share its weights. Each worker gets
+    max_bytes / workers and an equal share of the intra-op threads. Forces
+    are reduced in block order, so results do not depend on scheduling.
+    """
+
+    def __init__(self, session, calculator, numbers, positions, cell, pbc, max_bytes=None, workers=1):
+        self.session = session
+        self.calculator = calculator
+        self.numbers = np.asarray(numbers, dtype=np.int64)
+        self.positions = np.asarray(positions, dtype=np.float64).reshape(-1, 3)
+        self.pbc = np.array(pbc if pbc is not None else [False] * 3, dtype=bool)
+        self.cell, self.inv, self.plane = _lattice_frame(cell, self.pbc)
+        self.r_max = float(calculator.r_max)
+        self.radius = self.r_max * len(calculator.models[0].interactions)
+
+        frac = self.positions @ self.inv
+        self.shift = np.where(self.pbc, np.floor(frac), 0.0)
+        self.frac = frac - self.shift
+        self.lo = np.where(self.pbc, 0.0, self.frac.min(axis=0))
+        self.span = np.where(self.pbc, 1.0, np.maximum(self.frac.max(axis=0) - self.lo, 1e-9))
+        self.workers = max(1, int(workers))
+        self.counts = self._plan(max_bytes)
+
+    def _cluster_atoms(self, counts, density):
+        length = self.span * self.plane
+        halo = np.where(self.pbc | (counts > 1), 2.0 * self.radius, 0.0)
+        return density * np.prod(np.maximum(length / counts + halo, 1.0))
+
+    def _plan(self, max_bytes):
+        """Blocks per axis, or None when one evaluation of the whole system
+        fits the budget and there is a single worker"""
+        n = len(self.numbers)
+        density = n / np.prod(np.maximum(self.span * self.plane, 1.0))
+        max_atoms = np.inf
+        if max_bytes:
+            neighbors = density * 4.0 / 3.0 * np.pi * self.r_max ** 3
+            max_atoms = max_bytes / self.workers / graph_bytes_per_atom(self.calculator, neighbors)
+
+        def too_large(counts):
+            return (self._cluster_atoms(counts, density) if counts.prod() > 1 else n) > max_atoms
+
+        counts = np.ones(3, dtype=int)
+        while too_large(counts) or counts.prod() < self.workers:
+            trials = []
+            for a in range(3):
+                trial = counts.copy()
+                trial[a] += 1
+                trials.append(self._cluster_atoms(trial, density))
+            a = int(np.argmin(trials))
+            if counts.prod() >= n or trials[a] >= self._cluster_atoms(counts, density):
+                if too_large(counts):
+                    raise MemoryError(f"Memory budget of {max_bytes} bytes is too small for a block "
+                                      f"with a {self.radius:.1f} A halo")
+                break
+            counts[a] += 1
+
+        # Domains with halos that are not smaller than the system gain nothing
+        if counts.prod() == 1 or self._cluster_atoms(counts, density) >= n:
+            return None
+        return counts
+
+    @property
+    def num_blocks(self):
+        return 1 if self.counts is None else int(np.prod(self.counts))
+
+    def _blocks(self):
+        """(core atoms, cluster atoms, cluster node positions, core mask) per block"""
+        counts = self.counts if self.counts is not None else np.ones(3, dtype=int)
+        width = self.span / counts
+        halo = self.radius / self.plane
+        reach = np.ceil(halo / width).astype(int)
+        index = np.clip(np.floor((self.frac - self.lo) / width).astype(int), 0, counts - 1)
+        flat = np.ravel_multi_index(index.T, counts)
+        order = np.argsort(flat, kind="stable")
+        starts = np.searchsorted(flat[order], np.arange(np.prod(counts) + 1))
+        wrapped = self.positions - self.shift @ self.cell
+
+        for block in itertools.product(*(range(c) for c in counts)):
+            block = np.array(block)
+            lower = self.lo + block * width - halo
+            upper = self.lo + (block + 1) * width + halo
+            ranges = []
+            for a in range(3):
+                steps = range(block[a] - reach[a], block[a] + reach[a] + 1)
+                if not self.pbc[a]:
+                    steps = [m for m in steps if 0 <= m < counts[a]]
+                ranges.append(steps)
+
+            atoms, images = [], []
+            for m in itertools.product(*ranges):
+                m = np.array(m)
+                image = np.where(self.pbc, np.floor_divide(m, counts), 0)
+                k = np.ravel_multi_index(tuple(m - image * counts), counts)
+                members = order[starts[k]:starts[k + 1]]
+                if not len(members):
+                    continue
+                s = self.frac[members] + image
+                inside = np.all((s >= lower) & (s < upper), axis=1)
+                atoms.append(members[inside])
+                images.append(np.broadcast_to(image, (int(inside.sum()), 3)))
+            atoms = np.concatenate(atoms)
+            images = np.concatenate(images).astype(np.float64)
+            core = (np.all(images == 0, axis=1)
+                    & (flat[atoms] == np.ravel_multi_index(tuple(block), counts)))
+            yield atoms, wrapped[atoms] + images @ self.cell, core
+
+    def _evaluate_block(self, atoms, node_positions, core, dtype, device):
+        return cluster_energy_gradient(self.calculator, self.numbers[atoms], node_positions,
+                                       core, dtype, device)
+
+    def compute(self):
+        """Energy (eV) and forces [n, 3] (eV/A) stitched from all blocks"""
+        param = next(self.calculator.models[0].parameters())
+        blocks = [block for block in self._blocks() if block[2].any()]
+
+        def evaluate(block):
+            return self._evaluate_block(*block, param.dtype, param.device)
+
+        energy = 0.0
+        forces = np.zeros_like(self.positions)
+        if self.workers > 1 and len(blocks) > 1:
+            workers = min(self.workers, len(blocks))
+            with _intra_op_threads(max(1, torch.get_num_threads() // workers)), \
+                    concurrent.futures.ThreadPoolExecutor(workers) as pool:
+                results = pool.map(evaluate, blocks)
+                for (atoms, _, _), (block_energy, grad) in zip(blocks, results):
+                    energy += block_energy
+                    np.subtract.at(forces, atoms, grad)
+        else:
+            for block in blocks:
+                block_energy, grad = evaluate(block)
+                energy += block_energy
+                np.subtract.at(forces, block[0], grad)
+        return energy, forces
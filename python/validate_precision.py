@@ -0,0 +1,119 @@
+"""Report the accuracy and speed of a reduced-precision MACE mode against float32
+
+Usage:
+    python validate_precision.py --precision bfloat16 --structures ref.xyz
+    python validate_precision.py --model-path my.model --precision int8 --per-layer
+
+Energies are compared per atom, forces component-wise. Without --structures a
+few random bulk cells of the model's first elements are used.
+"""
+import argparse
+import sys
+import time
+
+import numpy as np
+from ase import Atoms
+
+from mace_calculator import PRECISIONS, create_calculator
+
+
+def _random_structures(atomic_numbers, count=4, seed=0):
+    rng = np.random.default_rng(seed)
+    structures = []
+    for k in range(count):
+        reps = 2 + k % 2
+        grid = np.stack(np.meshgrid(*[np.arange(reps)] * 3, indexing="ij"), -1).reshape(-1, 3)
+        positions = grid * 2.4 + rng.normal(scale=0.1, size=grid.shape)
+        numbers = rng.choice(atomic_numbers[:4], size=len(grid))
+        structures.append(Atoms(numbers=numbers, positions=positions,
+                                cell=np.eye(3) * 2.4 * reps, pbc=True))
+    return structures
+
+
+def evaluate(calculator, structures, repeats=1):
+    """Energies [n_structures], forces (list of [n, 3]) and seconds per structure"""
+    energies, forces = [], []
+    start = time.perf_counter()
+    for _ in range(repeats):
+        energies, forces = [], []
+        for atoms in structures:
+            atoms = atoms.copy()
+            atoms.calc = calculator
+            energies.append(atoms.get_potential_energy())
+            forces.append(atoms.get_forces())
+    elapsed = (time.perf_counter() - start) / (repeats * len(structures))
+    return np.array(energies), forces, elapsed
+
+
+def compare(reference, candidate, structures):
+    """Error statistics of candidate against reference evaluations"""
+    (e_ref, f_ref, t_ref), (e_new, f_new, t_new) = reference, candidate
+    natoms = np.array([len(a) for a in structures])
+    de = np.abs(e_new - e_ref) / natoms
+    df = np.concatenate([(a - b).ravel() for a, b in zip(f_new, f_ref)])
+    return {
+        "energy_mae": float(de.mean()),
+        "energy_max": float(de.max()),
+        "force_rmse": float(np.sqrt(np.mean(df ** 2))),
+        "force_max": float(np.abs(df).max()),
+        "speedup": t_ref / t_new if t_new > 0 else float("nan"),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--model", default="small", help="mace_mp model (small/medium/large)")
+    parser.add_argument("--model-path", help="Path to a .model file (overrides --model)")
+    parser.add_argument("--precision", default="bfloat16", choices=[p for p in PRECISIONS if p != "float32"])
+    parser.add_argument("--structures", help="Reference structures (any ASE format)")
+    parser.add_argument("--device", default="cpu")
+    parser.add_argument("--per-layer", action="store_true",
+                        help="For int8, list the weight quantization error of every layer")
+    parser.add_argument("--repeats", type=int, default=3, help="Timing repeats")
+    parser.add_argument("--max-energy-error", type=float, default=None,
+                        help="Exit non-zero if the per-atom energy MAE exceeds this (eV)")
+    parser.add_argument("--max-force-error", type=float, default=None,
+                        help="Exit non-zero if the force RMSE exceeds this (eV/A)")
+    args = parser.parse_args()
+
+    def build(precision):
+        return create_calculator(args.model_path, args.model, args.device,
+                                 enable_cueq=False, precision=precision)
+
+    reference_calc = build("float32")
+    if args.structures:
+        from ase.io import read
+        structures = read(args.structures, index=":")
+    else:
+        numbers = [int(z) for z in reference_calc.models[0].atomic_numbers]
+        structures = _random_structures(numbers)
+
+    # Warm up both paths so timings exclude first-call compilation
+    candidate_calc = build(args.precision)
+    evaluate(reference_calc, structures[:1])
+    evaluate(candidate_calc, structures[:1])
+
+    reference = evaluate(reference_calc, structures, args.repeats)
+    candidate = evaluate(candidate_calc, structures, args.repeats)
+    stats = compare(reference, candidate, structures)
+
+    print(f"{args.precision} vs float32 on {len(structures)} structures")
+    print(f"  energy MAE  {stats['energy_mae']:.3e} eV/atom (max {stats['energy_max']:.3e})")
+    print(f"  force RMSE  {stats['force_rmse']:.3e} eV/A (max {stats['force_max']:.3e})")
+    print(f"  speedup     {stats['speedup']:.2f}x")
+
+    report = getattr(candidate_calc.models[0], "int8_report", None)
+    if report:
+        worst = max(report, key=lambda item: item[1])
+        print(f"  int8 layers {len(report)}, worst weight error {worst[1]:.2e} ({worst[0]})")
+        if args.per_layer:
+            for name, err in report:
+                print(f"    {name:50s} {err:.2e}")
+
+    failed = ((args.max_energy_error is not None and stats["energy_mae"] > args.max_energy_error)
+              or (args.max_force_error is not None and stats["force_rmse"] > args.max_force_error))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
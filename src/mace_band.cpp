@@ -0,0 +1,148 @@
+#include "mace_band.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace mace_band {
+
+namespace {
+
+double dot(const double* a, const double* b, size_t n)
+{
+    double s = 0.0;
+    for (size_t i = 0; i < n; ++i) s += a[i] * b[i];
+    return s;
+}
+
+/* NEB forces of the interior images [(n_images - 2) * dim]; returns the
+   largest atomic force norm */
+double neb_forces(int num_atoms, int n_images, const std::vector<double>& positions,
+                  const std::vector<double>& energies, const std::vector<double>& forces,
+                  const Options& options, int climbing, std::vector<double>& out)
+{
+    const size_t dim = 3 * static_cast<size_t>(num_atoms);
+    std::vector<double> tangent(dim), forward(dim), backward(dim);
+    double fmax = 0.0;
+
+    for (int i = 1; i < n_images - 1; ++i) {
+        const double* r = positions.data() + i * dim;
+        const double* prev = r - dim;
+        const double* next = r + dim;
+        for (size_t k = 0; k < dim; ++k) {
+            forward[k] = next[k] - r[k];
+            backward[k] = r[k] - prev[k];
+        }
+
+        /* Improved tangent: follow the higher-energy neighbour */
+        const double e = energies[i], ep = energies[i - 1], en = energies[i + 1];
+        if (en > e && e > ep) {
+            tangent = forward;
+        } else if (en < e && e < ep) {
+            tangent = backward;
+        } else {
+            const double dmax = std::max(std::fabs(en - e), std::fabs(ep - e));
+            const double dmin = std::min(std::fabs(en - e), std::fabs(ep - e));
+            const double wf = en > ep ? dmax : dmin;
+            const double wb = en > ep ? dmin : dmax;
+            for (size_t k = 0; k < dim; ++k) tangent[k] = wf * forward[k] + wb * backward[k];
+        }
+        const double norm = std::sqrt(dot(tangent.data(), tangent.data(), dim));
+        if (norm > 0.0)
+            for (double& t : tangent) t /= norm;
+
+        const double* f = forces.data() + i * dim;
+        double* g = out.data() + (i - 1) * dim;
+        const double ft = dot(f, tangent.data(), dim);
+        if (i == climbing) {
+            for (size_t k = 0; k < dim; ++k) g[k] = f[k] - 2.0 * ft * tangent[k];
+        } else {
+            const double stretch = options.spring *
+                (std::sqrt(dot(forward.data(), forward.data(), dim)) -
+                 std::sqrt(dot(backward.data(), backward.data(), dim)));
+            for (size_t k = 0; k < dim; ++k) g[k] = f[k] - ft * tangent[k] + stretch * tangent[k];
+        }
+        for (int a = 0; a < num_atoms; ++a) {
+            const double* v = g + 3 * a;
+            fmax = std::max(fmax, std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]));
+        }
+    }
+    return fmax;
+}
+
+}  // namespace
+
+Result run(int num_atoms, int n_images, std::vector<double>& positions,
+           std::vector<double>& energies, std::vector<double>& forces,
+           const Options& options, const Evaluator& evaluate)
+{
+    if (num_atoms <= 0 || n_images < 3) throw std::invalid_argument("NEB needs atoms and at least 3 images");
+    const size_t dim = 3 * static_cast<size_t>(num_atoms);
+    const size_t band = (n_images - 2) * dim;
+    energies.assign(n_images, 0.0);
+    forces.assign(n_images * dim, 0.0);
+
+    /* End points once, together with the initial band */
+    evaluate(0, n_images, positions.data(), energies.data(), forces.data());
+
+    /* FIRE parameters as in ase.optimize.FIRE */
+    const int n_min = 5;
+    const double f_inc = 1.1, f_dec = 0.5, a_start = 0.1, f_a = 0.99;
+    double dt = options.dt, a = a_start;
+    int n_positive = 0;
+    std::vector<double> v(band, 0.0), g(band);
+    bool have_velocity = false;
+
+    Result result;
+    for (;;) {
+        int climbing = -1;
+        if (options.climb) {
+            climbing = 1;
+            for (int i = 2; i < n_images - 1; ++i)
+                if (energies[i] > energies[climbing]) climbing = i;
+        }
+        const double fmax = neb_forces(num_atoms, n_images, positions, energies, forces, options, climbing, g);
+        if (fmax < options.fmax) {
+            result.converged = true;
+            break;
+        }
+        if (result.steps >= options.max_steps) break;
+
+        if (have_velocity) {
+            const double vf = dot(v.data(), g.data(), band);
+            if (vf > 0.0) {
+                const double vnorm = std::sqrt(dot(v.data(), v.data(), band));
+                const double gnorm = std::sqrt(dot(g.data(), g.data(), band));
+                for (size_t k = 0; k < band; ++k) v[k] = (1.0 - a) * v[k] + a * g[k] / gnorm * vnorm;
+                if (n_positive > n_min) {
+                    dt = std::min(dt * f_inc, options.dt_max);
+                    a *= f_a;
+                }
+                ++n_positive;
+            } else {
+                std::fill(v.begin(), v.end(), 0.0);
+                a = a_start;
+                dt *= f_dec;
+                n_positive = 0;
+            }
+        }
+        have_velocity = true;
+
+        for (size_t k = 0; k < band; ++k) v[k] += dt * g[k];
+        double step = 0.0;
+        for (size_t k = 0; k < band; ++k) step += (dt * v[k]) * (dt * v[k]);
+        step = std::sqrt(step);
+        const double scale = step > options.max_step ? options.max_step / step : 1.0;
+        double* r = positions.data() + dim;
+        for (size_t k = 0; k < band; ++k) r[k] += scale * dt * v[k];
+
+        evaluate(1, n_images - 2, r, energies.data() + 1, forces.data() + dim);
+        ++result.steps;
+    }
+
+    result.highest_image = static_cast<int>(std::max_element(energies.begin(), energies.end()) - energies.begin());
+    result.barrier = energies[result.highest_image] - energies[0];
+    return result;
+}
+
+}  // namespace mace_band
@@ -0,0 +1,53 @@
+#ifndef MACE_BAND_H
+#define MACE_BAND_H
+
+#include <functional>
+#include <vector>
+
+/*
+ * Nudged elastic band with the improved tangent of Henkelman and Jónsson
+ * (J. Chem. Phys. 113, 9978, 2000) and an optional climbing image,
+ * optimized with FIRE on all movable images at once.
+ *
+ * Image coordinates must be continuous along the band (no wrapping between
+ * neighbouring images). The end points stay fixed.
+ */
+namespace mace_band {
+
+struct Options {
+    double spring = 0.1;            /* eV/Å^2 */
+    bool climb = true;              /* Climbing image on the highest interior image */
+    double fmax = 0.05;             /* Convergence on the largest NEB atomic force, eV/Å */
+    int max_steps = 500;
+    double dt = 0.1;                /* FIRE initial timestep (ASE units) */
+    double dt_max = 1.0;
+    double max_step = 0.2;          /* Largest band displacement per step, Å */
+};
+
+/*
+ * Evaluate `count` consecutive images starting at `first`. positions holds
+ * those images back to back [count * num_atoms * 3]; the callee writes
+ * energies [count] and forces [count * num_atoms * 3].
+ */
+using Evaluator = std::function<void(int first, int count, const double* positions,
+                                     double* energies, double* forces)>;
+
+struct Result {
+    int steps = 0;
+    bool converged = false;
+    double barrier = 0.0;           /* max image energy - first image energy */
+    int highest_image = 0;
+};
+
+/*
+ * positions [n_images * num_atoms * 3] is updated in place; energies
+ * [n_images] and forces [n_images * num_atoms * 3] receive the model
+ * results of the final band.
+ */
+Result run(int num_atoms, int n_images, std::vector<double>& positions,
+           std::vector<double>& energies, std::vector<double>& forces,
+           const Options& options, const Evaluator& evaluate);
+
+}  // namespace mace_band
+
+#endif /* MACE_BAND_H */
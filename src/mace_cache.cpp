@@ -0,0 +1,149 @@
+#include "mace_cache.h"
+
+#include <cstring>
+
+namespace mace_cache {
+
+namespace {
+
+/* Multiply-xorshift mixing over 8-byte words; only needs to spread keys */
+inline uint64_t mix(uint64_t h, uint64_t word)
+{
+    h ^= word + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h *= 0xff51afd7ed558ccdULL;
+    return h ^ (h >> 33);
+}
+
+uint64_t hash_bytes(uint64_t h, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        h = mix(h, word);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, bytes + i, size - i);
+    return mix(h, tail ^ size);
+}
+
+uint64_t hash_input(const double* positions, const int* numbers, int num_atoms,
+                    const std::array<double, 9>& cell, const std::array<int, 3>& pbc, bool periodic)
+{
+    uint64_t h = mix(0x84222325cbf29ce4ULL, static_cast<uint64_t>(num_atoms));
+    h = hash_bytes(h, positions, sizeof(double) * 3 * num_atoms);
+    h = hash_bytes(h, numbers, sizeof(int) * num_atoms);
+    if (periodic) {
+        h = hash_bytes(h, cell.data(), sizeof(double) * 9);
+        h = hash_bytes(h, pbc.data(), sizeof(int) * 3);
+    }
+    return h;
+}
+
+void read_cell(const double* cell, const int* pbc,
+               std::array<double, 9>& cell_out, std::array<int, 3>& pbc_out, bool& periodic)
+{
+    periodic = cell != nullptr && pbc != nullptr;
+    cell_out.fill(0.0);
+    pbc_out.fill(0);
+    if (periodic) {
+        std::memcpy(cell_out.data(), cell, sizeof(double) * 9);
+        for (int i = 0; i < 3; ++i) pbc_out[i] = pbc[i] != 0;
+    }
+}
+
+}  // namespace
+
+size_t Entry::bytes() const
+{
+    return sizeof(Entry) + sizeof(double) * (positions.size() + forces.size())
+         + sizeof(int) * numbers.size() + precision.size();
+}
+
+void ResultCache::set_capacity(size_t max_bytes)
+{
+    max_bytes_ = max_bytes;
+    evict_to(max_bytes_);
+}
+
+const Entry* ResultCache::find(const double* positions, const int* numbers, int num_atoms,
+                               const double* cell, const int* pbc)
+{
+    if (num_atoms <= 0) {
+        /* Empty inputs may come with null arrays; they are never cached */
+        ++stats_.misses;
+        return nullptr;
+    }
+    std::array<double, 9> c;
+    std::array<int, 3> p;
+    bool periodic;
+    read_cell(cell, pbc, c, p, periodic);
+    const uint64_t h = hash_input(positions, numbers, num_atoms, c, p, periodic);
+
+    auto it = index_.find(h);
+    if (it != index_.end()) {
+        const Entry& e = *it->second;
+        const size_t n = static_cast<size_t>(num_atoms);
+        if (e.numbers.size() == n && e.periodic == periodic && e.cell == c && e.pbc == p
+            && std::memcmp(e.positions.data(), positions, sizeof(double) * 3 * n) == 0
+            && std::memcmp(e.numbers.data(), numbers, sizeof(int) * n) == 0) {
+            entries_.splice(entries_.begin(), entries_, it->second);
+            ++stats_.hits;
+            return &entries_.front();
+        }
+    }
+    ++stats_.misses;
+    return nullptr;
+}
+
+void ResultCache::insert(const double* positions, const int* numbers, int num_atoms,
+                         const double* cell, const int* pbc,
+                         double energy, const double* forces, const std::string& precision)
+{
+    if (!enabled() || num_atoms <= 0) return;
+
+    Entry e;
+    read_cell(cell, pbc, e.cell, e.pbc, e.periodic);
+    e.hash = hash_input(positions, numbers, num_atoms, e.cell, e.pbc, e.periodic);
+    e.positions.assign(positions, positions + 3 * num_atoms);
+    e.numbers.assign(numbers, numbers + num_atoms);
+    e.energy = energy;
+    e.forces.assign(forces, forces + 3 * num_atoms);
+    e.precision = precision;
+
+    const size_t size = e.bytes();
+    if (size > max_bytes_) return;
+
+    auto it = index_.find(e.hash);
+    if (it != index_.end()) {
+        /* Same hash: replace the older configuration */
+        bytes_ -= it->second->bytes();
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+    evict_to(max_bytes_ - size);
+    entries_.push_front(std::move(e));
+    index_[entries_.front().hash] = entries_.begin();
+    bytes_ += size;
+}
+
+void ResultCache::clear()
+{
+    entries_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+void ResultCache::evict_to(size_t limit)
+{
+    while (bytes_ > limit && !entries_.empty()) {
+        const Entry& last = entries_.back();
+        bytes_ -= last.bytes();
+        index_.erase(last.hash);
+        entries_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+}  // namespace mace_cache
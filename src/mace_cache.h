@@ -0,0 +1,73 @@
+#ifndef MACE_CACHE_H
+#define MACE_CACHE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Per-handle LRU cache of calculation results.
+ *
+ * Entries are keyed by a 64-bit hash of the exact input bytes (positions,
+ * atomic numbers, cell, pbc); a hit is confirmed against the stored
+ * configuration, so only bit-identical inputs are served. The cache is
+ * bounded by an approximate byte budget and evicts least recently used
+ * entries first.
+ */
+namespace mace_cache {
+
+struct Entry {
+    uint64_t hash;
+    std::vector<double> positions;
+    std::vector<int> numbers;
+    std::array<double, 9> cell;
+    std::array<int, 3> pbc;
+    bool periodic;
+    double energy;
+    std::vector<double> forces;
+    std::string precision;
+
+    size_t bytes() const;
+};
+
+struct Stats {
+    long long hits = 0;
+    long long misses = 0;
+    long long evictions = 0;
+};
+
+class ResultCache {
+public:
+    /* max_bytes == 0 disables the cache and drops all entries */
+    void set_capacity(size_t max_bytes);
+    bool enabled() const { return max_bytes_ > 0; }
+
+    /* cell/pbc may be nullptr for non-periodic inputs */
+    const Entry* find(const double* positions, const int* numbers, int num_atoms,
+                      const double* cell, const int* pbc);
+    void insert(const double* positions, const int* numbers, int num_atoms,
+                const double* cell, const int* pbc,
+                double energy, const double* forces, const std::string& precision);
+    void clear();
+
+    const Stats& stats() const { return stats_; }
+    size_t size() const { return entries_.size(); }
+    size_t bytes() const { return bytes_; }
+
+private:
+    void evict_to(size_t limit);
+
+    size_t max_bytes_ = 0;
+    size_t bytes_ = 0;
+    Stats stats_;
+    std::list<Entry> entries_;      /* most recently used first */
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+};
+
+}  // namespace mace_cache
+
+#endif /* MACE_CACHE_H */
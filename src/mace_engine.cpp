@@ -0,0 +1,1183 @@
+#include "mace_engine.h"
+#include "mace_kernels.h"
+#include "mace_wrapper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace mace_engine {
+
+namespace {
+
+/* ------------------------------------------------------------------------
+ * Flat tensor file
+ *
+ *   "MACENAT1" | uint32 count | count x tensor
+ *   tensor: uint32 name_len | name | uint32 kind (0=f64, 1=i64)
+ *           | uint32 ndim | int64 shape[ndim] | 8-byte little-endian data
+ * ------------------------------------------------------------------------ */
+
+struct Tensor {
+    std::vector<int64_t> shape;
+    std::vector<double> f;
+    std::vector<int64_t> i;
+
+    int64_t numel() const {
+        int64_t n = 1;
+        for (int64_t s : shape) n *= s;
+        return n;
+    }
+};
+
+class TensorFile {
+public:
+    explicit TensorFile(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open native model: " + path);
+
+        char magic[8];
+        in.read(magic, 8);
+        if (!in || std::memcmp(magic, "MACENAT1", 8) != 0) {
+            throw std::runtime_error("Not a native MACE model: " + path);
+        }
+
+        uint32_t count = read<uint32_t>(in);
+        for (uint32_t t = 0; t < count; ++t) {
+            uint32_t name_len = read<uint32_t>(in);
+            std::string name(name_len, '\0');
+            in.read(&name[0], name_len);
+            uint32_t kind = read<uint32_t>(in);
+            uint32_t ndim = read<uint32_t>(in);
+
+            Tensor tensor;
+            tensor.shape.resize(ndim);
+            for (uint32_t d = 0; d < ndim; ++d) tensor.shape[d] = read<int64_t>(in);
+            const int64_t n = tensor.numel();
+            if (kind == 0) {
+                tensor.f.resize(n);
+                in.read(reinterpret_cast<char*>(tensor.f.data()), n * sizeof(double));
+            } else {
+                tensor.i.resize(n);
+                in.read(reinterpret_cast<char*>(tensor.i.data()), n * sizeof(int64_t));
+            }
+            if (!in) throw std::runtime_error("Truncated native model: " + path);
+            tensors_.emplace(std::move(name), std::move(tensor));
+        }
+    }
+
+    bool has(const std::string& name) const { return tensors_.count(name) != 0; }
+
+    const Tensor& get(const std::string& name) const
+    {
+        auto it = tensors_.find(name);
+        if (it == tensors_.end()) throw std::runtime_error("Native model is missing " + name);
+        return it->second;
+    }
+
+    const std::vector<double>& floats(const std::string& name) const
+    {
+        const Tensor& t = get(name);
+        if (t.f.empty() && t.numel() != 0) throw std::runtime_error(name + " is not a float tensor");
+        return t.f;
+    }
+
+    const std::vector<int64_t>& ints(const std::string& name) const
+    {
+        const Tensor& t = get(name);
+        if (t.i.empty() && t.numel() != 0) throw std::runtime_error(name + " is not an integer tensor");
+        return t.i;
+    }
+
+    double scalar(const std::string& name) const { return floats(name).at(0); }
+    int64_t integer(const std::string& name) const { return ints(name).at(0); }
+
+private:
+    template <typename V>
+    static V read(std::ifstream& in)
+    {
+        V v{};
+        in.read(reinterpret_cast<char*>(&v), sizeof(V));
+        return v;
+    }
+
+    std::map<std::string, Tensor> tensors_;
+};
+
+template <typename T>
+std::vector<T> convert(const std::vector<double>& v)
+{
+    return std::vector<T>(v.begin(), v.end());
+}
+
+template <typename T> inline T silu(T x) { return x / (T(1) + std::exp(-x)); }
+
+template <typename T> inline T dsilu(T x)
+{
+    T s = T(1) / (T(1) + std::exp(-x));
+    return s * (T(1) + x * (T(1) - s));
+}
+
+/* ------------------------------------------------------------------------
+ * Feature layout
+ *
+ * Every equivariant feature is a list of blocks with C channels and one
+ * irrep each, stored per node as [2l+1][C] so every kernel vectorizes over
+ * channels. The exporter splits e3nn irreps into these blocks.
+ * ------------------------------------------------------------------------ */
+
+struct BlockLayout {
+    std::vector<int> ls;
+    std::vector<int> offsets;
+    int size = 0;
+    int channels = 0;
+
+    void init(const std::vector<int64_t>& block_ls, int c)
+    {
+        channels = c;
+        ls.assign(block_ls.begin(), block_ls.end());
+        offsets.resize(ls.size());
+        size = 0;
+        for (size_t b = 0; b < ls.size(); ++b) {
+            offsets[b] = size;
+            size += (2 * ls[b] + 1) * c;
+        }
+    }
+};
+
+/*
+ * e3nn o3.Linear between block layouts, optionally with one weight set per
+ * element (the residual skip_tp against one-hot node attributes).
+ */
+template <typename T>
+struct Linear {
+    BlockLayout in, out;
+    std::vector<int> block_in, block_out;
+    std::vector<T> weights;   /* [pairs][sets][C][C] */
+    int sets = 1;
+
+    void load(const TensorFile& f, const std::string& prefix,
+              const BlockLayout& in_layout, const BlockLayout& out_layout)
+    {
+        in = in_layout;
+        out = out_layout;
+        const Tensor& pairs = f.get(prefix + ".pairs");
+        const Tensor& w = f.get(prefix + ".weights");
+        const int n = static_cast<int>(pairs.shape.at(0));
+        const int C = in.channels;
+        sets = w.shape.size() == 4 ? static_cast<int>(w.shape[1]) : 1;
+        if (w.numel() != static_cast<int64_t>(n) * sets * C * C) {
+            throw std::runtime_error(prefix + ": weight shape does not match block pairs");
+        }
+        for (int p = 0; p < n; ++p) {
+            block_in.push_back(static_cast<int>(pairs.i[2 * p]));
+            block_out.push_back(static_cast<int>(pairs.i[2 * p + 1]));
+            if (in.ls.at(block_in.back()) != out.ls.at(block_out.back())) {
+                throw std::runtime_error(prefix + ": linear maps between different irreps");
+            }
+        }
+        weights = convert<T>(w.f);
+    }
+
+    const T* w(size_t p, int set) const
+    {
+        const size_t C = in.channels;
+        return weights.data() + (p * sets + set) * C * C;
+    }
+
+    /* y += x W for one node */
+    void forward(const T* x, T* y, int set = 0) const
+    {
+        const int C = in.channels;
+        for (size_t p = 0; p < block_in.size(); ++p) {
+            const int d = 2 * in.ls[block_in[p]] + 1;
+            const T* W = w(p, set);
+            for (int m = 0; m < d; ++m) {
+                const T* xr = x + in.offsets[block_in[p]] + m * C;
+                T* yr = y + out.offsets[block_out[p]] + m * C;
+                for (int u = 0; u < C; ++u) {
+                    const T xu = xr[u];
+                    if (xu == T(0)) continue;
+                    const T* wr = W + u * C;
+                    for (int v = 0; v < C; ++v) yr[v] += xu * wr[v];
+                }
+            }
+        }
+    }
+
+    /* gx += gy W^T for one node */
+    void backward(const T* gy, T* gx, int set = 0) const
+    {
+        const int C = in.channels;
+        for (size_t p = 0; p < block_in.size(); ++p) {
+            const int d = 2 * in.ls[block_in[p]] + 1;
+            const T* W = w(p, set);
+            for (int m = 0; m < d; ++m) {
+                const T* gyr = gy + out.offsets[block_out[p]] + m * C;
+                T* gxr = gx + in.offsets[block_in[p]] + m * C;
+                for (int u = 0; u < C; ++u) {
+                    const T* wr = W + u * C;
+                    T acc = T(0);
+                    for (int v = 0; v < C; ++v) acc += gyr[v] * wr[v];
+                    gxr[u] += acc;
+                }
+            }
+        }
+    }
+};
+
+/* e3nn FullyConnectedNet with normalized SiLU; weights carry the 1/sqrt(fan_in) */
+template <typename T>
+struct RadialMLP {
+    std::vector<std::vector<T>> w;
+    std::vector<int> dims;
+    T act_scale = T(1);
+    int hidden_size = 0;   /* sum of hidden widths, cached per edge */
+
+    void load(const TensorFile& f, const std::string& prefix)
+    {
+        const int layers = static_cast<int>(f.integer(prefix + ".num_layers"));
+        act_scale = static_cast<T>(f.scalar(prefix + ".act_scale"));
+        for (int i = 0; i < layers; ++i) {
+            const Tensor& t = f.get(prefix + ".w" + std::to_string(i));
+            if (i == 0) dims.push_back(static_cast<int>(t.shape.at(0)));
+            if (t.shape.at(0) != dims.back()) throw std::runtime_error(prefix + ": layer size mismatch");
+            dims.push_back(static_cast<int>(t.shape.at(1)));
+            w.push_back(convert<T>(t.f));
+        }
+        hidden_size = 0;
+        for (size_t i = 1; i + 1 < dims.size(); ++i) hidden_size += dims[i];
+    }
+
+    int in_dim() const { return dims.front(); }
+    int out_dim() const { return dims.back(); }
+
+    /* pre: [hidden_size] pre-activations for the backward pass; scratch: 2 * max width */
+    void forward(const T* x, T* y, T* pre, T* scratch) const
+    {
+        const int max_width = *std::max_element(dims.begin(), dims.end());
+        T* h = scratch;
+        T* z = scratch + max_width;
+        std::copy(x, x + dims[0], h);
+        for (size_t l = 0; l < w.size(); ++l) {
+            const int n_in = dims[l], n_out = dims[l + 1];
+            const bool last = l + 1 == w.size();
+            T* dst = last ? y : z;
+            std::fill(dst, dst + n_out, T(0));
+            for (int i = 0; i < n_in; ++i) {
+                const T hi = h[i];
+                const T* wr = w[l].data() + static_cast<size_t>(i) * n_out;
+                for (int o = 0; o < n_out; ++o) dst[o] += hi * wr[o];
+            }
+            if (!last) {
+                std::copy(z, z + n_out, pre);
+                pre += n_out;
+                for (int o = 0; o < n_out; ++o) h[o] = act_scale * silu(z[o]);
+            }
+        }
+    }
+
+    void backward(const T* pre, const T* gy, T* gx, T* scratch) const
+    {
+        const int max_width = *std::max_element(dims.begin(), dims.end());
+        T* g = scratch;
+        T* gprev = scratch + max_width;
+        std::copy(gy, gy + dims.back(), g);
+        const T* pre_end = pre + hidden_size;
+        for (size_t l = w.size(); l-- > 0;) {
+            const int n_in = dims[l], n_out = dims[l + 1];
+            if (l + 1 != w.size()) {
+                pre_end -= n_out;
+                for (int o = 0; o < n_out; ++o) g[o] *= act_scale * dsilu(pre_end[o]);
+            }
+            T* dst = l == 0 ? gx : gprev;
+            for (int i = 0; i < n_in; ++i) {
+                const T* wr = w[l].data() + static_cast<size_t>(i) * n_out;
+                T acc = T(0);
+                for (int o = 0; o < n_out; ++o) acc += wr[o] * g[o];
+                dst[i] = acc;
+            }
+            if (l != 0) std::copy(gprev, gprev + n_in, g);
+        }
+    }
+};
+
+/* "uvu" tensor product of node features with edge spherical harmonics */
+struct TPPath {
+    int block_in;
+    int l_sh;
+    int block_out;
+    int weight_index;   /* weights for this path are w[weight_index * C + c] */
+};
+
+template <typename T>
+struct TPCoeff {
+    int path, m1, m2, m3;
+    T value;
+};
+
+/* One irrep of the symmetric contraction: per-channel polynomial in A */
+template <typename T>
+struct SymTerm {
+    int M;
+    int idx[4];
+    int k;
+    T value;
+};
+
+template <typename T>
+struct SymOutput {
+    int block = 0;
+    int correlation = 0;
+    std::vector<std::vector<SymTerm<T>>> terms;   /* [nu-1] */
+    std::vector<std::vector<T>> weights;          /* [nu-1][elements][K][C] */
+    std::vector<int> num_params;                  /* [nu-1] */
+};
+
+template <typename T>
+struct Readout {
+    bool nonlinear = false;
+    int hidden = 0;
+    T act_scale = T(1);
+    std::vector<T> w;    /* linear: [C] */
+    std::vector<T> w1;   /* nonlinear: [C][hidden] */
+    std::vector<T> w2;   /* nonlinear: [hidden] */
+
+    void load(const TensorFile& f, const std::string& prefix, int C)
+    {
+        nonlinear = f.integer(prefix + ".kind") == 1;
+        if (!nonlinear) {
+            w = convert<T>(f.floats(prefix + ".w"));
+            if (static_cast<int>(w.size()) != C) throw std::runtime_error(prefix + ": bad readout size");
+            return;
+        }
+        const Tensor& t1 = f.get(prefix + ".w1");
+        hidden = static_cast<int>(t1.shape.at(1));
+        w1 = convert<T>(t1.f);
+        w2 = convert<T>(f.floats(prefix + ".w2"));
+        act_scale = static_cast<T>(f.scalar(prefix + ".act_scale"));
+    }
+
+    /* Scalar channels h[C] -> node energy; pre caches hidden pre-activations */
+    T forward(const T* h, int C, T* pre) const
+    {
+        if (!nonlinear) {
+            T e = T(0);
+            for (int c = 0; c < C; ++c) e += h[c] * w[c];
+            return e;
+        }
+        std::fill(pre, pre + hidden, T(0));
+        for (int c = 0; c < C; ++c) {
+            const T* wr = w1.data() + static_cast<size_t>(c) * hidden;
+            for (int j = 0; j < hidden; ++j) pre[j] += h[c] * wr[j];
+        }
+        T e = T(0);
+        for (int j = 0; j < hidden; ++j) e += act_scale * silu(pre[j]) * w2[j];
+        return e;
+    }
+
+    void backward(T ge, int C, const T* pre, T* gh) const
+    {
+        if (!nonlinear) {
+            for (int c = 0; c < C; ++c) gh[c] += ge * w[c];
+            return;
+        }
+        for (int c = 0; c < C; ++c) {
+            const T* wr = w1.data() + static_cast<size_t>(c) * hidden;
+            T acc = T(0);
+            for (int j = 0; j < hidden; ++j) acc += wr[j] * w2[j] * act_scale * dsilu(pre[j]);
+            gh[c] += ge * acc;
+        }
+    }
+};
+
+template <typename T>
+struct Layer {
+    BlockLayout node;     /* input node features */
+    BlockLayout mid;      /* tensor-product output */
+    BlockLayout message;  /* A features: l = 0..lmax_sh */
+    BlockLayout hidden;   /* output node features */
+
+    Linear<T> linear_up;
+    RadialMLP<T> radial;
+    std::vector<TPPath> paths;
+    std::vector<TPCoeff<T>> coeffs;
+    Linear<T> linear;          /* includes 1/avg_num_neighbors; per element when
+                                  the block has no residual (skip_tp folded in) */
+    Linear<T> skip;            /* per element */
+    std::vector<SymOutput<T>> symmetric;
+    Linear<T> product_linear;
+    bool use_sc = true;
+    Readout<T> readout;
+};
+
+/* ------------------------------------------------------------------------
+ * Neighbor list: binned search over periodic images, edges sorted by
+ * receiver with a sender index for gradient scatters.
+ * ------------------------------------------------------------------------ */
+
+struct NeighborList {
+    std::vector<int> sender, receiver;
+    std::vector<double> vectors;      /* [E][3] pos[receiver] - pos[sender image] */
+    std::vector<int> recv_ptr;        /* [n+1] */
+    std::vector<int> send_ptr;        /* [n+1] */
+    std::vector<int> send_edges;      /* edge ids grouped by sender */
+
+    size_t num_edges() const { return sender.size(); }
+};
+
+bool invert3(const double* m, double* inv)
+{
+    const double det = m[0] * (m[4] * m[8] - m[5] * m[7])
+                     - m[1] * (m[3] * m[8] - m[5] * m[6])
+                     + m[2] * (m[3] * m[7] - m[4] * m[6]);
+    if (std::fabs(det) < 1e-12) return false;
+    const double id = 1.0 / det;
+    inv[0] = (m[4] * m[8] - m[5] * m[7]) * id;
+    inv[1] = (m[2] * m[7] - m[1] * m[8]) * id;
+    inv[2] = (m[1] * m[5] - m[2] * m[4]) * id;
+    inv[3] = (m[5] * m[6] - m[3] * m[8]) * id;
+    inv[4] = (m[0] * m[8] - m[2] * m[6]) * id;
+    inv[5] = (m[2] * m[3] - m[0] * m[5]) * id;
+    inv[6] = (m[3] * m[7] - m[4] * m[6]) * id;
+    inv[7] = (m[1] * m[6] - m[0] * m[7]) * id;
+    inv[8] = (m[0] * m[4] - m[1] * m[3]) * id;
+    return true;
+}
+
+void build_neighbors(const double* positions, int n, const double* cell, const int* pbc,
+                     double r_max, int threads, NeighborList& nl)
+{
+    (void)threads;
+    bool periodic[3] = {false, false, false};
+    if (cell && pbc) {
+        for (int a = 0; a < 3; ++a) periodic[a] = pbc[a] != 0;
+    }
+    const bool any_periodic = periodic[0] || periodic[1] || periodic[2];
+
+    /* Wrap periodic directions into the cell; edge vectors are unaffected */
+    std::vector<double> wrapped(positions, positions + 3 * static_cast<size_t>(n));
+    int range[3] = {0, 0, 0};
+    if (any_periodic) {
+        double inv[9];
+        if (!invert3(cell, inv)) throw std::runtime_error("Singular cell matrix");
+        for (int i = 0; i < n; ++i) {
+            double frac[3];
+            for (int a = 0; a < 3; ++a) {
+                frac[a] = positions[3 * i + 0] * inv[0 * 3 + a]
+                        + positions[3 * i + 1] * inv[1 * 3 + a]
+                        + positions[3 * i + 2] * inv[2 * 3 + a];
+            }
+            for (int a = 0; a < 3; ++a) {
+                if (!periodic[a]) continue;
+                const double shift = std::floor(frac[a]);
+                for (int d = 0; d < 3; ++d) wrapped[3 * i + d] -= shift * cell[3 * a + d];
+            }
+        }
+        /* Lattice planes along a are 1/|inv[:, a]| apart */
+        for (int a = 0; a < 3; ++a) {
+            if (!periodic[a]) continue;
+            const double norm = std::sqrt(inv[a] * inv[a] + inv[3 + a] * inv[3 + a] + inv[6 + a] * inv[6 + a]);
+            range[a] = static_cast<int>(std::ceil(r_max * norm));
+        }
+    }
+
+    double lo[3], hi[3];
+    for (int d = 0; d < 3; ++d) { lo[d] = 1e300; hi[d] = -1e300; }
+    for (int i = 0; i < n; ++i) {
+        for (int d = 0; d < 3; ++d) {
+            lo[d] = std::min(lo[d], wrapped[3 * i + d]);
+            hi[d] = std::max(hi[d], wrapped[3 * i + d]);
+        }
+    }
+    for (int d = 0; d < 3; ++d) { lo[d] -= r_max; hi[d] += r_max; }
+
+    /* Image points that can be within r_max of a real atom */
+    std::vector<double> points;
+    std::vector<int> point_atom;
+    std::vector<char> point_is_self;
+    for (int s0 = -range[0]; s0 <= range[0]; ++s0)
+    for (int s1 = -range[1]; s1 <= range[1]; ++s1)
+    for (int s2 = -range[2]; s2 <= range[2]; ++s2) {
+        double offset[3] = {0.0, 0.0, 0.0};
+        if (any_periodic) {
+            for (int d = 0; d < 3; ++d) {
+                offset[d] = s0 * cell[d] + s1 * cell[3 + d] + s2 * cell[6 + d];
+            }
+        }
+        const bool home = s0 == 0 && s1 == 0 && s2 == 0;
+        for (int i = 0; i < n; ++i) {
+            double q[3];
+            bool inside = true;
+            for (int d = 0; d < 3; ++d) {
+                q[d] = wrapped[3 * i + d] + offset[d];
+                inside = inside && q[d] >= lo[d] && q[d] <= hi[d];
+            }
+            if (!inside) continue;
+            points.insert(points.end(), q, q + 3);
+            point_atom.push_back(i);
+            point_is_self.push_back(home ? 1 : 0);
+        }
+    }
+
+    /* Bins at least r_max wide, capped so sparse systems do not explode */
+    const size_t num_points = point_atom.size();
+    int dims[3];
+    double width[3];
+    for (int d = 0; d < 3; ++d) {
+        dims[d] = std::max(1, static_cast<int>((hi[d] - lo[d]) / r_max));
+    }
+    while (static_cast<double>(dims[0]) * dims[1] * dims[2] > 8.0 * num_points + 64) {
+        int widest = 0;
+        for (int d = 1; d < 3; ++d) if (dims[d] > dims[widest]) widest = d;
+        dims[widest] = std::max(1, dims[widest] / 2);
+    }
+    for (int d = 0; d < 3; ++d) width[d] = (hi[d] - lo[d]) / dims[d];
+
+    auto bin_of = [&](const double* q, int* b) {
+        for (int d = 0; d < 3; ++d) {
+            b[d] = std::min(dims[d] - 1, std::max(0, static_cast<int>((q[d] - lo[d]) / width[d])));
+        }
+    };
+
+    const size_t num_bins = static_cast<size_t>(dims[0]) * dims[1] * dims[2];
+    std::vector<int> bin_start(num_bins + 1, 0);
+    std::vector<int> point_bin(num_points);
+    for (size_t p = 0; p < num_points; ++p) {
+        int b[3];
+        bin_of(&points[3 * p], b);
+        point_bin[p] = (b[0] * dims[1] + b[1]) * dims[2] + b[2];
+        bin_start[point_bin[p] + 1]++;
+    }
+    for (size_t b = 0; b < num_bins; ++b) bin_start[b + 1] += bin_start[b];
+    std::vector<int> bin_points(num_points);
+    {
+        std::vector<int> fill(bin_start.begin(), bin_start.end() - 1);
+        for (size_t p = 0; p < num_points; ++p) bin_points[fill[point_bin[p]]++] = static_cast<int>(p);
+    }
+
+    const double r2max = r_max * r_max;
+    auto visit = [&](int i, auto&& emit) {
+        const double* pi = &wrapped[3 * i];
+        int b[3];
+        bin_of(pi, b);
+        for (int b0 = std::max(0, b[0] - 1); b0 <= std::min(dims[0] - 1, b[0] + 1); ++b0)
+        for (int b1 = std::max(0, b[1] - 1); b1 <= std::min(dims[1] - 1, b[1] + 1); ++b1)
+        for (int b2 = std::max(0, b[2] - 1); b2 <= std::min(dims[2] - 1, b[2] + 1); ++b2) {
+            const int bin = (b0 * dims[1] + b1) * dims[2] + b2;
+            for (int k = bin_start[bin]; k < bin_start[bin + 1]; ++k) {
+                const int p = bin_points[k];
+                const int j = point_atom[p];
+                if (j == i && point_is_self[p]) continue;
+                const double dx = pi[0] - points[3 * p + 0];
+                const double dy = pi[1] - points[3 * p + 1];
+                const double dz = pi[2] - points[3 * p + 2];
+                if (dx * dx + dy * dy + dz * dz < r2max) emit(j, dx, dy, dz);
+            }
+        }
+    };
+
+    /* Two passes over receivers: count, then fill in place */
+    nl.recv_ptr.assign(n + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(threads)
+    for (int i = 0; i < n; ++i) {
+        int count = 0;
+        visit(i, [&](int, double, double, double) { ++count; });
+        nl.recv_ptr[i + 1] = count;
+    }
+    for (int i = 0; i < n; ++i) nl.recv_ptr[i + 1] += nl.recv_ptr[i];
+
+    const size_t E = nl.recv_ptr[n];
+    nl.sender.resize(E);
+    nl.receiver.resize(E);
+    nl.vectors.resize(3 * E);
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(threads)
+    for (int i = 0; i < n; ++i) {
+        size_t e = nl.recv_ptr[i];
+        visit(i, [&](int j, double dx, double dy, double dz) {
+            nl.sender[e] = j;
+            nl.receiver[e] = i;
+            nl.vectors[3 * e + 0] = dx;
+            nl.vectors[3 * e + 1] = dy;
+            nl.vectors[3 * e + 2] = dz;
+            ++e;
+        });
+    }
+
+    nl.send_ptr.assign(n + 1, 0);
+    for (size_t e = 0; e < E; ++e) nl.send_ptr[nl.sender[e] + 1]++;
+    for (int i = 0; i < n; ++i) nl.send_ptr[i + 1] += nl.send_ptr[i];
+    nl.send_edges.resize(E);
+    std::vector<int> fill(nl.send_ptr.begin(), nl.send_ptr.end() - 1);
+    for (size_t e = 0; e < E; ++e) nl.send_edges[fill[nl.sender[e]]++] = static_cast<int>(e);
+}
+
+/* ------------------------------------------------------------------------
+ * Model
+ * ------------------------------------------------------------------------ */
+
+template <typename T>
+class Model : public Engine {
+public:
+    Model(const TensorFile& f, int num_threads)
+    {
+#ifdef _OPENMP
+        threads_ = num_threads > 0 ? num_threads : omp_get_max_threads();
+#else
+        (void)num_threads;
+        threads_ = 1;
+#endif
+        if (f.integer("meta.version") != 1) throw std::runtime_error("Unsupported native model version");
+
+        r_max_ = f.scalar("meta.r_max");
+        num_bessel_ = static_cast<int>(f.integer("meta.num_bessel"));
+        cutoff_p_ = static_cast<int>(f.integer("meta.cutoff_p"));
+        lmax_sh_ = static_cast<int>(f.integer("meta.lmax_sh"));
+        C_ = static_cast<int>(f.integer("meta.channels"));
+        scale_ = f.scalar("meta.scale");
+        shift_ = f.scalar("meta.shift");
+        if (lmax_sh_ > mace_kernels::kMaxSphericalHarmonicsL) {
+            throw std::runtime_error("Native engine supports max_ell <= 3");
+        }
+
+        const std::vector<int64_t>& zs = f.ints("atomic_numbers");
+        for (size_t e = 0; e < zs.size(); ++e) species_[static_cast<int>(zs[e])] = static_cast<int>(e);
+        num_elements_ = static_cast<int>(zs.size());
+        e0_ = f.floats("atomic_energies");
+        embedding_ = convert<T>(f.floats("embedding"));
+
+        std::vector<int64_t> sh_ls;
+        for (int l = 0; l <= lmax_sh_; ++l) sh_ls.push_back(l);
+
+        const int num_layers = static_cast<int>(f.integer("meta.num_interactions"));
+        layers_.resize(num_layers);
+        for (int t = 0; t < num_layers; ++t) {
+            const std::string p = "layers." + std::to_string(t) + ".";
+            Layer<T>& L = layers_[t];
+            L.node.init(f.ints(p + "node_ls"), C_);
+            L.mid.init(f.ints(p + "mid_ls"), C_);
+            L.message.init(sh_ls, C_);
+            L.hidden.init(f.ints(p + "hidden_ls"), C_);
+            if (t > 0 && L.node.ls != layers_[t - 1].hidden.ls) {
+                throw std::runtime_error("Layer " + std::to_string(t) + " input does not match previous output");
+            }
+
+            L.linear_up.load(f, p + "linear_up", L.node, L.node);
+            L.radial.load(f, p + "radial");
+            if (L.radial.in_dim() != num_bessel_) throw std::runtime_error("Radial MLP input size mismatch");
+
+            const Tensor& paths = f.get(p + "conv_tp.paths");
+            for (int64_t k = 0; k < paths.shape.at(0); ++k) {
+                L.paths.push_back({static_cast<int>(paths.i[4 * k + 0]), static_cast<int>(paths.i[4 * k + 1]),
+                                   static_cast<int>(paths.i[4 * k + 2]), static_cast<int>(paths.i[4 * k + 3])});
+            }
+            const Tensor& coeffs = f.get(p + "conv_tp.coeffs");
+            for (int64_t k = 0; k < coeffs.shape.at(0); ++k) {
+                const double* c = &coeffs.f[5 * k];
+                L.coeffs.push_back({static_cast<int>(c[0]), static_cast<int>(c[1]), static_cast<int>(c[2]),
+                                    static_cast<int>(c[3]), static_cast<T>(c[4])});
+            }
+            if (L.radial.out_dim() != static_cast<int>(L.paths.size()) * C_) {
+                throw std::runtime_error("Radial MLP output does not match tensor-product paths");
+            }
+
+            L.linear.load(f, p + "linear", L.mid, L.message);
+            L.skip.load(f, p + "skip", L.node, L.hidden);
+            L.use_sc = f.integer(p + "product.use_sc") != 0;
+
+            const int num_out = static_cast<int>(f.integer(p + "product.num_out"));
+            for (int j = 0; j < num_out; ++j) {
+                const std::string q = p + "product.out" + std::to_string(j) + ".";
+                SymOutput<T> so;
+                so.block = static_cast<int>(f.integer(q + "block"));
+                so.correlation = static_cast<int>(f.integer(q + "correlation"));
+                if (so.correlation > 4) throw std::runtime_error("Native engine supports correlation <= 4");
+                for (int nu = 1; nu <= so.correlation; ++nu) {
+                    const Tensor& u = f.get(q + "u" + std::to_string(nu));
+                    const Tensor& w = f.get(q + "w" + std::to_string(nu));
+                    const int cols = nu + 3;
+                    std::vector<SymTerm<T>> terms;
+                    for (int64_t k = 0; k < u.shape.at(0); ++k) {
+                        const double* r = &u.f[cols * k];
+                        SymTerm<T> term{};
+                        term.M = static_cast<int>(r[0]);
+                        for (int a = 0; a < nu; ++a) term.idx[a] = static_cast<int>(r[1 + a]);
+                        term.k = static_cast<int>(r[1 + nu]);
+                        term.value = static_cast<T>(r[2 + nu]);
+                        terms.push_back(term);
+                    }
+                    so.terms.push_back(std::move(terms));
+                    so.num_params.push_back(static_cast<int>(w.shape.at(1)));
+                    so.weights.push_back(convert<T>(w.f));
+                }
+                L.symmetric.push_back(std::move(so));
+            }
+            L.product_linear.load(f, p + "product.linear", L.hidden, L.hidden);
+            L.readout.load(f, p + "readout", C_);
+        }
+    }
+
+    double cutoff() const override { return r_max_; }
+    int num_interactions() const override { return static_cast<int>(layers_.size()); }
+
+    void compute(const double* positions, const int* atomic_numbers, int n,
+                 const double* cell, const int* pbc, Output& out) override;
+
+private:
+    void symmetric_forward(const SymOutput<T>& so, const T* A, T* B, int element) const;
+    void symmetric_backward(const SymOutput<T>& so, const T* A, const T* gB, T* gA, int element) const;
+
+    int threads_ = 1;
+    double r_max_ = 0.0;
+    int num_bessel_ = 0;
+    int cutoff_p_ = 0;
+    int lmax_sh_ = 0;
+    int C_ = 0;
+    double scale_ = 1.0;
+    double shift_ = 0.0;
+    int num_elements_ = 0;
+    std::map<int, int> species_;
+    std::vector<double> e0_;
+    std::vector<T> embedding_;   /* [elements][C] */
+    std::vector<Layer<T>> layers_;
+};
+
+/* B[M][c] += sum_terms value * W[elem][k][c] * prod_a A[idx_a][c] */
+template <typename T>
+void Model<T>::symmetric_forward(const SymOutput<T>& so, const T* A, T* B, int element) const
+{
+    const int C = C_;
+    for (int nu = 1; nu <= so.correlation; ++nu) {
+        const int K = so.num_params[nu - 1];
+        const T* W = so.weights[nu - 1].data() + static_cast<size_t>(element) * K * C;
+        for (const SymTerm<T>& t : so.terms[nu - 1]) {
+            const T* w = W + static_cast<size_t>(t.k) * C;
+            T* b = B + t.M * C;
+            const T* a0 = A + t.idx[0] * C;
+            if (nu == 1) {
+                for (int c = 0; c < C; ++c) b[c] += t.value * w[c] * a0[c];
+            } else if (nu == 2) {
+                const T* a1 = A + t.idx[1] * C;
+                for (int c = 0; c < C; ++c) b[c] += t.value * w[c] * a0[c] * a1[c];
+            } else if (nu == 3) {
+                const T* a1 = A + t.idx[1] * C;
+                const T* a2 = A + t.idx[2] * C;
+                for (int c = 0; c < C; ++c) b[c] += t.value * w[c] * a0[c] * a1[c] * a2[c];
+            } else {
+                for (int c = 0; c < C; ++c) {
+                    T prod = t.value * w[c];
+                    for (int a = 0; a < nu; ++a) prod *= A[t.idx[a] * C + c];
+                    b[c] += prod;
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void Model<T>::symmetric_backward(const SymOutput<T>& so, const T* A, const T* gB, T* gA, int element) const
+{
+    const int C = C_;
+    for (int nu = 1; nu <= so.correlation; ++nu) {
+        const int K = so.num_params[nu - 1];
+        const T* W = so.weights[nu - 1].data() + static_cast<size_t>(element) * K * C;
+        for (const SymTerm<T>& t : so.terms[nu - 1]) {
+            const T* w = W + static_cast<size_t>(t.k) * C;
+            const T* gb = gB + t.M * C;
+            for (int a = 0; a < nu; ++a) {
+                T* ga = gA + t.idx[a] * C;
+                for (int c = 0; c < C; ++c) {
+                    T prod = t.value * w[c] * gb[c];
+                    for (int o = 0; o < nu; ++o) {
+                        if (o != a) prod *= A[t.idx[o] * C + c];
+                    }
+                    ga[c] += prod;
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void Model<T>::compute(const double* positions, const int* atomic_numbers, int n,
+                       const double* cell, const int* pbc, Output& out)
+{
+    const int C = C_;
+    const int threads = threads_;
+
+    std::vector<int> element(n);
+    for (int i = 0; i < n; ++i) {
+        auto it = species_.find(atomic_numbers[i]);
+        if (it == species_.end()) {
+            throw std::runtime_error("Atomic number " + std::to_string(atomic_numbers[i]) +
+                                     " is not supported by this model");
+        }
+        element[i] = it->second;
+    }
+
+    NeighborList nl;
+    build_neighbors(positions, n, cell, pbc, r_max_, threads, nl);
+    const size_t E = nl.num_edges();
+
+    /* Edge features and their derivatives in one pass */
+    const int nsh = mace_kernels::num_spherical_harmonics(lmax_sh_);
+    std::vector<T> vec(nl.vectors.begin(), nl.vectors.end());
+    std::vector<T> Y(E * nsh), dY(E * nsh * 3), R(E * num_bessel_), dR(E * num_bessel_);
+    #pragma omp parallel num_threads(threads)
+    {
+#ifdef _OPENMP
+        const int nt = omp_get_num_threads(), tid = omp_get_thread_num();
+#else
+        const int nt = 1, tid = 0;
+#endif
+        const size_t chunk = (E + nt - 1) / nt;
+        const size_t e0 = std::min(E, chunk * tid), e1 = std::min(E, e0 + chunk);
+        if (e1 > e0) {
+            mace_kernels::edge_features<T>(vec.data() + 3 * e0, e1 - e0, lmax_sh_,
+                                           static_cast<T>(r_max_), num_bessel_, cutoff_p_,
+                                           Y.data() + e0 * nsh, dY.data() + e0 * nsh * 3,
+                                           R.data() + e0 * num_bessel_, dR.data() + e0 * num_bessel_);
+        }
+    }
+
+    /* ---------------- forward ---------------- */
+    const int T_layers = static_cast<int>(layers_.size());
+    std::vector<std::vector<T>> h(T_layers + 1);    /* h[t] is the input of layer t */
+    std::vector<std::vector<T>> hu(T_layers), A(T_layers), pre_radial(T_layers), tpw(T_layers), pre_readout(T_layers);
+    std::vector<double> node_inter(n, 0.0);
+
+    h[0].assign(static_cast<size_t>(n) * C, T(0));
+    for (int i = 0; i < n; ++i) {
+        std::copy(embedding_.begin() + static_cast<size_t>(element[i]) * C,
+                  embedding_.begin() + static_cast<size_t>(element[i] + 1) * C,
+                  h[0].begin() + static_cast<size_t>(i) * C);
+    }
+
+    for (int t = 0; t < T_layers; ++t) {
+        const Layer<T>& L = layers_[t];
+        const size_t ns = L.node.size, ms = L.mid.size, as = L.message.size, hs = L.hidden.size;
+        const int nr = L.radial.out_dim();
+        const int max_width = *std::max_element(L.radial.dims.begin(), L.radial.dims.end());
+
+        hu[t].assign(n * ns, T(0));
+        #pragma omp parallel for schedule(static) num_threads(threads)
+        for (int i = 0; i < n; ++i) L.linear_up.forward(&h[t][i * ns], &hu[t][i * ns]);
+
+        pre_radial[t].resize(E * L.radial.hidden_size);
+        tpw[t].resize(E * nr);
+        #pragma omp parallel num_threads(threads)
+        {
+            std::vector<T> scratch(2 * max_width);
+            #pragma omp for schedule(static)
+            for (long e = 0; e < static_cast<long>(E); ++e) {
+                L.radial.forward(&R[e * num_bessel_], &tpw[t][e * nr],
+                                 &pre_radial[t][e * L.radial.hidden_size], scratch.data());
+            }
+        }
+
+        /* Messages gathered per receiver, then linear and symmetric contraction */
+        A[t].assign(n * as, T(0));
+        std::vector<T> next(n * hs, T(0));
+        pre_readout[t].assign(static_cast<size_t>(n) * std::max(1, L.readout.hidden), T(0));
+        #pragma omp parallel num_threads(threads)
+        {
+            std::vector<T> mid(ms), B(hs);
+            #pragma omp for schedule(dynamic, 16)
+            for (int i = 0; i < n; ++i) {
+                std::fill(mid.begin(), mid.end(), T(0));
+                for (int e = nl.recv_ptr[i]; e < nl.recv_ptr[i + 1]; ++e) {
+                    const T* x = &hu[t][static_cast<size_t>(nl.sender[e]) * ns];
+                    const T* y = &Y[static_cast<size_t>(e) * nsh];
+                    const T* w = &tpw[t][static_cast<size_t>(e) * nr];
+                    for (const TPCoeff<T>& k : L.coeffs) {
+                        const TPPath& p = L.paths[k.path];
+                        const T cy = k.value * y[p.l_sh * p.l_sh + k.m2];
+                        if (cy == T(0)) continue;
+                        const T* xr = x + L.node.offsets[p.block_in] + k.m1 * C;
+                        const T* wr = w + p.weight_index * C;
+                        T* o = &mid[L.mid.offsets[p.block_out] + k.m3 * C];
+                        for (int c = 0; c < C; ++c) o[c] += cy * wr[c] * xr[c];
+                    }
+                }
+                T* a = &A[t][i * as];
+                L.linear.forward(mid.data(), a, L.linear.sets > 1 ? element[i] : 0);
+
+                std::fill(B.begin(), B.end(), T(0));
+                for (const SymOutput<T>& so : L.symmetric) {
+                    symmetric_forward(so, a, &B[L.hidden.offsets[so.block]], element[i]);
+                }
+                T* hn = &next[i * hs];
+                L.product_linear.forward(B.data(), hn);
+                if (L.use_sc) L.skip.forward(&h[t][i * ns], hn, element[i]);
+
+                node_inter[i] += L.readout.forward(hn, C, &pre_readout[t][static_cast<size_t>(i) * std::max(1, L.readout.hidden)]);
+            }
+        }
+        h[t + 1] = std::move(next);
+    }
+
+    out.node_energies.resize(n);
+    double energy = 0.0;
+    for (int i = 0; i < n; ++i) {
+        out.node_energies[i] = e0_[element[i]] + scale_ * node_inter[i] + shift_;
+        energy += out.node_energies[i];
+    }
+    out.energy = energy;
+
+    /* ---------------- backward ---------------- */
+    std::vector<T> gR(E * num_bessel_, T(0)), gY(E * nsh, T(0));
+    std::vector<T> gh;   /* gradient w.r.t. the output of the current layer */
+    for (int t = T_layers - 1; t >= 0; --t) {
+        const Layer<T>& L = layers_[t];
+        const size_t ns = L.node.size, ms = L.mid.size, as = L.message.size, hs = L.hidden.size;
+        const int nr = L.radial.out_dim();
+        const int max_width = *std::max_element(L.radial.dims.begin(), L.radial.dims.end());
+        const int rh = std::max(1, L.readout.hidden);
+
+        if (gh.empty()) gh.assign(n * hs, T(0));
+        std::vector<T> gmid(n * ms, T(0)), gsc(n * hs, T(0));
+        #pragma omp parallel num_threads(threads)
+        {
+            std::vector<T> gB(hs), gA(as);
+            #pragma omp for schedule(dynamic, 16)
+            for (int i = 0; i < n; ++i) {
+                T* g = &gh[i * hs];
+                L.readout.backward(static_cast<T>(scale_), C, &pre_readout[t][static_cast<size_t>(i) * rh], g);
+                if (L.use_sc) std::copy(g, g + hs, &gsc[i * hs]);
+
+                std::fill(gB.begin(), gB.end(), T(0));
+                L.product_linear.backward(g, gB.data());
+                std::fill(gA.begin(), gA.end(), T(0));
+                for (const SymOutput<T>& so : L.symmetric) {
+                    symmetric_backward(so, &A[t][i * as], &gB[L.hidden.offsets[so.block]], gA.data(), element[i]);
+                }
+                L.linear.backward(gA.data(), &gmid[i * ms], L.linear.sets > 1 ? element[i] : 0);
+            }
+        }
+
+        /* Per-edge gradients of the tensor-product weights and harmonics */
+        std::vector<T> gw(E * nr, T(0));
+        #pragma omp parallel num_threads(threads)
+        {
+            std::vector<T> scratch(2 * max_width), gr(num_bessel_);
+            #pragma omp for schedule(static)
+            for (long e = 0; e < static_cast<long>(E); ++e) {
+                const T* x = &hu[t][static_cast<size_t>(nl.sender[e]) * ns];
+                const T* gm = &gmid[static_cast<size_t>(nl.receiver[e]) * ms];
+                const T* y = &Y[e * nsh];
+                const T* w = &tpw[t][e * nr];
+                T* gwe = &gw[e * nr];
+                T* gye = &gY[e * nsh];
+                for (const TPCoeff<T>& k : L.coeffs) {
+                    const TPPath& p = L.paths[k.path];
+                    const int ysh = p.l_sh * p.l_sh + k.m2;
+                    const T cy = k.value * y[ysh];
+                    const T* xr = x + L.node.offsets[p.block_in] + k.m1 * C;
+                    const T* wr = w + p.weight_index * C;
+                    const T* go = gm + L.mid.offsets[p.block_out] + k.m3 * C;
+                    T* gwr = gwe + p.weight_index * C;
+                    T acc = T(0);
+                    for (int c = 0; c < C; ++c) {
+                        const T gx = go[c] * xr[c];
+                        gwr[c] += cy * gx;
+                        acc += wr[c] * gx;
+                    }
+                    gye[ysh] += k.value * acc;
+                }
+                L.radial.backward(&pre_radial[t][e * L.radial.hidden_size], gwe, gr.data(), scratch.data());
+                for (int b = 0; b < num_bessel_; ++b) gR[e * num_bessel_ + b] += gr[b];
+            }
+        }
+
+        if (t == 0) break;   /* the embedding does not depend on positions */
+
+        /* Gradient w.r.t. the layer input, gathered per sender */
+        std::vector<T> gprev(n * ns, T(0));
+        #pragma omp parallel num_threads(threads)
+        {
+            std::vector<T> ghu(ns);
+            #pragma omp for schedule(dynamic, 16)
+            for (int s = 0; s < n; ++s) {
+                std::fill(ghu.begin(), ghu.end(), T(0));
+                for (int k = nl.send_ptr[s]; k < nl.send_ptr[s + 1]; ++k) {
+                    const int e = nl.send_edges[k];
+                    const T* gm = &gmid[static_cast<size_t>(nl.receiver[e]) * ms];
+                    const T* y = &Y[static_cast<size_t>(e) * nsh];
+                    const T* w = &tpw[t][static_cast<size_t>(e) * nr];
+                    for (const TPCoeff<T>& c : L.coeffs) {
+                        const TPPath& p = L.paths[c.path];
+                        const T cy = c.value * y[p.l_sh * p.l_sh + c.m2];
+                        if (cy == T(0)) continue;
+                        const T* wr = w + p.weight_index * C;
+                        const T* go = gm + L.mid.offsets[p.block_out] + c.m3 * C;
+                        T* gx = &ghu[L.node.offsets[p.block_in] + c.m1 * C];
+                        for (int ch = 0; ch < C; ++ch) gx[ch] += cy * wr[ch] * go[ch];
+                    }
+                }
+                T* gp = &gprev[s * ns];
+                L.linear_up.backward(ghu.data(), gp);
+                if (L.use_sc) L.skip.backward(&gsc[s * hs], gp, element[s]);
+            }
+        }
+        gh = std::move(gprev);
+    }
+
+    /* Edge-vector gradients, then forces and virial */
+    std::vector<double> gvec(3 * E);
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (long e = 0; e < static_cast<long>(E); ++e) {
+        const double* v = &nl.vectors[3 * e];
+        const double r = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        double gr = 0.0;
+        for (int b = 0; b < num_bessel_; ++b) gr += gR[e * num_bessel_ + b] * dR[e * num_bessel_ + b];
+        for (int d = 0; d < 3; ++d) {
+            double g = gr * v[d] / r;
+            for (int k = 0; k < nsh; ++k) g += gY[e * nsh + k] * dY[(e * nsh + k) * 3 + d];
+            gvec[3 * e + d] = g;
+        }
+    }
+
+    out.forces.assign(3 * static_cast<size_t>(n), 0.0);
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(threads)
+    for (int i = 0; i < n; ++i) {
+        double f[3] = {0.0, 0.0, 0.0};
+        for (int e = nl.recv_ptr[i]; e < nl.recv_ptr[i + 1]; ++e) {
+            for (int d = 0; d < 3; ++d) f[d] -= gvec[3 * e + d];
+        }
+        for (int k = nl.send_ptr[i]; k < nl.send_ptr[i + 1]; ++k) {
+            const int e = nl.send_edges[k];
+            for (int d = 0; d < 3; ++d) f[d] += gvec[3 * e + d];
+        }
+        for (int d = 0; d < 3; ++d) out.forces[3 * i + d] = f[d];
+    }
+
+    for (int k = 0; k < 9; ++k) out.virial[k] = 0.0;
+    for (size_t e = 0; e < E; ++e) {
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < 3; ++b) out.virial[3 * a + b] -= nl.vectors[3 * e + a] * gvec[3 * e + b];
+        }
+    }
+}
+
+}  // namespace
+
+std::unique_ptr<Engine> Engine::load(const std::string& path, const std::string& dtype, int num_threads)
+{
+    TensorFile f(path);
+    if (dtype == "float32") return std::unique_ptr<Engine>(new Model<float>(f, num_threads));
+    if (dtype == "float64") return std::unique_ptr<Engine>(new Model<double>(f, num_threads));
+    throw std::runtime_error("Unsupported native dtype: " + dtype);
+}
+
+}  // namespace mace_engine
+
+/* ------------------------------------------------------------------------
+ * C API
+ * ------------------------------------------------------------------------ */
+
+struct MACENativeCalculator {
+    std::unique_ptr<mace_engine::Engine> engine;
+    std::string last_error;
+};
+
+/* Why the last mace_native_init on this thread failed (no handle to hold it) */
+static thread_local std::string g_init_error;
+
+extern "C" {
+
+MACENativeHandle mace_native_init(const char* model_path, const char* dtype, int num_threads)
+{
+    if (!model_path) {
+        g_init_error = "No model path given";
+        return nullptr;
+    }
+
+    try {
+        std::unique_ptr<MACENativeCalculator> calc(new MACENativeCalculator());
+        calc->engine = mace_engine::Engine::load(model_path, dtype ? dtype : "float32", num_threads);
+        g_init_error.clear();
+        return static_cast<MACENativeHandle>(calc.release());
+    } catch (const std::exception& e) {
+        g_init_error = e.what();
+        std::cerr << "MACE native init error: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+void mace_native_calculate(MACENativeHandle handle,
+                           const double* positions,
+                           const int* atomic_numbers,
+                           int num_atoms,
+                           const double* cell,
+                           const int* pbc,
+                           MACEResult* result)
+{
+    if (!handle || !result) {
+        if (result) {
+            result->success = 0;
+            strncpy(result->error_msg, "Invalid handle or result pointer",
+                   sizeof(result->error_msg) - 1);
+        }
+        return;
+    }
+
+    MACENativeCalculator* calc = static_cast<MACENativeCalculator*>(handle);
+
+    try {
+        mace_engine::Output out;
+        calc->engine->compute(positions, atomic_numbers, num_atoms, cell, pbc, out);
+
+        result->energy = out.energy;
+        result->num_atoms = num_atoms;
+        result->success = 1;
+        result->error_msg[0] = '\0';
+
+        result->forces = new double[num_atoms * 3];
+        std::copy(out.forces.begin(), out.forces.end(), result->forces);
+
+    } catch (const std::exception& e) {
+        result->success = 0;
+        strncpy(result->error_msg, e.what(), sizeof(result->error_msg) - 1);
+        calc->last_error = e.what();
+    }
+}
+
+void mace_native_destroy(MACENativeHandle handle)
+{
+    delete static_cast<MACENativeCalculator*>(handle);
+}
+
+const char* mace_native_get_error(MACENativeHandle handle)
+{
+    if (!handle) return g_init_error.c_str();
+    return static_cast<MACENativeCalculator*>(handle)->last_error.c_str();
+}
+
+#ifdef MACE_NATIVE_STANDALONE
+/* The Python-backed library provides these in mace_wrapper.cpp */
+void mace_free_forces(double* forces) {
+    delete[] forces;
+}
+
+void mace_free_result(MACEResult* result) {
+    if (result && result->forces) {
+        mace_free_forces(result->forces);
+        result->forces = nullptr;
+    }
+}
+#endif
+
+}
@@ -0,0 +1,45 @@
+#ifndef MACE_ENGINE_H
+#define MACE_ENGINE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Self-contained CPU inference engine for MACE models.
+ *
+ * Reads the flat binary written by python/export_native_model.py and
+ * evaluates energies and analytic forces without Python or torch. The
+ * supported architecture is ScaleShiftMACE with RealAgnostic(Residual)
+ * interaction blocks, which covers the mace_mp foundation models.
+ */
+namespace mace_engine {
+
+struct Output {
+    double energy = 0.0;
+    std::vector<double> forces;         /* [n, 3] eV/A */
+    std::vector<double> node_energies;  /* [n] eV */
+    double virial[9] = {0.0};           /* -sum_e r_e (x) dE/dr_e, eV */
+};
+
+class Engine {
+public:
+    virtual ~Engine() = default;
+
+    /* dtype: "float32" or "float64"; num_threads <= 0 uses the OpenMP default */
+    static std::unique_ptr<Engine> load(const std::string& path,
+                                        const std::string& dtype,
+                                        int num_threads);
+
+    /* cell/pbc may be nullptr for isolated systems */
+    virtual void compute(const double* positions, const int* atomic_numbers,
+                         int num_atoms, const double* cell, const int* pbc,
+                         Output& out) = 0;
+
+    virtual double cutoff() const = 0;
+    virtual int num_interactions() const = 0;
+};
+
+}  // namespace mace_engine
+
+#endif /* MACE_ENGINE_H */
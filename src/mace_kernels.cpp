@@ -0,0 +1,702 @@
+#include "mace_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX512F__) && defined(__GNUC__) && !defined(__clang__)
+/* GCC flags the _mm512_undefined_* placeholders inside its own intrinsics */
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+namespace mace_kernels {
+
+namespace {
+
+/* ------------------------------------------------------------------------
+ * Minimal SIMD layer. Simd<T> maps the handful of operations the kernels
+ * need onto the widest instruction set enabled at compile time; Vec<T>
+ * wraps a register so the kernels can be written once with operators.
+ * ------------------------------------------------------------------------ */
+
+template <typename T> struct Simd;
+
+#if defined(__AVX512F__)
+
+#define MACE_SIMD_ISA "avx512"
+
+template <> struct Simd<double> {
+    using reg = __m512d;
+    static constexpr int width = 8;
+    static reg load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, reg a) { _mm512_storeu_pd(p, a); }
+    static reg set1(double a) { return _mm512_set1_pd(a); }
+    static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+    static reg div(reg a, reg b) { return _mm512_div_pd(a, b); }
+    static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_pd(a, b, c); }
+    static reg sqrt(reg a) { return _mm512_sqrt_pd(a); }
+    static reg max(reg a, reg b) { return _mm512_max_pd(a, b); }
+    /* a < b ? x : 0 */
+    static reg select_lt(reg a, reg b, reg x) {
+        return _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(a, b, _CMP_LT_OQ), x);
+    }
+};
+
+template <> struct Simd<float> {
+    using reg = __m512;
+    static constexpr int width = 16;
+    static reg load(const float* p) { return _mm512_loadu_ps(p); }
+    static void store(float* p, reg a) { _mm512_storeu_ps(p, a); }
+    static reg set1(float a) { return _mm512_set1_ps(a); }
+    static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+    static reg div(reg a, reg b) { return _mm512_div_ps(a, b); }
+    static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_ps(a, b, c); }
+    static reg sqrt(reg a) { return _mm512_sqrt_ps(a); }
+    static reg max(reg a, reg b) { return _mm512_max_ps(a, b); }
+    static reg select_lt(reg a, reg b, reg x) {
+        return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ), x);
+    }
+};
+
+#elif defined(__AVX2__)
+
+#define MACE_SIMD_ISA "avx2"
+
+template <> struct Simd<double> {
+    using reg = __m256d;
+    static constexpr int width = 4;
+    static reg load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, reg a) { _mm256_storeu_pd(p, a); }
+    static reg set1(double a) { return _mm256_set1_pd(a); }
+    static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+    static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+#if defined(__FMA__)
+    static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+    static reg fmadd(reg a, reg b, reg c) { return add(mul(a, b), c); }
+#endif
+    static reg sqrt(reg a) { return _mm256_sqrt_pd(a); }
+    static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+    static reg select_lt(reg a, reg b, reg x) {
+        return _mm256_and_pd(_mm256_cmp_pd(a, b, _CMP_LT_OQ), x);
+    }
+};
+
+template <> struct Simd<float> {
+    using reg = __m256;
+    static constexpr int width = 8;
+    static reg load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, reg a) { _mm256_storeu_ps(p, a); }
+    static reg set1(float a) { return _mm256_set1_ps(a); }
+    static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+    static reg div(reg a, reg b) { return _mm256_div_ps(a, b); }
+#if defined(__FMA__)
+    static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+    static reg fmadd(reg a, reg b, reg c) { return add(mul(a, b), c); }
+#endif
+    static reg sqrt(reg a) { return _mm256_sqrt_ps(a); }
+    static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+    static reg select_lt(reg a, reg b, reg x) {
+        return _mm256_and_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ), x);
+    }
+};
+
+#else
+
+#define MACE_SIMD_ISA "scalar"
+
+#endif
+
+#if !defined(__AVX512F__) && !defined(__AVX2__)
+template <typename T> struct SimdScalar {
+    using reg = T;
+    static constexpr int width = 1;
+    static reg load(const T* p) { return *p; }
+    static void store(T* p, reg a) { *p = a; }
+    static reg set1(T a) { return a; }
+    static reg add(reg a, reg b) { return a + b; }
+    static reg sub(reg a, reg b) { return a - b; }
+    static reg mul(reg a, reg b) { return a * b; }
+    static reg div(reg a, reg b) { return a / b; }
+    static reg fmadd(reg a, reg b, reg c) { return a * b + c; }
+    static reg sqrt(reg a) { return std::sqrt(a); }
+    static reg max(reg a, reg b) { return std::max(a, b); }
+    static reg select_lt(reg a, reg b, reg x) { return a < b ? x : T(0); }
+};
+template <> struct Simd<double> : SimdScalar<double> {};
+template <> struct Simd<float> : SimdScalar<float> {};
+#endif
+
+template <typename T>
+struct Vec {
+    using S = Simd<T>;
+    typename S::reg r;
+
+    static Vec load(const T* p) { return {S::load(p)}; }
+    static Vec set1(T a) { return {S::set1(a)}; }
+    void store(T* p) const { S::store(p, r); }
+};
+
+template <typename T> inline Vec<T> operator+(Vec<T> a, Vec<T> b) { return {Simd<T>::add(a.r, b.r)}; }
+template <typename T> inline Vec<T> operator-(Vec<T> a, Vec<T> b) { return {Simd<T>::sub(a.r, b.r)}; }
+template <typename T> inline Vec<T> operator*(Vec<T> a, Vec<T> b) { return {Simd<T>::mul(a.r, b.r)}; }
+template <typename T> inline Vec<T> operator/(Vec<T> a, Vec<T> b) { return {Simd<T>::div(a.r, b.r)}; }
+template <typename T> inline Vec<T> operator*(T a, Vec<T> b) { return {Simd<T>::mul(Simd<T>::set1(a), b.r)}; }
+template <typename T> inline Vec<T> operator-(Vec<T> a, T b) { return {Simd<T>::sub(a.r, Simd<T>::set1(b))}; }
+template <typename T> inline Vec<T> operator-(T a, Vec<T> b) { return {Simd<T>::sub(Simd<T>::set1(a), b.r)}; }
+template <typename T> inline Vec<T> fmadd(Vec<T> a, Vec<T> b, Vec<T> c) { return {Simd<T>::fmadd(a.r, b.r, c.r)}; }
+template <typename T> inline Vec<T> vsqrt(Vec<T> a) { return {Simd<T>::sqrt(a.r)}; }
+template <typename T> inline Vec<T> vmax(Vec<T> a, Vec<T> b) { return {Simd<T>::max(a.r, b.r)}; }
+template <typename T> inline Vec<T> select_lt(Vec<T> a, Vec<T> b, Vec<T> x) {
+    return {Simd<T>::select_lt(a.r, b.r, x.r)};
+}
+
+constexpr int kMaxSH = (kMaxSphericalHarmonicsL + 1) * (kMaxSphericalHarmonicsL + 1);
+
+/* Degree of each spherical harmonic component, used by the chain rule */
+constexpr int kDegree[kMaxSH] = {0, 1, 1, 1, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3};
+
+/* ------------------------------------------------------------------------
+ * Block kernels. Each one processes Simd<T>::width edges held in SoA
+ * scratch arrays; the drivers below transpose edges in and results out.
+ * ------------------------------------------------------------------------ */
+
+template <typename T>
+struct SHBlock {
+    static constexpr int W = Simd<T>::width;
+    alignas(64) T x[W], y[W], z[W];
+    alignas(64) T sh[kMaxSH][W];
+    alignas(64) T dsh[kMaxSH][3][W];
+};
+
+/*
+ * Component-normalized real spherical harmonics in e3nn ordering. P holds
+ * the homogeneous polynomials of the unit vector u and G their gradients
+ * w.r.t. u; since u . grad P = l P (Euler), the derivative w.r.t. the raw
+ * vector is (G - l P u) / |v|.
+ */
+template <typename T>
+void sh_block(SHBlock<T>& b, int lmax, bool grad)
+{
+    using V = Vec<T>;
+    const T s3 = std::sqrt(T(3));
+    const T s5 = std::sqrt(T(5));
+    const T s15 = std::sqrt(T(15));
+    const T s105 = std::sqrt(T(105));
+    const T a3 = std::sqrt(T(42)) / T(6) * s15;   /* Y3,0 and Y3,6 */
+    const T b3 = std::sqrt(T(168)) / T(8);         /* Y3,2 and Y3,4 */
+    const T h3 = std::sqrt(T(7)) / T(2);           /* Y3,3 */
+    const T c3 = s105 / T(2);                      /* Y3,5 */
+
+    V vx = V::load(b.x), vy = V::load(b.y), vz = V::load(b.z);
+    V r = vsqrt(fmadd(vx, vx, fmadd(vy, vy, vz * vz)));
+    /* torch.nn.functional.normalize clamps the norm at 1e-12 */
+    V inv_r = V::set1(T(1)) / vmax(r, V::set1(T(1e-12)));
+    V x = vx * inv_r, y = vy * inv_r, z = vz * inv_r;
+
+    const V zero = V::set1(T(0));
+    V P[kMaxSH];
+    V G[kMaxSH][3];
+
+    P[0] = V::set1(T(1));
+    G[0][0] = G[0][1] = G[0][2] = zero;
+
+    if (lmax >= 1) {
+        V vs3 = V::set1(s3);
+        P[1] = s3 * x; P[2] = s3 * y; P[3] = s3 * z;
+        G[1][0] = vs3;  G[1][1] = zero; G[1][2] = zero;
+        G[2][0] = zero; G[2][1] = vs3;  G[2][2] = zero;
+        G[3][0] = zero; G[3][1] = zero; G[3][2] = vs3;
+    }
+
+    V x2 = x * x, y2 = y * y, z2 = z * z;
+    V x2z2 = x2 + z2;
+
+    if (lmax >= 2) {
+        P[4] = s15 * (x * z);
+        P[5] = s15 * (x * y);
+        P[6] = s5 * (y2 - T(0.5) * x2z2);
+        P[7] = s15 * (y * z);
+        P[8] = (s15 / T(2)) * (z2 - x2);
+
+        G[4][0] = s15 * z;  G[4][1] = zero;        G[4][2] = s15 * x;
+        G[5][0] = s15 * y;  G[5][1] = s15 * x;     G[5][2] = zero;
+        G[6][0] = (-s5) * x; G[6][1] = (T(2) * s5) * y; G[6][2] = (-s5) * z;
+        G[7][0] = zero;     G[7][1] = s15 * z;     G[7][2] = s15 * y;
+        G[8][0] = (-s15) * x; G[8][1] = zero;      G[8][2] = s15 * z;
+    }
+
+    if (lmax >= 3) {
+        V xy = x * y, xz = x * z, yz = y * z;
+        V t = T(4) * y2 - x2z2;   /* 4y^2 - x^2 - z^2 */
+
+        P[9]  = a3 * (x * (T(1.5) * z2 - T(0.5) * x2));
+        P[10] = s105 * (xy * z);
+        P[11] = b3 * (t * x);
+        P[12] = h3 * (y * (T(2) * y2 - T(3) * x2z2));
+        P[13] = b3 * (t * z);
+        P[14] = c3 * (y * (z2 - x2));
+        P[15] = a3 * (z * (T(0.5) * z2 - T(1.5) * x2));
+
+        G[9][0]  = a3 * (T(1.5) * (z2 - x2));
+        G[9][1]  = zero;
+        G[9][2]  = (T(3) * a3) * xz;
+        G[10][0] = s105 * yz;
+        G[10][1] = s105 * xz;
+        G[10][2] = s105 * xy;
+        G[11][0] = b3 * (T(4) * y2 - T(3) * x2 - z2);
+        G[11][1] = (T(8) * b3) * xy;
+        G[11][2] = (T(-2) * b3) * xz;
+        G[12][0] = (T(-6) * h3) * xy;
+        G[12][1] = h3 * (T(6) * y2 - T(3) * x2z2);
+        G[12][2] = (T(-6) * h3) * yz;
+        G[13][0] = (T(-2) * b3) * xz;
+        G[13][1] = (T(8) * b3) * yz;
+        G[13][2] = b3 * (T(4) * y2 - x2 - T(3) * z2);
+        G[14][0] = (T(-2) * c3) * xy;
+        G[14][1] = c3 * (z2 - x2);
+        G[14][2] = (T(2) * c3) * yz;
+        G[15][0] = (T(-3) * a3) * xz;
+        G[15][1] = zero;
+        G[15][2] = a3 * (T(1.5) * (z2 - x2));
+    }
+
+    const int nsh = num_spherical_harmonics(lmax);
+    for (int k = 0; k < nsh; ++k) {
+        P[k].store(b.sh[k]);
+    }
+    if (!grad) return;
+
+    for (int k = 0; k < nsh; ++k) {
+        V lp = T(kDegree[k]) * P[k];
+        (G[k][0] - lp * x).store(b.dsh[k][0]);
+        (G[k][1] - lp * y).store(b.dsh[k][1]);
+        (G[k][2] - lp * z).store(b.dsh[k][2]);
+        (V::load(b.dsh[k][0]) * inv_r).store(b.dsh[k][0]);
+        (V::load(b.dsh[k][1]) * inv_r).store(b.dsh[k][1]);
+        (V::load(b.dsh[k][2]) * inv_r).store(b.dsh[k][2]);
+    }
+}
+
+template <typename T>
+struct RadialBlock {
+    static constexpr int W = Simd<T>::width;
+    alignas(64) T r[W];
+    alignas(64) T sin1[W], cos1[W];      /* sin/cos(pi r / r_max) */
+    alignas(64) T env[W], denv[W];
+};
+
+/*
+ * sin(k theta) and cos(k theta) follow from one sincos per edge by the
+ * angle-addition recurrence, so the basis costs two transcendental calls per
+ * edge instead of 2 * num_basis.
+ */
+template <typename T, typename Sink>
+void bessel_block(const RadialBlock<T>& b, T r_max, int num_basis, bool grad, Sink sink)
+{
+    using V = Vec<T>;
+    const T prefactor = std::sqrt(T(2) / r_max);
+    const T w1 = T(M_PI) / r_max;
+
+    V r = V::load(b.r);
+    V inv_r = V::set1(T(1)) / r;
+    V s1 = V::load(b.sin1), c1 = V::load(b.cos1);
+    V sk = s1, ck = c1;
+    for (int k = 0; k < num_basis; ++k) {
+        V basis = prefactor * (sk * inv_r);
+        V dbasis = V::set1(T(0));
+        if (grad) {
+            const T wk = w1 * T(k + 1);
+            dbasis = prefactor * ((wk * ck - sk * inv_r) * inv_r);
+        }
+        sink(k, basis, dbasis);
+        V s_next = fmadd(sk, c1, ck * s1);
+        ck = fmadd(ck, c1, V::set1(T(0)) - sk * s1);
+        sk = s_next;
+    }
+}
+
+/*
+ * f(u) = 1 - (p+1)(p+2)/2 u^p + p(p+2) u^(p+1) - p(p+1)/2 u^(p+2),
+ * f'(r) = -p(p+1)(p+2) / (2 r_max) u^(p-1) (1-u)^2, both zero past r_max.
+ */
+template <typename T>
+void cutoff_block(RadialBlock<T>& b, T r_max, int p, bool grad)
+{
+    using V = Vec<T>;
+    const T pp = T(p);
+    const T c0 = (pp + 1) * (pp + 2) / 2;
+    const T c1 = pp * (pp + 2);
+    const T c2 = pp * (pp + 1) / 2;
+    const T cd = -pp * (pp + 1) * (pp + 2) / (2 * r_max);
+
+    V r = V::load(b.r);
+    V u = (T(1) / r_max) * r;
+    V upm1 = V::set1(T(1));
+    for (int i = 1; i < p; ++i) upm1 = upm1 * u;
+    V up = upm1 * u;
+    V env = V::set1(T(1)) - c0 * up + c1 * (up * u) - c2 * (up * u * u);
+    V rmax = V::set1(r_max);
+    select_lt(r, rmax, env).store(b.env);
+    if (grad) {
+        V omu = T(1) - u;
+        select_lt(r, rmax, cd * (upm1 * omu * omu)).store(b.denv);
+    }
+}
+
+/* Loads edge lengths and the sincos seed for the Bessel recurrence */
+template <typename T>
+void load_lengths(RadialBlock<T>& b, const T* lengths, int64_t i0, int m, T r_max)
+{
+    const int W = RadialBlock<T>::W;
+    const double w1 = M_PI / static_cast<double>(r_max);
+    for (int j = 0; j < W; ++j) {
+        /* Tail lanes get a harmless dummy length */
+        T r = j < m ? lengths[i0 + j] : r_max;
+        b.r[j] = r;
+        b.sin1[j] = static_cast<T>(std::sin(w1 * r));
+        b.cos1[j] = static_cast<T>(std::cos(w1 * r));
+    }
+}
+
+void check_lmax(int lmax)
+{
+    if (lmax < 0 || lmax > kMaxSphericalHarmonicsL) {
+        throw std::invalid_argument("native spherical harmonics support lmax 0.." +
+                                    std::to_string(kMaxSphericalHarmonicsL));
+    }
+}
+
+}  // namespace
+
+const char* simd_isa()
+{
+    return MACE_SIMD_ISA;
+}
+
+template <typename T>
+void spherical_harmonics(const T* vectors, int64_t n, int lmax, T* sh, T* dsh)
+{
+    check_lmax(lmax);
+    const int W = Simd<T>::width;
+    const int nsh = num_spherical_harmonics(lmax);
+    SHBlock<T> b;
+
+    for (int64_t i0 = 0; i0 < n; i0 += W) {
+        const int m = static_cast<int>(std::min<int64_t>(W, n - i0));
+        for (int j = 0; j < W; ++j) {
+            const bool live = j < m;
+            b.x[j] = live ? vectors[(i0 + j) * 3 + 0] : T(0);
+            b.y[j] = live ? vectors[(i0 + j) * 3 + 1] : T(1);
+            b.z[j] = live ? vectors[(i0 + j) * 3 + 2] : T(0);
+        }
+        sh_block(b, lmax, dsh != nullptr);
+        for (int j = 0; j < m; ++j) {
+            T* row = sh + (i0 + j) * nsh;
+            for (int k = 0; k < nsh; ++k) row[k] = b.sh[k][j];
+        }
+        if (dsh) {
+            for (int j = 0; j < m; ++j) {
+                T* row = dsh + (i0 + j) * nsh * 3;
+                for (int k = 0; k < nsh; ++k) {
+                    row[k * 3 + 0] = b.dsh[k][0][j];
+                    row[k * 3 + 1] = b.dsh[k][1][j];
+                    row[k * 3 + 2] = b.dsh[k][2][j];
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void bessel_basis(const T* lengths, int64_t n, T r_max, int num_basis,
+                  T* basis, T* dbasis)
+{
+    using V = Vec<T>;
+    const int W = Simd<T>::width;
+    RadialBlock<T> b;
+    alignas(64) T lane[W];
+
+    for (int64_t i0 = 0; i0 < n; i0 += W) {
+        const int m = static_cast<int>(std::min<int64_t>(W, n - i0));
+        load_lengths(b, lengths, i0, m, r_max);
+        bessel_block(b, r_max, num_basis, dbasis != nullptr,
+                     [&](int k, V f, V df) {
+            f.store(lane);
+            for (int j = 0; j < m; ++j) basis[(i0 + j) * num_basis + k] = lane[j];
+            if (dbasis) {
+                df.store(lane);
+                for (int j = 0; j < m; ++j) dbasis[(i0 + j) * num_basis + k] = lane[j];
+            }
+        });
+    }
+}
+
+template <typename T>
+void polynomial_cutoff(const T* lengths, int64_t n, T r_max, int p,
+                       T* envelope, T* denvelope)
+{
+    const int W = Simd<T>::width;
+    RadialBlock<T> b;
+
+    for (int64_t i0 = 0; i0 < n; i0 += W) {
+        const int m = static_cast<int>(std::min<int64_t>(W, n - i0));
+        for (int j = 0; j < W; ++j) b.r[j] = j < m ? lengths[i0 + j] : r_max;
+        cutoff_block(b, r_max, p, denvelope != nullptr);
+        for (int j = 0; j < m; ++j) envelope[i0 + j] = b.env[j];
+        if (denvelope) {
+            for (int j = 0; j < m; ++j) denvelope[i0 + j] = b.denv[j];
+        }
+    }
+}
+
+template <typename T>
+void edge_features(const T* vectors, int64_t n, int lmax,
+                   T r_max, int num_basis, int p,
+                   T* sh, T* dsh, T* radial, T* dradial)
+{
+    using V = Vec<T>;
+    check_lmax(lmax);
+    const int W = Simd<T>::width;
+    const int nsh = num_spherical_harmonics(lmax);
+    const bool grad = dsh != nullptr || dradial != nullptr;
+    SHBlock<T> sb;
+    RadialBlock<T> rb;
+    alignas(64) T lane[W];
+
+    for (int64_t i0 = 0; i0 < n; i0 += W) {
+        const int m = static_cast<int>(std::min<int64_t>(W, n - i0));
+        for (int j = 0; j < W; ++j) {
+            const bool live = j < m;
+            sb.x[j] = live ? vectors[(i0 + j) * 3 + 0] : T(0);
+            sb.y[j] = live ? vectors[(i0 + j) * 3 + 1] : r_max;
+            sb.z[j] = live ? vectors[(i0 + j) * 3 + 2] : T(0);
+        }
+
+        if (sh) {
+            sh_block(sb, lmax, dsh != nullptr);
+            for (int j = 0; j < m; ++j) {
+                T* row = sh + (i0 + j) * nsh;
+                for (int k = 0; k < nsh; ++k) row[k] = sb.sh[k][j];
+            }
+            if (dsh) {
+                for (int j = 0; j < m; ++j) {
+                    T* row = dsh + (i0 + j) * nsh * 3;
+                    for (int k = 0; k < nsh; ++k) {
+                        row[k * 3 + 0] = sb.dsh[k][0][j];
+                        row[k * 3 + 1] = sb.dsh[k][1][j];
+                        row[k * 3 + 2] = sb.dsh[k][2][j];
+                    }
+                }
+            }
+        }
+
+        if (!radial) continue;
+
+        for (int j = 0; j < W; ++j) {
+            lane[j] = std::sqrt(sb.x[j] * sb.x[j] + sb.y[j] * sb.y[j] + sb.z[j] * sb.z[j]);
+        }
+        load_lengths(rb, lane, 0, W, r_max);
+        cutoff_block(rb, r_max, p, grad);
+        V env = V::load(rb.env);
+        V denv = grad ? V::load(rb.denv) : V::set1(T(0));
+        bessel_block(rb, r_max, num_basis, grad, [&](int k, V f, V df) {
+            (f * env).store(lane);
+            for (int j = 0; j < m; ++j) radial[(i0 + j) * num_basis + k] = lane[j];
+            if (dradial) {
+                fmadd(df, env, f * denv).store(lane);
+                for (int j = 0; j < m; ++j) dradial[(i0 + j) * num_basis + k] = lane[j];
+            }
+        });
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * AoS <-> SoA transposition. The SIMD paths move a register width of atoms
+ * (3 registers of interleaved coordinates) per iteration; tails and float
+ * use the scalar loop.
+ * ------------------------------------------------------------------------ */
+
+namespace {
+
+template <typename T>
+int64_t interleave3_simd(const T*, const T*, const T*, int64_t, T*) { return 0; }
+
+template <typename T>
+int64_t deinterleave3_simd(const T*, int64_t, T*, T*, T*) { return 0; }
+
+#if defined(__AVX512F__)
+
+inline __m512i lanes(const int64_t (&idx)[8])
+{
+    return _mm512_loadu_si512(static_cast<const void*>(idx));
+}
+
+template <>
+int64_t interleave3_simd<double>(const double* x, const double* y, const double* z, int64_t n, double* xyz)
+{
+    static const int64_t a0[8] = {0, 8, 0, 1, 9, 0, 2, 10}, a1[8] = {0, 1, 8, 3, 4, 9, 6, 7};
+    static const int64_t b0[8] = {0, 3, 11, 0, 4, 12, 0, 5}, b1[8] = {10, 1, 2, 11, 4, 5, 12, 7};
+    static const int64_t c0[8] = {13, 0, 6, 14, 0, 7, 15, 0}, c1[8] = {0, 13, 2, 3, 14, 5, 6, 15};
+    int64_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d vx = _mm512_loadu_pd(x + i), vy = _mm512_loadu_pd(y + i), vz = _mm512_loadu_pd(z + i);
+        double* out = xyz + 3 * i;
+        _mm512_storeu_pd(out, _mm512_permutex2var_pd(_mm512_permutex2var_pd(vx, lanes(a0), vy), lanes(a1), vz));
+        _mm512_storeu_pd(out + 8, _mm512_permutex2var_pd(_mm512_permutex2var_pd(vx, lanes(b0), vy), lanes(b1), vz));
+        _mm512_storeu_pd(out + 16, _mm512_permutex2var_pd(_mm512_permutex2var_pd(vx, lanes(c0), vy), lanes(c1), vz));
+    }
+    return i;
+}
+
+template <>
+int64_t deinterleave3_simd<double>(const double* xyz, int64_t n, double* x, double* y, double* z)
+{
+    static const int64_t x0[8] = {0, 3, 6, 9, 12, 15, 0, 0}, x1[8] = {0, 1, 2, 3, 4, 5, 10, 13};
+    static const int64_t y0[8] = {1, 4, 7, 10, 13, 0, 0, 0}, y1[8] = {0, 1, 2, 3, 4, 8, 11, 14};
+    static const int64_t z0[8] = {2, 5, 8, 11, 14, 0, 0, 0}, z1[8] = {0, 1, 2, 3, 4, 9, 12, 15};
+    int64_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const double* in = xyz + 3 * i;
+        const __m512d a = _mm512_loadu_pd(in), b = _mm512_loadu_pd(in + 8), c = _mm512_loadu_pd(in + 16);
+        _mm512_storeu_pd(x + i, _mm512_permutex2var_pd(_mm512_permutex2var_pd(a, lanes(x0), b), lanes(x1), c));
+        _mm512_storeu_pd(y + i, _mm512_permutex2var_pd(_mm512_permutex2var_pd(a, lanes(y0), b), lanes(y1), c));
+        _mm512_storeu_pd(z + i, _mm512_permutex2var_pd(_mm512_permutex2var_pd(a, lanes(z0), b), lanes(z1), c));
+    }
+    return i;
+}
+
+#elif defined(__AVX2__)
+
+/* 128-bit halves: rows (0,1 | 6,7), (2,3 | 8,9), (4,5 | 10,11) of 4 atoms */
+inline __m256d load_halves(const double* lo, const double* hi)
+{
+    return _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(lo)), _mm_loadu_pd(hi), 1);
+}
+
+inline void store_halves(double* lo, double* hi, __m256d v)
+{
+    _mm_storeu_pd(lo, _mm256_castpd256_pd128(v));
+    _mm_storeu_pd(hi, _mm256_extractf128_pd(v, 1));
+}
+
+template <>
+int64_t interleave3_simd<double>(const double* x, const double* y, const double* z, int64_t n, double* xyz)
+{
+    int64_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d vx = _mm256_loadu_pd(x + i), vy = _mm256_loadu_pd(y + i), vz = _mm256_loadu_pd(z + i);
+        double* out = xyz + 3 * i;
+        store_halves(out, out + 6, _mm256_shuffle_pd(vx, vy, 0x0));       /* x0 y0 | x2 y2 */
+        store_halves(out + 2, out + 8, _mm256_shuffle_pd(vz, vx, 0xA));   /* z0 x1 | z2 x3 */
+        store_halves(out + 4, out + 10, _mm256_shuffle_pd(vy, vz, 0xF));  /* y1 z1 | y3 z3 */
+    }
+    return i;
+}
+
+template <>
+int64_t deinterleave3_simd<double>(const double* xyz, int64_t n, double* x, double* y, double* z)
+{
+    int64_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const double* in = xyz + 3 * i;
+        const __m256d xy = load_halves(in, in + 6);
+        const __m256d zx = load_halves(in + 2, in + 8);
+        const __m256d yz = load_halves(in + 4, in + 10);
+        _mm256_storeu_pd(x + i, _mm256_shuffle_pd(xy, zx, 0xA));
+        _mm256_storeu_pd(y + i, _mm256_shuffle_pd(xy, yz, 0x5));
+        _mm256_storeu_pd(z + i, _mm256_shuffle_pd(zx, yz, 0xA));
+    }
+    return i;
+}
+
+#endif
+
+}  // namespace
+
+template <typename T>
+void interleave3(const T* x, const T* y, const T* z, int64_t n, T* xyz)
+{
+    for (int64_t i = interleave3_simd(x, y, z, n, xyz); i < n; ++i) {
+        xyz[3 * i + 0] = x[i];
+        xyz[3 * i + 1] = y[i];
+        xyz[3 * i + 2] = z[i];
+    }
+}
+
+template <typename T>
+void deinterleave3(const T* xyz, int64_t n, T* x, T* y, T* z)
+{
+    for (int64_t i = deinterleave3_simd(xyz, n, x, y, z); i < n; ++i) {
+        x[i] = xyz[3 * i + 0];
+        y[i] = xyz[3 * i + 1];
+        z[i] = xyz[3 * i + 2];
+    }
+}
+
+double pair_potential(const double* vectors, const int64_t* senders, const int64_t* receivers,
+                      const int64_t* types, int64_t n, const double* coefficients,
+                      int64_t num_types, int num_basis, int64_t num_atoms,
+                      double r_cut, int p, double* forces)
+{
+    std::fill(forces, forces + 3 * num_atoms, 0.0);
+    std::vector<double> lengths(n), basis(n * num_basis), dbasis(n * num_basis), env(n), denv(n);
+    for (int64_t e = 0; e < n; ++e) {
+        const double* v = vectors + 3 * e;
+        lengths[e] = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    }
+    bessel_basis<double>(lengths.data(), n, r_cut, num_basis, basis.data(), dbasis.data());
+    polynomial_cutoff<double>(lengths.data(), n, r_cut, p, env.data(), denv.data());
+
+    double energy = 0.0;
+    for (int64_t e = 0; e < n; ++e) {
+        if (env[e] == 0.0 || types[e] < 0 || types[e] >= num_types) continue;
+        const double* c = coefficients + types[e] * num_basis;
+        double phi = 0.0, dphi = 0.0;
+        for (int b = 0; b < num_basis; ++b) {
+            const double rb = basis[e * num_basis + b];
+            phi += c[b] * rb * env[e];
+            dphi += c[b] * (dbasis[e * num_basis + b] * env[e] + rb * denv[e]);
+        }
+        energy += 0.5 * phi;
+        const double scale = 0.5 * dphi / lengths[e];
+        for (int k = 0; k < 3; ++k) {
+            const double g = scale * vectors[3 * e + k];
+            forces[3 * receivers[e] + k] -= g;
+            forces[3 * senders[e] + k] += g;
+        }
+    }
+    return energy;
+}
+
+template void spherical_harmonics<float>(const float*, int64_t, int, float*, float*);
+template void spherical_harmonics<double>(const double*, int64_t, int, double*, double*);
+template void bessel_basis<float>(const float*, int64_t, float, int, float*, float*);
+template void bessel_basis<double>(const double*, int64_t, double, int, double*, double*);
+template void polynomial_cutoff<float>(const float*, int64_t, float, int, float*, float*);
+template void polynomial_cutoff<double>(const double*, int64_t, double, int, double*, double*);
+template void edge_features<float>(const float*, int64_t, int, float, int, int,
+                                   float*, float*, float*, float*);
+template void edge_features<double>(const double*, int64_t, int, double, int, int,
+                                    double*, double*, double*, double*);
+template void interleave3<float>(const float*, const float*, const float*, int64_t, float*);
+template void interleave3<double>(const double*, const double*, const double*, int64_t, double*);
+template void deinterleave3<float>(const float*, int64_t, float*, float*, float*);
+template void deinterleave3<double>(const double*, int64_t, double*, double*, double*);
+
+}  // namespace mace_kernels
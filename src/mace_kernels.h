@@ -0,0 +1,88 @@
+#ifndef MACE_KERNELS_H
+#define MACE_KERNELS_H
+
+#include <cstdint>
+
+/*
+ * Native CPU kernels for MACE edge featurization.
+ *
+ * Every kernel processes a whole edge array in one pass, vectorized over
+ * edges with AVX-512 or AVX2 when the library is compiled for them and a
+ * scalar path otherwise. Conventions follow the model's input stage:
+ *   - spherical harmonics match e3nn o3.SphericalHarmonics with
+ *     normalize=True and normalization="component" (lmax <= 3)
+ *   - the radial basis matches mace.modules.radial.BesselBasis
+ *   - the envelope matches mace.modules.radial.PolynomialCutoff
+ * Derivative outputs may be nullptr when they are not needed.
+ */
+namespace mace_kernels {
+
+constexpr int kMaxSphericalHarmonicsL = 3;
+
+/* Number of spherical harmonic components for 0..lmax */
+inline int num_spherical_harmonics(int lmax) { return (lmax + 1) * (lmax + 1); }
+
+/* Instruction set the kernels were compiled for: "avx512", "avx2" or "scalar" */
+const char* simd_isa();
+
+/*
+ * vectors: [n, 3] edge vectors (not necessarily normalized)
+ * sh:      [n, (lmax+1)^2]
+ * dsh:     [n, (lmax+1)^2, 3] derivative w.r.t. the unnormalized vector
+ */
+template <typename T>
+void spherical_harmonics(const T* vectors, int64_t n, int lmax, T* sh, T* dsh);
+
+/*
+ * lengths: [n] edge lengths
+ * basis:   [n, num_basis]  sqrt(2/r_max) * sin(k pi r / r_max) / r
+ * dbasis:  [n, num_basis]  derivative w.r.t. r
+ */
+template <typename T>
+void bessel_basis(const T* lengths, int64_t n, T r_max, int num_basis,
+                  T* basis, T* dbasis);
+
+/*
+ * lengths:  [n] edge lengths
+ * envelope: [n] polynomial cutoff of order p, zero for r >= r_max
+ * denvelope:[n] derivative w.r.t. r
+ */
+template <typename T>
+void polynomial_cutoff(const T* lengths, int64_t n, T r_max, int p,
+                       T* envelope, T* denvelope);
+
+/*
+ * Fused edge featurization: spherical harmonics of the edge vectors and the
+ * cutoff-weighted Bessel radial features (basis * envelope) in one pass.
+ * radial/dradial are [n, num_basis], dradial is the derivative w.r.t. r.
+ */
+template <typename T>
+void edge_features(const T* vectors, int64_t n, int lmax,
+                   T r_max, int num_basis, int p,
+                   T* sh, T* dsh, T* radial, T* dradial);
+
+/*
+ * Conversion between separate component arrays x[n], y[n], z[n] and
+ * interleaved rows xyz[n, 3], shuffling whole register blocks of atoms.
+ */
+template <typename T>
+void interleave3(const T* x, const T* y, const T* z, int64_t n, T* xyz);
+
+template <typename T>
+void deinterleave3(const T* xyz, int64_t n, T* x, T* y, T* z);
+
+/*
+ * Species-pair radial potential E = 1/2 sum_e sum_b c[type_e, b] R_b(r_e)
+ * over n directed edges, R_b the Bessel basis times the polynomial cutoff.
+ * vectors: [n, 3] receiver minus sender; coefficients: [num_types, num_basis]
+ * forces:  [num_atoms, 3], overwritten. Edges with a type outside
+ * [0, num_types) are skipped. Returns the energy.
+ */
+double pair_potential(const double* vectors, const int64_t* senders, const int64_t* receivers,
+                      const int64_t* types, int64_t n, const double* coefficients,
+                      int64_t num_types, int num_basis, int64_t num_atoms,
+                      double r_cut, int p, double* forces);
+
+}  // namespace mace_kernels
+
+#endif /* MACE_KERNELS_H */
@@ -0,0 +1,90 @@
+#include "mace_mpi.h"
+
+#ifdef MACE_WITH_MPI
+
+#include <vector>
+
+namespace mace_mpi {
+
+bool all_ranks(MPI_Comm comm, bool ok)
+{
+    int local = ok ? 1 : 0, global = 0;
+    MPI_Allreduce(&local, &global, 1, MPI_INT, MPI_MIN, comm);
+    return global == 1;
+}
+
+bool reverse_ghost_forces(MPI_Comm comm, int num_local, int num_ghost,
+                          const int* ghost_rank, const int* ghost_index,
+                          const double* forces, double* local_forces, std::string& error)
+{
+    int rank = 0, size = 1;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    /* Ghosts of this rank's own atoms are added in place; the rest are
+       packed per owner as (index, fx, fy, fz) */
+    std::vector<int> send_counts(size, 0), recv_counts(size, 0);
+    bool ok = true;
+    for (int g = 0; g < num_ghost; ++g) {
+        const int owner = ghost_rank[g];
+        if (owner < 0 || owner >= size || ghost_index[g] < 0 || (owner == rank && ghost_index[g] >= num_local)) {
+            ok = false;
+            break;
+        }
+        if (owner != rank) send_counts[owner] += 4;
+    }
+    if (!all_ranks(comm, ok)) {
+        error = "Ghost owner rank or index out of range";
+        return false;
+    }
+
+    std::vector<int> send_displs(size, 0), recv_displs(size, 0);
+    for (int r = 1; r < size; ++r) send_displs[r] = send_displs[r - 1] + send_counts[r - 1];
+    std::vector<double> send(send_displs[size - 1] + send_counts[size - 1]);
+    std::vector<int> cursor = send_displs;
+    for (int g = 0; g < num_ghost; ++g) {
+        const double* f = forces + 3 * static_cast<size_t>(num_local + g);
+        const int owner = ghost_rank[g];
+        if (owner == rank) {
+            double* dst = local_forces + 3 * static_cast<size_t>(ghost_index[g]);
+            dst[0] += f[0];
+            dst[1] += f[1];
+            dst[2] += f[2];
+            continue;
+        }
+        double* packed = send.data() + cursor[owner];
+        packed[0] = ghost_index[g];
+        packed[1] = f[0];
+        packed[2] = f[1];
+        packed[3] = f[2];
+        cursor[owner] += 4;
+    }
+
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+    for (int r = 1; r < size; ++r) recv_displs[r] = recv_displs[r - 1] + recv_counts[r - 1];
+    std::vector<double> recv(recv_displs[size - 1] + recv_counts[size - 1]);
+    MPI_Alltoallv(send.data(), send_counts.data(), send_displs.data(), MPI_DOUBLE,
+                  recv.data(), recv_counts.data(), recv_displs.data(), MPI_DOUBLE, comm);
+
+    /* Received contributions are added in rank order, so sums are reproducible */
+    for (size_t k = 0; k < recv.size(); k += 4) {
+        const int i = static_cast<int>(recv[k]);
+        if (i >= num_local) {
+            ok = false;
+            continue;
+        }
+        double* dst = local_forces + 3 * static_cast<size_t>(i);
+        dst[0] += recv[k + 1];
+        dst[1] += recv[k + 2];
+        dst[2] += recv[k + 3];
+    }
+    if (!all_ranks(comm, ok)) {
+        error = "Ghost owner index out of range";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace mace_mpi
+
+#endif /* MACE_WITH_MPI */
@@ -0,0 +1,37 @@
+#ifndef MACE_MPI_H
+#define MACE_MPI_H
+
+#ifdef MACE_WITH_MPI
+
+#include <mpi.h>
+#include <string>
+
+/*
+ * Reverse communication of ghost-atom forces.
+ *
+ * Every rank evaluates its local atoms plus ghosts; the gradient of the
+ * local energy has rows for the ghosts too, which belong to the atoms the
+ * ghosts are copies of. Those rows are sent to the owning ranks (or added
+ * locally for periodic images of one's own atoms) and summed there.
+ */
+namespace mace_mpi {
+
+/*
+ * Add the ghost rows of forces [(num_local + num_ghost) * 3] into the
+ * owners' rows: ghost g belongs to atom ghost_index[g] of rank
+ * ghost_rank[g]. local_forces [num_local * 3] must hold this rank's local
+ * rows on entry. Collective over comm; on failure (an owner out of range
+ * on any rank) every rank returns false and error describes the problem.
+ */
+bool reverse_ghost_forces(MPI_Comm comm, int num_local, int num_ghost,
+                          const int* ghost_rank, const int* ghost_index,
+                          const double* forces, double* local_forces, std::string& error);
+
+/* Logical AND of ok over all ranks */
+bool all_ranks(MPI_Comm comm, bool ok);
+
+}  // namespace mace_mpi
+
+#endif /* MACE_WITH_MPI */
+
+#endif /* MACE_MPI_H */
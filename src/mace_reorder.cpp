@@ -0,0 +1,149 @@
+#include "mace_reorder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace mace_reorder {
+
+namespace {
+
+constexpr int kBits = 16;
+
+uint64_t morton_key(const uint32_t x[3])
+{
+    uint64_t key = 0;
+    for (int bit = kBits - 1; bit >= 0; --bit)
+        for (int i = 0; i < 3; ++i)
+            key = (key << 1) | ((x[i] >> bit) & 1u);
+    return key;
+}
+
+/* Skilling, "Programming the Hilbert curve" (2004): axes to transposed index */
+uint64_t hilbert_key(const uint32_t axes[3])
+{
+    uint32_t x[3] = {axes[0], axes[1], axes[2]};
+    const uint32_t m = 1u << (kBits - 1);
+    for (uint32_t q = m; q > 1; q >>= 1) {
+        const uint32_t p = q - 1;
+        for (int i = 0; i < 3; ++i) {
+            if (x[i] & q) {
+                x[0] ^= p;
+            } else {
+                const uint32_t t = (x[0] ^ x[i]) & p;
+                x[0] ^= t;
+                x[i] ^= t;
+            }
+        }
+    }
+    for (int i = 1; i < 3; ++i) x[i] ^= x[i - 1];
+    uint32_t t = 0;
+    for (uint32_t q = m; q > 1; q >>= 1)
+        if (x[2] & q) t ^= q - 1;
+    for (int i = 0; i < 3; ++i) x[i] ^= t;
+    return morton_key(x);
+}
+
+bool invert3(const double* a, double* inv)
+{
+    const double det = a[0] * (a[4] * a[8] - a[5] * a[7])
+                     - a[1] * (a[3] * a[8] - a[5] * a[6])
+                     + a[2] * (a[3] * a[7] - a[4] * a[6]);
+    if (std::fabs(det) < 1e-12) return false;
+    inv[0] = (a[4] * a[8] - a[5] * a[7]) / det;
+    inv[1] = (a[2] * a[7] - a[1] * a[8]) / det;
+    inv[2] = (a[1] * a[5] - a[2] * a[4]) / det;
+    inv[3] = (a[5] * a[6] - a[3] * a[8]) / det;
+    inv[4] = (a[0] * a[8] - a[2] * a[6]) / det;
+    inv[5] = (a[2] * a[3] - a[0] * a[5]) / det;
+    inv[6] = (a[3] * a[7] - a[4] * a[6]) / det;
+    inv[7] = (a[1] * a[6] - a[0] * a[7]) / det;
+    inv[8] = (a[0] * a[4] - a[1] * a[3]) / det;
+    return true;
+}
+
+}  // namespace
+
+bool parse_curve(const char* name, Curve& curve)
+{
+    if (!name || std::strcmp(name, "none") == 0) curve = Curve::None;
+    else if (std::strcmp(name, "morton") == 0) curve = Curve::Morton;
+    else if (std::strcmp(name, "hilbert") == 0) curve = Curve::Hilbert;
+    else return false;
+    return true;
+}
+
+std::vector<int> curve_order(const double* positions, int num_atoms,
+                             const double* cell, const int* pbc, Curve curve)
+{
+    std::vector<int> order(num_atoms);
+    std::iota(order.begin(), order.end(), 0);
+    if (curve == Curve::None || num_atoms < 2) return order;
+
+    /* Coordinates along cell vectors when the cell is usable, else Cartesian */
+    double inv[9];
+    const bool fractional = cell && invert3(cell, inv);
+    std::vector<double> s(3 * static_cast<size_t>(num_atoms));
+    for (int a = 0; a < num_atoms; ++a) {
+        const double* r = positions + 3 * a;
+        for (int i = 0; i < 3; ++i) {
+            s[3 * a + i] = fractional ? r[0] * inv[i] + r[1] * inv[3 + i] + r[2] * inv[6 + i] : r[i];
+            if (fractional && pbc && pbc[i]) s[3 * a + i] -= std::floor(s[3 * a + i]);
+        }
+    }
+
+    double lo[3], span[3];
+    for (int i = 0; i < 3; ++i) {
+        if (fractional && pbc && pbc[i]) {
+            lo[i] = 0.0;
+            span[i] = 1.0;
+            continue;
+        }
+        double mn = s[i], mx = s[i];
+        for (int a = 1; a < num_atoms; ++a) {
+            mn = std::min(mn, s[3 * a + i]);
+            mx = std::max(mx, s[3 * a + i]);
+        }
+        lo[i] = mn;
+        span[i] = mx > mn ? mx - mn : 1.0;
+    }
+
+    const double scale = static_cast<double>((1u << kBits) - 1);
+    std::vector<uint64_t> keys(num_atoms);
+    for (int a = 0; a < num_atoms; ++a) {
+        uint32_t q[3];
+        for (int i = 0; i < 3; ++i) {
+            const double u = std::min(std::max((s[3 * a + i] - lo[i]) / span[i], 0.0), 1.0);
+            q[i] = static_cast<uint32_t>(u * scale);
+        }
+        keys[a] = curve == Curve::Hilbert ? hilbert_key(q) : morton_key(q);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+    return order;
+}
+
+void Reordering::configure(Curve curve, int interval)
+{
+    curve_ = curve;
+    interval_ = interval > 0 ? interval : 100;
+    uses_ = 0;
+    order_.clear();
+    numbers_.clear();
+}
+
+const std::vector<int>& Reordering::order(const double* positions, const int* numbers, int num_atoms,
+                                          const double* cell, const int* pbc)
+{
+    const bool same_system = static_cast<int>(order_.size()) == num_atoms
+        && std::equal(numbers_.begin(), numbers_.end(), numbers);
+    if (!same_system || uses_ >= interval_) {
+        order_ = curve_order(positions, num_atoms, cell, pbc, curve_);
+        numbers_.assign(numbers, numbers + num_atoms);
+        uses_ = 0;
+    }
+    ++uses_;
+    return order_;
+}
+
+}  // namespace mace_reorder
@@ -0,0 +1,50 @@
+#ifndef MACE_REORDER_H
+#define MACE_REORDER_H
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Space-filling-curve ordering of atoms.
+ *
+ * Atoms that are close in space get close indices, so the neighbor gathers
+ * and scatter-adds of message passing touch nearby memory. Coordinates are
+ * fractional along periodic axes (wrapped into the cell) and normalized to
+ * the bounding box along the others, then quantized to 16 bits per axis.
+ */
+namespace mace_reorder {
+
+enum class Curve { None, Morton, Hilbert };
+
+/* Parse "none", "morton" or "hilbert"; returns false for anything else */
+bool parse_curve(const char* name, Curve& curve);
+
+/*
+ * Permutation that sorts atoms along the curve: order[k] is the caller's
+ * index of the k-th atom. cell/pbc may be nullptr for isolated systems.
+ */
+std::vector<int> curve_order(const double* positions, int num_atoms,
+                             const double* cell, const int* pbc, Curve curve);
+
+/* Per-handle permutation, recomputed only every `interval` uses */
+class Reordering {
+public:
+    void configure(Curve curve, int interval);
+    bool active() const { return curve_ != Curve::None; }
+
+    /* Current order for this input, re-sorting when due or when the
+       atom count or species changed */
+    const std::vector<int>& order(const double* positions, const int* numbers, int num_atoms,
+                                  const double* cell, const int* pbc);
+
+private:
+    Curve curve_ = Curve::None;
+    int interval_ = 100;
+    int uses_ = 0;
+    std::vector<int> order_;
+    std::vector<int> numbers_;
+};
+
+}  // namespace mace_reorder
+
+#endif /* MACE_REORDER_H */
@@ -1,18 +1,217 @@
 #include "mace_wrapper.h"
+#include "mace_kernels.h"
+#include "mace_cache.h"
+#include "mace_reorder.h"
+#include "mace_band.h"
+#include "mace_mpi.h"
 #include <pybind11/embed.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include <dlfcn.h>
+#include <algorithm>
+#include <cmath>
 #include <string>
+#include <vector>
 #include <cstring>
 #include <iostream>
 #include <cstdlib>
+#include <stdexcept>
 
 namespace py = pybind11;
 
+template <typename T>
+using native_array = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+template <typename T>
+static py::tuple native_spherical_harmonics(native_array<T> vectors, int lmax, bool grad)
+{
+    if (vectors.ndim() != 2 || vectors.shape(1) != 3) {
+        throw std::invalid_argument("vectors must have shape [n, 3]");
+    }
+    const py::ssize_t n = vectors.shape(0);
+    const py::ssize_t nsh = mace_kernels::num_spherical_harmonics(lmax);
+
+    py::array_t<T> sh({n, nsh});
+    py::array_t<T> dsh(grad ? std::vector<py::ssize_t>{n, nsh, 3} : std::vector<py::ssize_t>{0});
+    {
+        py::gil_scoped_release release;
+        mace_kernels::spherical_harmonics<T>(vectors.data(), n, lmax, sh.mutable_data(),
+                                             grad ? dsh.mutable_data() : nullptr);
+    }
+    return py::make_tuple(sh, grad ? py::object(dsh) : py::object(py::none()));
+}
+
+template <typename T>
+static py::tuple native_bessel_basis(native_array<T> lengths, double r_max, int num_basis, bool grad)
+{
+    const py::ssize_t n = lengths.size();
+    py::array_t<T> basis({n, static_cast<py::ssize_t>(num_basis)});
+    py::array_t<T> dbasis(grad ? std::vector<py::ssize_t>{n, num_basis} : std::vector<py::ssize_t>{0});
+    {
+        py::gil_scoped_release release;
+        mace_kernels::bessel_basis<T>(lengths.data(), n, static_cast<T>(r_max), num_basis,
+                                      basis.mutable_data(), grad ? dbasis.mutable_data() : nullptr);
+    }
+    return py::make_tuple(basis, grad ? py::object(dbasis) : py::object(py::none()));
+}
+
+template <typename T>
+static py::tuple native_polynomial_cutoff(native_array<T> lengths, double r_max, int p, bool grad)
+{
+    const py::ssize_t n = lengths.size();
+    py::array_t<T> envelope(n);
+    py::array_t<T> denvelope(grad ? n : 0);
+    {
+        py::gil_scoped_release release;
+        mace_kernels::polynomial_cutoff<T>(lengths.data(), n, static_cast<T>(r_max), p,
+                                           envelope.mutable_data(),
+                                           grad ? denvelope.mutable_data() : nullptr);
+    }
+    return py::make_tuple(envelope, grad ? py::object(denvelope) : py::object(py::none()));
+}
+
+/*
+ * Pair potential E = 1/2 sum_e sum_b c[type_e, b] R_b(r_e) over directed edges,
+ * with R_b the cutoff-weighted Bessel basis. Used as the fast inner force of
+ * multiple time stepping MD; returns (energy, forces [num_atoms, 3]).
+ */
+static py::tuple native_pair_potential(native_array<double> vectors,
+                                       native_array<int64_t> senders,
+                                       native_array<int64_t> receivers,
+                                       native_array<int64_t> pair_types,
+                                       native_array<double> coefficients,
+                                       int num_atoms, double r_cut, int p)
+{
+    if (vectors.ndim() != 2 || vectors.shape(1) != 3 || coefficients.ndim() != 2) {
+        throw std::invalid_argument("vectors must have shape [n, 3] and coefficients [types, basis]");
+    }
+    const py::ssize_t n = vectors.shape(0);
+    const py::ssize_t num_types = coefficients.shape(0);
+    const int num_basis = static_cast<int>(coefficients.shape(1));
+    if (senders.size() != n || receivers.size() != n || pair_types.size() != n) {
+        throw std::invalid_argument("edge arrays must have the same length");
+    }
+
+    py::array_t<double> forces({static_cast<py::ssize_t>(num_atoms), static_cast<py::ssize_t>(3)});
+    double energy;
+    {
+        py::gil_scoped_release release;
+        energy = mace_kernels::pair_potential(vectors.data(), senders.data(), receivers.data(),
+                                              pair_types.data(), n, coefficients.data(), num_types,
+                                              num_basis, num_atoms, r_cut, p, forces.mutable_data());
+    }
+    return py::make_tuple(energy, forces);
+}
+
+/* Native kernels, imported by mace_calculator.py to replace the model's input stage */
+PYBIND11_EMBEDDED_MODULE(_mace_native, m) {
+    m.def("simd_isa", &mace_kernels::simd_isa);
+    m.def("spherical_harmonics", &native_spherical_harmonics<float>);
+    m.def("spherical_harmonics", &native_spherical_harmonics<double>);
+    m.def("bessel_basis", &native_bessel_basis<float>);
+    m.def("bessel_basis", &native_bessel_basis<double>);
+    m.def("polynomial_cutoff", &native_polynomial_cutoff<float>);
+    m.def("polynomial_cutoff", &native_polynomial_cutoff<double>);
+    m.def("pair_potential", &native_pair_potential);
+}
+
 struct MACECalculator {
     py::scoped_interpreter* interpreter;
     py::module_* mace_module;
+    py::object* session;            /* mace_calculator.MACESession owned by this handle */
     std::string last_error;
+    std::string active_precision;
+    int registered_atoms = 0;       /* Atoms of the system from mace_register_system */
+    mace_cache::ResultCache cache;  /* Opt-in, see mace_set_result_cache */
+    mace_reorder::Reordering reordering;  /* Opt-in, see mace_set_reordering */
+};
+
+/* Serve a calculation from the handle's result cache; false on a miss */
+static bool cached_result(MACECalculator* calc, const double* positions, const int* atomic_numbers,
+                          int num_atoms, const double* cell, const int* pbc, MACEResult* result)
+{
+    if (!calc->cache.enabled()) return false;
+    const mace_cache::Entry* entry = calc->cache.find(positions, atomic_numbers, num_atoms, cell, pbc);
+    if (!entry) return false;
+
+    result->energy = entry->energy;
+    result->num_atoms = num_atoms;
+    result->forces = new double[num_atoms * 3];
+    std::memcpy(result->forces, entry->forces.data(), sizeof(double) * num_atoms * 3);
+    result->success = 1;
+    result->error_msg[0] = '\0';
+    calc->active_precision = entry->precision;
+    return true;
+}
+
+/* Python views of a caller-owned MACESystem */
+static py::array_t<double> system_array(const double* data, int num_atoms)
+{
+    return py::array_t<double>({static_cast<py::ssize_t>(num_atoms), static_cast<py::ssize_t>(3)}, data);
+}
+
+/* Read-only view of caller memory, valid for the duration of one call */
+template <typename T>
+static py::array_t<T> borrowed_array(const T* data, py::ssize_t rows, py::ssize_t cols)
+{
+    py::capsule no_owner(data, [](void*) {});
+    return py::array_t<T>({rows, cols}, {static_cast<py::ssize_t>(sizeof(T)) * cols,
+                                         static_cast<py::ssize_t>(sizeof(T))}, data, no_owner);
+}
+
+/* Cell and pbc arguments of a call whose cell may be NULL (non-periodic) */
+static py::object optional_cell(const double* cell)
+{
+    if (!cell) return py::none();
+    return borrowed_array(cell, 3, 3);
+}
+
+static py::object optional_pbc(const int* pbc)
+{
+    if (!pbc) return py::none();
+    py::list periodic;
+    for (int i = 0; i < 3; ++i) periodic.append(py::bool_(pbc[i]));
+    return periodic;
+}
+
+static py::object system_cell(const MACESystem* system)
+{
+    return py::array_t<double>({static_cast<py::ssize_t>(3), static_cast<py::ssize_t>(3)}, system->cell);
+}
+
+static py::list system_pbc(const MACESystem* system)
+{
+    py::list pbc;
+    for (int i = 0; i < 3; ++i) pbc.append(py::bool_(system->pbc[i]));
+    return pbc;
+}
+
+static py::list system_numbers(const MACESystem* system)
+{
+    py::list numbers;
+    for (int i = 0; i < system->num_atoms; ++i) numbers.append(system->atomic_numbers[i]);
+    return numbers;
+}
+
+static void copy_to_system(const py::object& value, double* dst, int num_atoms)
+{
+    if (!dst || value.is_none()) return;
+    native_array<double> array = value.cast<native_array<double>>();
+    if (array.size() != static_cast<py::ssize_t>(num_atoms) * 3) {
+        throw std::runtime_error("unexpected array size from Python");
+    }
+    std::memcpy(dst, array.data(), sizeof(double) * num_atoms * 3);
+}
+
+static bool valid_system(const MACESystem* system)
+{
+    return system && system->num_atoms > 0 && system->atomic_numbers && system->positions;
+}
+
+/* Monte Carlo state (mace_calculator.MCState) bound to a calculator */
+struct MACEMCState {
+    MACECalculator* calc;
+    py::object* state;
 };
 
 static py::scoped_interpreter* g_interpreter = nullptr;
@@ -24,6 +223,15 @@ MACEHandle mace_init(const char* model_path,
                      const char* model_type,
                      const char* device,
                      int enable_cueq)
+{
+    return mace_init_with_precision(model_path, model_type, device, enable_cueq, "float32");
+}
+
+MACEHandle mace_init_with_precision(const char* model_path,
+                                    const char* model_type,
+                                    const char* device,
+                                    int enable_cueq,
+                                    const char* precision)
 {
     try {
         MACECalculator* calc = new MACECalculator();
@@ -67,7 +275,7 @@ MACEHandle mace_init(const char* model_path,
         calc->interpreter = g_interpreter;
         calc->mace_module = new py::module_(py::module_::import("mace_calculator"));
 
-        py::object init_func = calc->mace_module->attr("initialize_mace");
+        py::object create_func = calc->mace_module->attr("create_session");
 
         py::object py_model_path;
         if (model_path) {
@@ -76,19 +284,20 @@ MACEHandle mace_init(const char* model_path,
             py_model_path = py::none();
         }
 
-        py::object result = init_func(
-            py_model_path,
-            py::str(model_type ? model_type : "medium"),
-            py::str(device ? device : "cuda"),
-            py::bool_(enable_cueq),
-            py::str("float32")
-        );
-
-        if (!result.cast<bool>()) {
+        try {
+            calc->session = new py::object(create_func(
+                py_model_path,
+                py::str(model_type ? model_type : "medium"),
+                py::str(device ? device : "cuda"),
+                py::bool_(enable_cueq),
+                py::str(precision ? precision : "float32")
+            ));
+        } catch (...) {
+            delete calc->mace_module;
             delete calc;
-            calc->last_error = "Failed to initialize MACE calculator";
-            return nullptr;
+            throw;
         }
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
 
         return static_cast<MACEHandle>(calc);
 
@@ -114,10 +323,22 @@ void mace_calculate(MACEHandle handle,
     }
 
     MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (cached_result(calc, positions, atomic_numbers, num_atoms, nullptr, nullptr, result)) return;
 
     try {
+        /* Atoms are passed in space-filling-curve order when reordering is on */
+        std::vector<int> identity;
+        const std::vector<int>* order = &identity;
+        if (calc->reordering.active()) {
+            order = &calc->reordering.order(positions, atomic_numbers, num_atoms, nullptr, nullptr);
+        } else {
+            identity.resize(num_atoms);
+            for (int i = 0; i < num_atoms; ++i) identity[i] = i;
+        }
+
         py::list py_positions;
-        for (int i = 0; i < num_atoms; ++i) {
+        for (int k = 0; k < num_atoms; ++k) {
+            const int i = (*order)[k];
             py::list pos;
             pos.append(positions[i*3 + 0]);
             pos.append(positions[i*3 + 1]);
@@ -126,13 +347,14 @@ void mace_calculate(MACEHandle handle,
         }
 
         py::list py_atomic_numbers;
-        for (int i = 0; i < num_atoms; ++i) {
-            py_atomic_numbers.append(atomic_numbers[i]);
+        for (int k = 0; k < num_atoms; ++k) {
+            py_atomic_numbers.append(atomic_numbers[(*order)[k]]);
         }
 
-        py::object compute_func = calc->mace_module->attr("compute_energy_forces");
+        py::object compute_func = calc->session->attr("compute");
         py::dict py_result = compute_func(py_positions, py_atomic_numbers,
                                           py::none(), py::none());
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
 
         result->energy = py_result["energy"].cast<double>();
         result->num_atoms = num_atoms;
@@ -141,12 +363,15 @@ void mace_calculate(MACEHandle handle,
 
         result->forces = new double[num_atoms * 3];
         py::list forces_list = py_result["forces"];
-        for (int i = 0; i < num_atoms; ++i) {
-            py::list force = forces_list[i];
+        for (int k = 0; k < num_atoms; ++k) {
+            const int i = (*order)[k];
+            py::list force = forces_list[k];
             result->forces[i*3 + 0] = force[0].cast<double>();
             result->forces[i*3 + 1] = force[1].cast<double>();
             result->forces[i*3 + 2] = force[2].cast<double>();
         }
+        calc->cache.insert(positions, atomic_numbers, num_atoms, nullptr, nullptr,
+                           result->energy, result->forces, calc->active_precision);
 
     } catch (const std::exception& e) {
         result->success = 0;
@@ -172,10 +397,22 @@ void mace_calculate_periodic(MACEHandle handle,
     }
 
     MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (cached_result(calc, positions, atomic_numbers, num_atoms, cell, pbc, result)) return;
 
     try {
+        /* Atoms are passed in space-filling-curve order when reordering is on */
+        std::vector<int> identity;
+        const std::vector<int>* order = &identity;
+        if (calc->reordering.active()) {
+            order = &calc->reordering.order(positions, atomic_numbers, num_atoms, cell, pbc);
+        } else {
+            identity.resize(num_atoms);
+            for (int i = 0; i < num_atoms; ++i) identity[i] = i;
+        }
+
         py::list py_positions;
-        for (int i = 0; i < num_atoms; ++i) {
+        for (int k = 0; k < num_atoms; ++k) {
+            const int i = (*order)[k];
             py::list pos;
             pos.append(positions[i*3 + 0]);
             pos.append(positions[i*3 + 1]);
@@ -184,8 +421,8 @@ void mace_calculate_periodic(MACEHandle handle,
         }
 
         py::list py_atomic_numbers;
-        for (int i = 0; i < num_atoms; ++i) {
-            py_atomic_numbers.append(atomic_numbers[i]);
+        for (int k = 0; k < num_atoms; ++k) {
+            py_atomic_numbers.append(atomic_numbers[(*order)[k]]);
         }
 
         py::list py_cell;
@@ -202,9 +439,10 @@ void mace_calculate_periodic(MACEHandle handle,
         py_pbc.append(py::bool_(pbc[1]));
         py_pbc.append(py::bool_(pbc[2]));
 
-        py::object compute_func = calc->mace_module->attr("compute_energy_forces");
+        py::object compute_func = calc->session->attr("compute");
         py::dict py_result = compute_func(py_positions, py_atomic_numbers,
                                           py_cell, py_pbc);
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
 
         result->energy = py_result["energy"].cast<double>();
         result->num_atoms = num_atoms;
@@ -213,12 +451,15 @@ void mace_calculate_periodic(MACEHandle handle,
 
         result->forces = new double[num_atoms * 3];
         py::list forces_list = py_result["forces"];
-        for (int i = 0; i < num_atoms; ++i) {
-            py::list force = forces_list[i];
+        for (int k = 0; k < num_atoms; ++k) {
+            const int i = (*order)[k];
+            py::list force = forces_list[k];
             result->forces[i*3 + 0] = force[0].cast<double>();
             result->forces[i*3 + 1] = force[1].cast<double>();
             result->forces[i*3 + 2] = force[2].cast<double>();
         }
+        calc->cache.insert(positions, atomic_numbers, num_atoms, cell, pbc,
+                           result->energy, result->forces, calc->active_precision);
 
     } catch (const std::exception& e) {
         result->success = 0;
@@ -226,6 +467,492 @@ void mace_calculate_periodic(MACEHandle handle,
     }
 }
 
+double mace_get_ghost_cutoff(MACEHandle handle)
+{
+    if (!handle) return -1.0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+
+    try {
+        return calc->session->attr("ghost_cutoff")().cast<double>();
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return -1.0;
+    }
+}
+
+int mace_calculate_local(MACEHandle handle,
+                         int num_local,
+                         int num_ghost,
+                         const int* atomic_numbers,
+                         const double* positions,
+                         double* energy,
+                         double* forces)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    const int n = num_local + num_ghost;
+    if (num_local < 0 || num_ghost < 0 || !energy || (n > 0 && (!atomic_numbers || !positions || !forces))) {
+        calc->last_error = "Invalid local/ghost atom arguments";
+        return 0;
+    }
+
+    /* Ranks without local atoms contribute nothing */
+    *energy = 0.0;
+    if (num_local == 0) {
+        if (n > 0) std::memset(forces, 0, sizeof(double) * 3 * n);
+        return 1;
+    }
+
+    try {
+        py::list numbers;
+        for (int i = 0; i < n; ++i) numbers.append(atomic_numbers[i]);
+
+        py::tuple out = calc->session->attr("compute_local")(numbers, system_array(positions, n), num_local);
+        *energy = out[0].cast<double>();
+        copy_to_system(out[1], forces, n);
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
+        return 1;
+
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+double mace_get_cutoff(MACEHandle handle)
+{
+    if (!handle) return -1.0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+
+    try {
+        return calc->session->attr("cutoff")().cast<double>();
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return -1.0;
+    }
+}
+
+int mace_calculate_local_graph(MACEHandle handle,
+                               int num_local,
+                               int num_ghost,
+                               const int* atomic_numbers,
+                               const double* positions,
+                               int num_edges,
+                               const int* edge_index,
+                               int topology_changed,
+                               double* energy,
+                               double* node_energies,
+                               double* forces,
+                               double* virials)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    const int n = num_local + num_ghost;
+    if (num_local < 0 || num_ghost < 0 || !energy || (n > 0 && (!positions || !forces))
+        || (topology_changed && n > 0 && (!atomic_numbers || num_edges < 0 || (num_edges > 0 && !edge_index)))) {
+        calc->last_error = "Invalid local graph arguments";
+        return 0;
+    }
+    *energy = 0.0;
+    if (n == 0) return 1;
+
+    try {
+        /* Species and edges only cross into Python after a topology change;
+           positions are passed as a view of the caller's array */
+        py::object numbers = py::none(), edges = py::none();
+        if (topology_changed) {
+            numbers = py::array_t<int>(n, atomic_numbers);
+            edges = py::array_t<int>({static_cast<py::ssize_t>(2), static_cast<py::ssize_t>(num_edges)},
+                                     edge_index);
+        }
+        py::tuple out = calc->session->attr("compute_local_graph")(
+            numbers, borrowed_array(positions, n, 3), edges, num_local,
+            py::bool_(topology_changed != 0), py::bool_(node_energies != nullptr),
+            py::bool_(virials != nullptr));
+
+        *energy = out[0].cast<double>();
+        if (node_energies && num_local > 0) {
+            native_array<double> local = out[1].cast<native_array<double>>();
+            if (local.size() != num_local) throw std::runtime_error("unexpected array size from Python");
+            std::memcpy(node_energies, local.data(), sizeof(double) * num_local);
+        }
+        copy_to_system(out[2], forces, n);
+        if (virials) {
+            native_array<double> values = out[3].cast<native_array<double>>();
+            if (values.size() != static_cast<py::ssize_t>(n) * 9) {
+                throw std::runtime_error("unexpected array size from Python");
+            }
+            std::memcpy(virials, values.data(), sizeof(double) * n * 9);
+        }
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
+        return 1;
+
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+#ifdef MACE_WITH_MPI
+int mace_calculate_mpi(MACEHandle handle,
+                       MPI_Comm comm,
+                       int num_local,
+                       int num_ghost,
+                       const int* atomic_numbers,
+                       const double* positions,
+                       const int* ghost_rank,
+                       const int* ghost_index,
+                       double* energy,
+                       double* forces)
+{
+    /* Every rank must reach the same collectives, so failures are agreed on */
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    const size_t n = static_cast<size_t>(num_local > 0 ? num_local : 0) + (num_ghost > 0 ? num_ghost : 0);
+    std::vector<double> all(3 * n);
+    double local_energy = 0.0;
+    const char* invalid = !energy || (num_local > 0 && !forces) ? "energy and forces must not be NULL"
+        : num_ghost > 0 && (!ghost_rank || !ghost_index) ? "ghost_rank and ghost_index are required with ghosts"
+        : nullptr;
+    if (calc && invalid) calc->last_error = invalid;
+    bool ok = calc && !invalid
+        && mace_calculate_local(handle, num_local, num_ghost, atomic_numbers, positions,
+                                &local_energy, all.data());
+    if (!mace_mpi::all_ranks(comm, ok)) {
+        if (calc && ok) calc->last_error = "Local evaluation failed on another rank";
+        return 0;
+    }
+
+    if (num_local > 0) std::memcpy(forces, all.data(), sizeof(double) * 3 * num_local);
+    std::string error;
+    if (!mace_mpi::reverse_ghost_forces(comm, num_local, num_ghost, ghost_rank, ghost_index,
+                                        all.data(), forces, error)) {
+        calc->last_error = error;
+        return 0;
+    }
+    MPI_Allreduce(&local_energy, energy, 1, MPI_DOUBLE, MPI_SUM, comm);
+    return 1;
+}
+#endif
+
+int mace_calculate_atomic(MACEHandle handle,
+                          const double* positions,
+                          const int* atomic_numbers,
+                          int num_atoms,
+                          const double* cell,
+                          const int* pbc,
+                          double* energy,
+                          double* forces,
+                          double* atom_energies,
+                          double* atom_virials)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (num_atoms <= 0 || !positions || !atomic_numbers || !energy || !forces || (cell && !pbc)) {
+        calc->last_error = "Invalid per-atom calculation arguments";
+        return 0;
+    }
+
+    try {
+        py::tuple out = calc->session->attr("compute_atomic")(
+            borrowed_array(positions, num_atoms, 3), py::array_t<int>(num_atoms, atomic_numbers),
+            optional_cell(cell), optional_pbc(cell ? pbc : nullptr), py::bool_(atom_virials != nullptr));
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
+
+        *energy = out[0].cast<double>();
+        copy_to_system(out[1], forces, num_atoms);
+        if (atom_energies) {
+            native_array<double> values = out[2].cast<native_array<double>>();
+            if (values.size() != num_atoms) throw std::runtime_error("unexpected array size from Python");
+            std::memcpy(atom_energies, values.data(), sizeof(double) * num_atoms);
+        }
+        if (atom_virials) {
+            native_array<double> values = out[3].cast<native_array<double>>();
+            if (values.size() != static_cast<py::ssize_t>(num_atoms) * 9) {
+                throw std::runtime_error("unexpected array size from Python");
+            }
+            std::memcpy(atom_virials, values.data(), sizeof(double) * num_atoms * 9);
+        }
+        return 1;
+
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_calculate_subset_forces(MACEHandle handle,
+                                 const double* positions,
+                                 const int* atomic_numbers,
+                                 int num_atoms,
+                                 const double* cell,
+                                 const int* pbc,
+                                 const int* subset,
+                                 int num_subset,
+                                 double* forces)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (num_atoms <= 0 || !positions || !atomic_numbers || num_subset < 0 || (cell && !pbc)
+        || (num_subset > 0 && (!subset || !forces))) {
+        calc->last_error = "Invalid subset force arguments";
+        return 0;
+    }
+    if (num_subset == 0) return 1;
+
+    try {
+        py::object out = calc->session->attr("compute_subset")(
+            borrowed_array(positions, num_atoms, 3), py::array_t<int>(num_atoms, atomic_numbers),
+            optional_cell(cell), optional_pbc(cell ? pbc : nullptr), py::array_t<int>(num_subset, subset));
+        copy_to_system(out, forces, num_subset);
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
+        return 1;
+
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_calculate_hessian(MACEHandle handle,
+                           const double* positions,
+                           const int* atomic_numbers,
+                           int num_atoms,
+                           const double* cell,
+                           const int* pbc,
+                           double* forces,
+                           double* hessian)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (num_atoms <= 0 || !positions || !atomic_numbers || !hessian || (cell && !pbc)) {
+        calc->last_error = "Invalid Hessian arguments";
+        return 0;
+    }
+
+    try {
+        py::tuple out = calc->session->attr("hessian")(
+            borrowed_array(positions, num_atoms, 3), py::array_t<int>(num_atoms, atomic_numbers),
+            optional_cell(cell), optional_pbc(cell ? pbc : nullptr));
+
+        const size_t n3 = 3 * static_cast<size_t>(num_atoms);
+        native_array<double> matrix = out[1].cast<native_array<double>>();
+        if (static_cast<size_t>(matrix.size()) != n3 * n3) {
+            throw std::runtime_error("unexpected array size from Python");
+        }
+        std::memcpy(hessian, matrix.data(), sizeof(double) * n3 * n3);
+        copy_to_system(out[0], forces, num_atoms);
+        return 1;
+
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_hessian_vector_product(MACEHandle handle,
+                                const double* positions,
+                                const int* atomic_numbers,
+                                int num_atoms,
+                                const double* cell,
+                                const int* pbc,
+                                const double* vectors,
+                                int num_vectors,
+                                double* forces,
+                                double* products)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (num_atoms <= 0 || !positions || !atomic_numbers || num_vectors < 0 || (cell && !pbc)
+        || (num_vectors > 0 && (!vectors || !products))) {
+        calc->last_error = "Invalid Hessian-vector product arguments";
+        return 0;
+    }
+
+    try {
+        py::tuple out = calc->session->attr("hessian_vector_product")(
+            borrowed_array(positions, num_atoms, 3), py::array_t<int>(num_atoms, atomic_numbers),
+            optional_cell(cell), optional_pbc(cell ? pbc : nullptr),
+            borrowed_array(vectors, num_vectors, 3 * static_cast<py::ssize_t>(num_atoms)));
+
+        copy_to_system(out[0], forces, num_atoms);
+        const size_t count = 3 * static_cast<size_t>(num_atoms) * num_vectors;
+        native_array<double> result = out[1].cast<native_array<double>>();
+        if (static_cast<size_t>(result.size()) != count) throw std::runtime_error("unexpected array size from Python");
+        if (count) std::memcpy(products, result.data(), sizeof(double) * count);
+        return 1;
+
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+/* Single-precision entry points: float32 buffers cross the boundary without lists or conversions */
+static int calculate_f32(MACEHandle handle, const float* positions, const int* atomic_numbers,
+                         int num_atoms, const float* cell, const int* pbc,
+                         double* energy, float* forces)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (num_atoms <= 0 || !positions || !atomic_numbers || !energy || !forces) {
+        calc->last_error = "Invalid single-precision arguments";
+        return 0;
+    }
+
+    try {
+        py::object py_cell = py::none();
+        py::object py_pbc = py::none();
+        if (cell) {
+            py_cell = borrowed_array<float>(cell, 3, 3);
+            py::list periodic;
+            for (int i = 0; i < 3; ++i) periodic.append(py::bool_(pbc[i]));
+            py_pbc = periodic;
+        }
+
+        py::tuple out = calc->session->attr("compute_array")(
+            borrowed_array<float>(positions, num_atoms, 3),
+            borrowed_array<int>(atomic_numbers, num_atoms, 1).attr("ravel")(),
+            py_cell, py_pbc, py::module_::import("numpy").attr("float32"));
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
+
+        native_array<float> result = out[1].cast<native_array<float>>();
+        if (result.size() != static_cast<py::ssize_t>(num_atoms) * 3) {
+            throw std::runtime_error("unexpected array size from Python");
+        }
+        *energy = out[0].cast<double>();
+        std::memcpy(forces, result.data(), sizeof(float) * num_atoms * 3);
+        return 1;
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_calculate_f32(MACEHandle handle,
+                       const float* positions,
+                       const int* atomic_numbers,
+                       int num_atoms,
+                       double* energy,
+                       float* forces)
+{
+    return calculate_f32(handle, positions, atomic_numbers, num_atoms, nullptr, nullptr, energy, forces);
+}
+
+int mace_calculate_periodic_f32(MACEHandle handle,
+                                const float* positions,
+                                const int* atomic_numbers,
+                                int num_atoms,
+                                const float* cell,
+                                const int* pbc,
+                                double* energy,
+                                float* forces)
+{
+    if (!cell || !pbc) {
+        if (handle) static_cast<MACECalculator*>(handle)->last_error = "Periodic call needs cell and pbc";
+        return 0;
+    }
+    return calculate_f32(handle, positions, atomic_numbers, num_atoms, cell, pbc, energy, forces);
+}
+
+/* SoA entry points: the component arrays are stacked into the model's [n, 3]
+ * input on the Python side, forces are transposed back into fx/fy/fz */
+static int calculate_soa(MACEHandle handle, const double* x, const double* y, const double* z,
+                         const int* atomic_numbers, int num_atoms, const double* cell, const int* pbc,
+                         double* energy, double* fx, double* fy, double* fz)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (num_atoms <= 0 || !x || !y || !z || !atomic_numbers || !energy || !fx || !fy || !fz) {
+        calc->last_error = "Invalid SoA arguments";
+        return 0;
+    }
+
+    /* The result cache is keyed on interleaved positions; only build them when it is on */
+    std::vector<double> positions;
+    if (calc->cache.enabled()) {
+        positions.resize(3 * static_cast<size_t>(num_atoms));
+        mace_kernels::interleave3(x, y, z, num_atoms, positions.data());
+        const mace_cache::Entry* entry = calc->cache.find(positions.data(), atomic_numbers, num_atoms, cell, pbc);
+        if (entry) {
+            *energy = entry->energy;
+            mace_kernels::deinterleave3(entry->forces.data(), num_atoms, fx, fy, fz);
+            calc->active_precision = entry->precision;
+            return 1;
+        }
+    }
+
+    try {
+        py::object numpy = py::module_::import("numpy");
+        py::list components;
+        for (const double* component : {x, y, z}) {
+            components.append(borrowed_array(component, num_atoms, 1).attr("ravel")());
+        }
+        py::tuple out = calc->session->attr("compute_array")(
+            numpy.attr("stack")(components, py::arg("axis") = 1),
+            borrowed_array<int>(atomic_numbers, num_atoms, 1).attr("ravel")(),
+            optional_cell(cell), optional_pbc(pbc));
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
+
+        native_array<double> forces = out[1].cast<native_array<double>>();
+        if (forces.size() != static_cast<py::ssize_t>(num_atoms) * 3) {
+            throw std::runtime_error("unexpected array size from Python");
+        }
+        *energy = out[0].cast<double>();
+        mace_kernels::deinterleave3(forces.data(), num_atoms, fx, fy, fz);
+        calc->cache.insert(positions.data(), atomic_numbers, num_atoms, cell, pbc,
+                           *energy, forces.data(), calc->active_precision);
+        return 1;
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_calculate_soa(MACEHandle handle,
+                       const double* x,
+                       const double* y,
+                       const double* z,
+                       const int* atomic_numbers,
+                       int num_atoms,
+                       double* energy,
+                       double* fx,
+                       double* fy,
+                       double* fz)
+{
+    return calculate_soa(handle, x, y, z, atomic_numbers, num_atoms, nullptr, nullptr,
+                         energy, fx, fy, fz);
+}
+
+int mace_calculate_periodic_soa(MACEHandle handle,
+                                const double* x,
+                                const double* y,
+                                const double* z,
+                                const int* atomic_numbers,
+                                int num_atoms,
+                                const double* cell,
+                                const int* pbc,
+                                double* energy,
+                                double* fx,
+                                double* fy,
+                                double* fz)
+{
+    if (!cell || !pbc) {
+        if (handle) static_cast<MACECalculator*>(handle)->last_error = "Periodic SoA call needs cell and pbc";
+        return 0;
+    }
+    return calculate_soa(handle, x, y, z, atomic_numbers, num_atoms, cell, pbc, energy, fx, fy, fz);
+}
+
 void mace_free_forces(double* forces) {
     delete[] forces;
 }
@@ -241,6 +968,7 @@ void mace_destroy(MACEHandle handle) {
     if (!handle) return;
 
     MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    delete calc->session;
     delete calc->mace_module;
 
     g_init_count--;
@@ -258,4 +986,714 @@ const char* mace_get_error(MACEHandle handle) {
     return calc->last_error.c_str();
 }
 
+int mace_edge_features(const double* vectors,
+                       int num_edges,
+                       int lmax,
+                       double r_max,
+                       int num_bessel,
+                       int cutoff_p,
+                       double* sh,
+                       double* sh_grad,
+                       double* radial,
+                       double* radial_grad)
+{
+    if (!vectors || num_edges < 0 || (!sh && !radial)) return 0;
+    if (lmax < 0 || lmax > mace_kernels::kMaxSphericalHarmonicsL) return 0;
+    if (radial && (r_max <= 0.0 || num_bessel <= 0 || cutoff_p <= 0)) return 0;
+
+    mace_kernels::edge_features<double>(vectors, num_edges, lmax, r_max, num_bessel, cutoff_p,
+                                        sh, sh ? sh_grad : nullptr,
+                                        radial, radial ? radial_grad : nullptr);
+    return 1;
+}
+
+int mace_set_native_features(MACEHandle handle, int enable)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+
+    try {
+        calc->cache.clear();
+        py::object set_func = calc->session->attr("set_native_edge_features");
+        return set_func(py::bool_(enable)).cast<bool>() ? 1 : 0;
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_set_precision(MACEHandle handle, const char* precision)
+{
+    if (!handle || !precision) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+
+    try {
+        calc->cache.clear();
+        calc->session->attr("set_precision")(py::str(precision));
+        return 1;
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_set_adaptive_threshold(MACEHandle handle, double fmax)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+
+    try {
+        calc->cache.clear();
+        calc->session->attr("set_adaptive_threshold")(fmax);
+        return 1;
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_set_reordering(MACEHandle handle, const char* curve, int resort_interval)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    mace_reorder::Curve parsed;
+    if (!mace_reorder::parse_curve(curve, parsed)) {
+        calc->last_error = std::string("Unknown curve '") + curve + "', expected none, morton or hilbert";
+        return 0;
+    }
+    calc->reordering.configure(parsed, resort_interval);
+    return 1;
+}
+
+int mace_set_result_cache(MACEHandle handle, size_t max_bytes)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    calc->cache.set_capacity(max_bytes);
+    return 1;
+}
+
+int mace_set_memory_budget(MACEHandle handle, size_t max_bytes)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+
+    try {
+        calc->session->attr("set_memory_budget")(max_bytes);
+        return 1;
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_set_domain_decomposition(MACEHandle handle, int num_workers)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+
+    try {
+        calc->session->attr("set_domain_decomposition")(num_workers);
+        return 1;
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_get_cache_stats(MACEHandle handle, MACECacheStats* stats)
+{
+    if (!handle || !stats) return 0;
+
+    const mace_cache::ResultCache& cache = static_cast<MACECalculator*>(handle)->cache;
+    stats->hits = cache.stats().hits;
+    stats->misses = cache.stats().misses;
+    stats->evictions = cache.stats().evictions;
+    stats->entries = static_cast<long long>(cache.size());
+    stats->bytes = cache.bytes();
+    return 1;
+}
+
+void mace_clear_result_cache(MACEHandle handle)
+{
+    if (!handle) return;
+    static_cast<MACECalculator*>(handle)->cache.clear();
+}
+
+int mace_set_force_extrapolation(MACEHandle handle,
+                                 double force_tol,
+                                 double max_displacement,
+                                 int max_skip,
+                                 int order)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+
+    try {
+        calc->session->attr("set_force_extrapolation")(force_tol, max_displacement, max_skip, order);
+        return 1;
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_get_extrapolation_stats(MACEHandle handle, MACEExtrapolationStats* stats)
+{
+    if (!handle || !stats) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+
+    try {
+        py::object py_stats = calc->session->attr("extrapolation_stats");
+        stats->evaluations = py_stats.attr("evaluations").cast<int>();
+        stats->skipped = py_stats.attr("skipped").cast<int>();
+        stats->skip_ratio = py_stats.attr("skip_ratio").cast<double>();
+        stats->checks = py_stats.attr("checks").cast<int>();
+        stats->max_error = py_stats.attr("max_error").cast<double>();
+        stats->rms_error = py_stats.attr("rms_error").cast<double>();
+        return 1;
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+const char* mace_get_active_precision(MACEHandle handle)
+{
+    if (!handle) return "";
+    return static_cast<MACECalculator*>(handle)->active_precision.c_str();
+}
+
+int mace_run_md(MACEHandle handle,
+                MACESystem* system,
+                int n_steps,
+                const MACEMDParams* params,
+                MACEMDCallback callback,
+                int stride,
+                void* user_data)
+{
+    if (!handle) return -1;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (!valid_system(system) || !params || n_steps < 0) {
+        calc->last_error = "Invalid system or MD parameters";
+        return -1;
+    }
+
+    try {
+        const int n = system->num_atoms;
+
+        py::object py_callback = py::none();
+        if (callback) {
+            py_callback = py::cpp_function(
+                [system, callback, user_data, n](int step, py::object positions, py::object velocities,
+                                                 py::object forces, double energy) {
+                    copy_to_system(positions, system->positions, n);
+                    copy_to_system(velocities, system->velocities, n);
+                    copy_to_system(forces, system->forces, n);
+                    system->energy = energy;
+                    return callback(step, system, user_data) != 0;
+                });
+        }
+
+        py::object velocities = system->velocities ? py::object(system_array(system->velocities, n))
+                                                   : py::object(py::none());
+        py::dict out = calc->session->attr("run_md")(
+            system_numbers(system),
+            system_array(system->positions, n),
+            velocities,
+            system_cell(system),
+            system_pbc(system),
+            n_steps,
+            py::arg("integrator") = params->integrator ? params->integrator : "verlet",
+            py::arg("timestep") = params->timestep,
+            py::arg("temperature") = params->temperature,
+            py::arg("friction") = params->friction,
+            py::arg("thermostat_time") = params->thermostat_time,
+            py::arg("callback") = py_callback,
+            py::arg("stride") = stride,
+            py::arg("seed") = params->seed);
+
+        copy_to_system(out["positions"], system->positions, n);
+        copy_to_system(out["velocities"], system->velocities, n);
+        copy_to_system(out["forces"], system->forces, n);
+        system->energy = out["energy"].cast<double>();
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
+        return out["steps"].cast<int>();
+
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return -1;
+    }
+}
+
+int mace_run_respa(MACEHandle handle,
+                   MACESystem* system,
+                   int n_steps,
+                   const MACEMDParams* params,
+                   const MACERESPAParams* respa,
+                   MACEMDCallback callback,
+                   int stride,
+                   void* user_data)
+{
+    if (!handle) return -1;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (!valid_system(system) || !params || !respa || n_steps < 0 || respa->respa_steps <= 0) {
+        calc->last_error = "Invalid system or RESPA parameters";
+        return -1;
+    }
+
+    try {
+        const int n = system->num_atoms;
+
+        py::object py_callback = py::none();
+        if (callback) {
+            py_callback = py::cpp_function(
+                [system, callback, user_data, n](int step, py::object positions, py::object velocities,
+                                                 py::object forces, double energy) {
+                    copy_to_system(positions, system->positions, n);
+                    copy_to_system(velocities, system->velocities, n);
+                    copy_to_system(forces, system->forces, n);
+                    system->energy = energy;
+                    return callback(step, system, user_data) != 0;
+                });
+        }
+
+        py::object velocities = system->velocities ? py::object(system_array(system->velocities, n))
+                                                   : py::object(py::none());
+        py::object inner = respa->inner ? *static_cast<MACECalculator*>(respa->inner)->session
+                                        : py::object(py::none());
+        py::dict out = calc->session->attr("run_respa")(
+            system_numbers(system),
+            system_array(system->positions, n),
+            velocities,
+            system_cell(system),
+            system_pbc(system),
+            n_steps,
+            py::arg("integrator") = params->integrator ? params->integrator : "verlet",
+            py::arg("timestep") = params->timestep,
+            py::arg("temperature") = params->temperature,
+            py::arg("friction") = params->friction,
+            py::arg("respa_steps") = respa->respa_steps,
+            py::arg("inner") = inner,
+            py::arg("inner_cutoff") = respa->inner_cutoff,
+            py::arg("fit_frames") = respa->fit_frames,
+            py::arg("callback") = py_callback,
+            py::arg("stride") = stride,
+            py::arg("seed") = params->seed);
+
+        copy_to_system(out["positions"], system->positions, n);
+        copy_to_system(out["velocities"], system->velocities, n);
+        copy_to_system(out["forces"], system->forces, n);
+        system->energy = out["energy"].cast<double>();
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
+        return out["steps"].cast<int>();
+
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return -1;
+    }
+}
+
+int mace_relax(MACEHandle handle,
+               MACESystem* system,
+               const char* method,
+               double fmax,
+               int max_steps,
+               int relax_cell,
+               int* converged)
+{
+    if (!handle) return -1;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (!valid_system(system) || fmax <= 0.0 || max_steps < 0) {
+        calc->last_error = "Invalid system or relaxation parameters";
+        return -1;
+    }
+
+    try {
+        const int n = system->num_atoms;
+        py::dict out = calc->session->attr("relax")(
+            system_numbers(system),
+            system_array(system->positions, n),
+            system_cell(system),
+            system_pbc(system),
+            py::arg("method") = method ? method : "fire",
+            py::arg("fmax") = fmax,
+            py::arg("max_steps") = max_steps,
+            py::arg("relax_cell") = py::bool_(relax_cell));
+
+        copy_to_system(out["positions"], system->positions, n);
+        copy_to_system(out["forces"], system->forces, n);
+        // Non-periodic systems are relaxed without a cell; keep the caller's
+        if (relax_cell || system->pbc[0] || system->pbc[1] || system->pbc[2]) {
+            native_array<double> cell = out["cell"].cast<native_array<double>>();
+            std::memcpy(system->cell, cell.data(), sizeof(system->cell));
+        }
+        system->energy = out["energy"].cast<double>();
+        if (converged) *converged = out["converged"].cast<bool>() ? 1 : 0;
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
+        return out["steps"].cast<int>();
+
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return -1;
+    }
+}
+
+int mace_register_system(MACEHandle handle,
+                         const MACESystem* system,
+                         const int* frozen,
+                         int skip_frozen_forces)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (!valid_system(system) || !frozen) {
+        calc->last_error = "Invalid system or frozen mask";
+        return 0;
+    }
+
+    try {
+        py::list py_frozen;
+        for (int i = 0; i < system->num_atoms; ++i) py_frozen.append(py::bool_(frozen[i]));
+        calc->session->attr("register_system")(
+            system_numbers(system),
+            system_array(system->positions, system->num_atoms),
+            system_cell(system),
+            system_pbc(system),
+            py_frozen,
+            py::bool_(skip_frozen_forces));
+        calc->registered_atoms = system->num_atoms;
+        return 1;
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+void mace_calculate_registered(MACEHandle handle,
+                               const double* positions,
+                               MACEResult* result)
+{
+    if (!handle || !result || !positions) {
+        if (result) {
+            result->success = 0;
+            strncpy(result->error_msg, "Invalid handle", sizeof(result->error_msg) - 1);
+        }
+        return;
+    }
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    const int n = calc->registered_atoms;
+    if (n <= 0) {
+        result->success = 0;
+        strncpy(result->error_msg, "No system registered", sizeof(result->error_msg) - 1);
+        return;
+    }
+
+    try {
+        py::dict py_result = calc->session->attr("compute_registered")(system_array(positions, n));
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
+
+        result->energy = py_result["energy"].cast<double>();
+        result->num_atoms = n;
+        result->forces = new double[n * 3];
+        copy_to_system(py_result["forces"], result->forces, n);
+        result->success = 1;
+        result->error_msg[0] = '\0';
+
+    } catch (const std::exception& e) {
+        result->success = 0;
+        strncpy(result->error_msg, e.what(), sizeof(result->error_msg) - 1);
+    }
+}
+
+int mace_neb(MACEHandle handle,
+             MACESystem* images,
+             int n_images,
+             const MACENEBOptions* options,
+             double* barrier,
+             int* converged)
+{
+    if (!handle) return -1;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (!images || n_images < 3 || !options) {
+        calc->last_error = "NEB needs at least 3 images and options";
+        return -1;
+    }
+    const int n = images[0].num_atoms;
+    for (int i = 0; i < n_images; ++i) {
+        if (!valid_system(&images[i]) || images[i].num_atoms != n) {
+            calc->last_error = "NEB images must be valid systems with the same atoms";
+            return -1;
+        }
+    }
+
+    try {
+        const size_t dim = 3 * static_cast<size_t>(n);
+        std::vector<double> positions(n_images * dim), energies, forces;
+        for (int i = 0; i < n_images; ++i)
+            std::memcpy(positions.data() + i * dim, images[i].positions, sizeof(double) * dim);
+
+        py::list numbers = system_numbers(&images[0]);
+        py::object cell = system_cell(&images[0]);
+        py::list pbc = system_pbc(&images[0]);
+        py::object compute_batch = calc->session->attr("compute_batch");
+
+        /* All requested images go through the model as one batched graph */
+        mace_band::Evaluator evaluate = [&](int, int count, const double* r, double* e, double* f) {
+            py::list batch;
+            for (int k = 0; k < count; ++k) batch.append(system_array(r + k * dim, n));
+            py::tuple out = compute_batch(numbers, batch, cell, pbc);
+            native_array<double> py_energies = out[0].cast<native_array<double>>();
+            native_array<double> py_forces = out[1].cast<native_array<double>>();
+            if (py_energies.size() != count || py_forces.size() != static_cast<py::ssize_t>(count * dim)) {
+                throw std::runtime_error("unexpected array size from Python");
+            }
+            std::memcpy(e, py_energies.data(), sizeof(double) * count);
+            std::memcpy(f, py_forces.data(), sizeof(double) * count * dim);
+        };
+
+        mace_band::Options opts;
+        opts.spring = options->spring > 0 ? options->spring : opts.spring;
+        opts.climb = options->climb != 0;
+        opts.fmax = options->fmax > 0 ? options->fmax : opts.fmax;
+        opts.max_steps = options->max_steps > 0 ? options->max_steps : opts.max_steps;
+        opts.max_step = options->max_step > 0 ? options->max_step : opts.max_step;
+
+        mace_band::Result result = mace_band::run(n, n_images, positions, energies, forces, opts, evaluate);
+
+        for (int i = 0; i < n_images; ++i) {
+            std::memcpy(images[i].positions, positions.data() + i * dim, sizeof(double) * dim);
+            if (images[i].forces) std::memcpy(images[i].forces, forces.data() + i * dim, sizeof(double) * dim);
+            images[i].energy = energies[i];
+        }
+        if (barrier) *barrier = result.barrier;
+        if (converged) *converged = result.converged ? 1 : 0;
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
+        return result.steps;
+
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return -1;
+    }
+}
+
+int mace_phonon_force_constants(MACEHandle handle,
+                                const MACESystem* supercell,
+                                const MACEPhononOptions* options,
+                                double* force_constants,
+                                int* num_displacements)
+{
+    if (!handle) return 0;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (!valid_system(supercell) || !force_constants) {
+        calc->last_error = "Invalid supercell or output buffer";
+        return 0;
+    }
+    if (!supercell->pbc[0] || !supercell->pbc[1] || !supercell->pbc[2]) {
+        calc->last_error = "Phonon supercells must be periodic in all directions";
+        return 0;
+    }
+
+    MACEPhononOptions defaults = {};
+    if (!options) options = &defaults;
+
+    try {
+        py::tuple out = calc->session->attr("force_constants")(
+            system_numbers(supercell), system_array(supercell->positions, supercell->num_atoms),
+            system_cell(supercell),
+            options->displacement > 0 ? options->displacement : 0.01,
+            options->symprec > 0 ? options->symprec : 1e-5,
+            options->max_batch_atoms > 0 ? options->max_batch_atoms : 20000);
+
+        const size_t n3 = 3 * static_cast<size_t>(supercell->num_atoms);
+        native_array<double> matrix = out[0].cast<native_array<double>>();
+        if (static_cast<size_t>(matrix.size()) != n3 * n3) {
+            throw std::runtime_error("unexpected array size from Python");
+        }
+        std::memcpy(force_constants, matrix.data(), sizeof(double) * n3 * n3);
+        if (num_displacements) *num_displacements = out[1].cast<int>();
+        calc->active_precision = calc->session->attr("active").cast<std::string>();
+        return 1;
+
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return 0;
+    }
+}
+
+MACEMCHandle mace_mc_create(MACEHandle handle, const MACESystem* system)
+{
+    if (!handle) return nullptr;
+
+    MACECalculator* calc = static_cast<MACECalculator*>(handle);
+    if (!valid_system(system)) {
+        calc->last_error = "Invalid system";
+        return nullptr;
+    }
+
+    try {
+        py::object state = calc->session->attr("monte_carlo")(
+            system_numbers(system),
+            system_array(system->positions, system->num_atoms),
+            system_cell(system),
+            system_pbc(system));
+        return static_cast<MACEMCHandle>(new MACEMCState{calc, new py::object(state)});
+    } catch (const std::exception& e) {
+        calc->last_error = e.what();
+        return nullptr;
+    }
+}
+
+int mace_mc_propose(MACEMCHandle mc,
+                    int num_moved,
+                    const int* indices,
+                    const double* new_positions,
+                    const int* new_numbers,
+                    double* energy)
+{
+    if (!mc) return 0;
+
+    MACEMCState* mcs = static_cast<MACEMCState*>(mc);
+    if (num_moved <= 0 || !indices || (!new_positions && !new_numbers)) {
+        mcs->calc->last_error = "Invalid Monte Carlo move";
+        return 0;
+    }
+
+    try {
+        py::list py_indices, py_numbers;
+        for (int i = 0; i < num_moved; ++i) {
+            py_indices.append(indices[i]);
+            if (new_numbers) py_numbers.append(new_numbers[i]);
+        }
+        py::object py_positions = new_positions ? py::object(system_array(new_positions, num_moved))
+                                                : py::object(py::none());
+        double e = mcs->state->attr("propose")(
+            py_indices, py_positions,
+            new_numbers ? py::object(py_numbers) : py::object(py::none())).cast<double>();
+        if (energy) *energy = e;
+        return 1;
+    } catch (const std::exception& e) {
+        mcs->calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_mc_evaluate_trials(MACEMCHandle mc,
+                            int num_trials,
+                            const int* moved_counts,
+                            const int* indices,
+                            const double* new_positions,
+                            const int* new_numbers,
+                            double* delta_energies)
+{
+    if (!mc) return 0;
+
+    MACEMCState* mcs = static_cast<MACEMCState*>(mc);
+    if (num_trials <= 0 || !indices || !delta_energies || (!new_positions && !new_numbers)) {
+        mcs->calc->last_error = "Invalid Monte Carlo trials";
+        return 0;
+    }
+
+    try {
+        py::list trials;
+        int offset = 0;
+        for (int k = 0; k < num_trials; ++k) {
+            int count = moved_counts ? moved_counts[k] : 1;
+            if (count <= 0) {
+                mcs->calc->last_error = "Invalid Monte Carlo trials";
+                return 0;
+            }
+            py::list py_indices, py_numbers;
+            for (int i = offset; i < offset + count; ++i) {
+                py_indices.append(indices[i]);
+                if (new_numbers) py_numbers.append(new_numbers[i]);
+            }
+            py::object py_positions = new_positions
+                ? py::object(system_array(new_positions + 3 * offset, count))
+                : py::object(py::none());
+            trials.append(py::make_tuple(
+                py_indices, py_positions,
+                new_numbers ? py::object(py_numbers) : py::object(py::none())));
+            offset += count;
+        }
+        native_array<double> deltas = mcs->state->attr("evaluate_trials")(trials).cast<native_array<double>>();
+        if (deltas.size() != num_trials) {
+            throw std::runtime_error("unexpected array size from Python");
+        }
+        std::memcpy(delta_energies, deltas.data(), sizeof(double) * num_trials);
+        return 1;
+    } catch (const std::exception& e) {
+        mcs->calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_mc_accept(MACEMCHandle mc)
+{
+    if (!mc) return 0;
+
+    MACEMCState* mcs = static_cast<MACEMCState*>(mc);
+
+    try {
+        mcs->state->attr("accept")();
+        return 1;
+    } catch (const std::exception& e) {
+        mcs->calc->last_error = e.what();
+        return 0;
+    }
+}
+
+int mace_mc_reject(MACEMCHandle mc)
+{
+    if (!mc) return 0;
+
+    MACEMCState* mcs = static_cast<MACEMCState*>(mc);
+
+    try {
+        mcs->state->attr("reject")();
+        return 1;
+    } catch (const std::exception& e) {
+        mcs->calc->last_error = e.what();
+        return 0;
+    }
+}
+
+double mace_mc_energy(MACEMCHandle mc)
+{
+    if (!mc) return 0.0;
+
+    MACEMCState* mcs = static_cast<MACEMCState*>(mc);
+
+    try {
+        return mcs->state->attr("energy").cast<double>();
+    } catch (const std::exception& e) {
+        mcs->calc->last_error = e.what();
+        return 0.0;
+    }
+}
+
+void mace_mc_destroy(MACEMCHandle mc)
+{
+    if (!mc) return;
+
+    MACEMCState* mcs = static_cast<MACEMCState*>(mc);
+    delete mcs->state;
+    delete mcs;
+}
+
 }
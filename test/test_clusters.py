@@ -0,0 +1,597 @@
+"""Library evaluations against reference evaluations on a toy potential
+
+The library evaluates local changes and large systems on non-periodic
+clusters sized from the receptive field R = num_interactions * r_max.
+These checks swap the MACE model for a small torch model with the same
+interface whose node energies reach exactly R (two message-passing steps
+of a pair function vanishing at r_max), so a cluster that is too small
+shows up as a mismatch against one evaluation of the whole system:
+  1. MCState trial energies (cluster of 2R around moved atoms, core R),
+  2. FrozenRegion energies and forces (cluster of 2R + skin around mobile
+     atoms, core R + skin/2) over steps with and without a rebuild,
+  3. ChunkedEvaluation energy and forces (blocks with an R halo), serial
+     and on two workers,
+  4. subset_forces (cluster of 2R around the subset, core R),
+for periodic, slab and isolated structures, and
+  5. per-atom energies and virials summing to the energy and to the total
+     virial (-stress * volume when periodic) for periodic and isolated
+     structures,
+  6. the Hessian against central differences of the forces, its products
+     with unit and random vectors, and batched rows against the fallback,
+  7. force_constants, displacing symmetry-irreducible atoms along
+     directions unrelated by site symmetry, against central differences of
+     every atom in fcc, tetragonal and rocksalt cells.
+Further checks compare reduced-precision modes with float64:
+  8. bfloat16 energy and forces within the documented 1% and 3% of float64,
+  9. float32 positions reach a float32 model unconverted and its energy and
+     forces agree with float64 to float32 accuracy.
+Drivers run on the toy model too:
+  10. relax (FIRE, L-BFGS and FIRE with force extrapolation) reaches
+      fmax in model forces,
+  11. force extrapolation along a smooth trajectory: predictions within
+      their error estimate, and a model call once the estimate exceeds
+      the tolerance,
+  12. the RESPA pair potential: forces against central differences of its
+      energy and, when the library's native module is loaded, the native
+      kernel against the numpy fallback,
+  13. RESPA with one inner step against velocity Verlet.
+Run with `make test-clusters`.
+"""
+import os
+import sys
+import types
+import warnings
+
+import numpy as np
+import torch
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "python"))
+
+import mace_calculator as mc
+
+ATOMIC_NUMBERS = [1, 6, 8]
+R_MAX = 2.0
+DENSITY = 0.1   # atoms per A^3, a few neighbors within R_MAX
+
+
+class ToyInteraction(torch.nn.Module):
+    """Sums neighbor features weighted by (1 - r/r_max)^3"""
+
+    def forward(self, features, pair, sender, receiver):
+        return torch.zeros_like(features).index_add(0, receiver, pair[:, None] * features[sender])
+
+
+class ToyProduct(torch.nn.Module):
+    """Mixes message channels through a dense layer"""
+
+    def __init__(self, weights):
+        super().__init__()
+        self.weights = torch.nn.Parameter(weights)
+
+    def forward(self, messages):
+        return torch.tanh(messages @ self.weights)
+
+
+class ToyModel(torch.nn.Module):
+    """Two message-passing steps of (1 - r/r_max)^3; takes and returns the
+    MACE model's input and output dicts. The interaction and product blocks
+    sit where MACE's do, so reduced-precision modes wrap them the same way"""
+
+    def __init__(self, num_elements, r_max, dtype=torch.float64, channels=4):
+        super().__init__()
+        rng = np.random.default_rng(1)
+
+        def weights(*shape, scale=1.0):
+            return torch.tensor(scale * rng.normal(size=shape), dtype=dtype)
+
+        self.r_max = r_max
+        self.embedding = torch.nn.Parameter(weights(num_elements, channels))
+        self.interactions = torch.nn.ModuleList([ToyInteraction(), ToyInteraction()])
+        self.products = torch.nn.ModuleList([ToyProduct(weights(channels, channels, scale=3.0))
+                                             for _ in range(2)])
+        self.readout = torch.nn.Parameter(weights(channels))
+
+    def forward(self, data, training=False, compute_force=True, compute_stress=False, **kwargs):
+        positions, shifts = data["positions"], data["shifts"]
+        if compute_force:
+            positions.requires_grad_(True)
+        if compute_stress:
+            # Symmetric strain applied to positions and cell, as in MACE
+            displacement = torch.zeros(3, 3, dtype=positions.dtype, device=positions.device)
+            displacement.requires_grad_(True)
+            strain = 0.5 * (displacement + displacement.T)
+            positions = positions + positions @ strain
+            shifts = shifts + shifts @ strain
+        sender, receiver = data["edge_index"]
+        vectors = positions[receiver] - positions[sender] + shifts
+        lengths = torch.linalg.norm(vectors, dim=1)
+        pair = torch.clamp(1.0 - lengths / self.r_max, min=0.0) ** 3
+
+        # A repulsive core keeps relaxations and MD from collapsing atoms
+        features = data["node_attrs"] @ self.embedding
+        node_energy = torch.zeros(len(features), dtype=features.dtype, device=features.device).index_add(
+            0, receiver, 0.1 * pair * self.r_max / lengths)
+        for interaction, product in zip(self.interactions, self.products):
+            features = product(interaction(features, pair, sender, receiver))
+            node_energy = node_energy + features @ self.readout
+
+        num_graphs = len(data["ptr"]) - 1
+        energy = torch.zeros(num_graphs, dtype=node_energy.dtype,
+                             device=node_energy.device).index_add(0, data["batch"], node_energy)
+        out = {"node_energy": node_energy, "energy": energy, "forces": None, "stress": None}
+        if compute_force:
+            inputs = [data["positions"], displacement] if compute_stress else [data["positions"]]
+            grads = torch.autograd.grad(energy.sum(), inputs, create_graph=training)
+            out["forces"] = -grads[0]
+            if compute_stress:
+                volume = abs(np.linalg.det(data["cell"].detach().cpu().double().numpy()))
+                out["stress"] = (grads[1] / volume).reshape(1, 3, 3)
+        return out
+
+
+def toy_session(precision="float64", full_evaluations=False):
+    """MACESession whose calculator runs ToyModel, built by create_calculator
+    so precision modes are applied as for a MACE model. Without
+    full_evaluations compute_array raises, so a cluster path cannot quietly
+    fall back to evaluating the whole system"""
+    def toy_mace_mp(model=None, device="cpu", default_dtype="float64", enable_cueq=False):
+        dtype = torch.float64 if default_dtype == "float64" else torch.float32
+        return types.SimpleNamespace(
+            models=[ToyModel(len(ATOMIC_NUMBERS), R_MAX, dtype)],
+            r_max=R_MAX,
+            z_table=types.SimpleNamespace(zs=ATOMIC_NUMBERS),
+            results={},
+            atoms=None,
+        )
+
+    mace_mp = mc.mace_mp
+    mc.mace_mp = toy_mace_mp
+    try:
+        session = mc.MACESession(device="cpu", enable_cueq=False, precision=precision)
+    finally:
+        mc.mace_mp = mace_mp
+
+    if not full_evaluations:
+        def no_full_evaluation(*args, **kwargs):
+            raise AssertionError("cluster path fell back to a full evaluation")
+
+        session.compute_array = no_full_evaluation
+    return session
+
+
+def random_structure(rng, kind, length):
+    """Random numbers, positions, cell and pbc of a periodic (triclinic),
+    slab (periodic in x and y) or isolated structure"""
+    cell = np.array([[length, 0.0, 0.0], [0.1 * length, length, 0.0], [0.05 * length, 0.1 * length, length]])
+    pbc = {"periodic": [True] * 3, "slab": [True, True, False], "isolated": [False] * 3}[kind]
+    n = int(DENSITY * abs(np.linalg.det(cell)))
+    positions = rng.random((n, 3)) @ cell
+    if kind == "slab":
+        cell[2] = 0.0
+    elif kind == "isolated":
+        cell[:] = 0.0
+    numbers = rng.choice(ATOMIC_NUMBERS, n)
+    return numbers, positions, cell, pbc
+
+
+def full_energy(session, numbers, positions, cell, pbc):
+    return float(mc.ResidentSystem(session, numbers, positions, cell, pbc, skin=0.0).node_energies().sum())
+
+
+def full_energy_forces(session, numbers, positions, cell, pbc):
+    energy, forces, _ = mc.ResidentSystem(session, numbers, positions, cell, pbc, skin=0.0).compute()
+    return energy, forces
+
+
+def check_mc_state(session, rng, kind):
+    """Trial energy differences and accepted moves against full energies"""
+    numbers, positions, cell, pbc = random_structure(rng, kind, 24.0)
+    state = mc.MCState(session, numbers, positions, cell, pbc)
+    error = abs(state.energy - full_energy(session, numbers, positions, cell, pbc))
+
+    trials = []
+    for i in rng.choice(len(numbers), 4, replace=False):
+        trials.append(([int(i)], None, [int(rng.choice(ATOMIC_NUMBERS))]))
+        trials.append(([int(i)], positions[[i]] + rng.normal(0.0, 0.7, 3), None))
+    trials.append((rng.choice(len(numbers), 2, replace=False), None, rng.choice(ATOMIC_NUMBERS, 2)))
+    deltas = state.evaluate_trials(trials, max_batch_atoms=2000)
+    reference = full_energy(session, numbers, positions, cell, pbc)
+    for (indices, trial_positions, trial_numbers), delta in zip(trials, deltas):
+        new_numbers, new_positions = numbers.copy(), positions.copy()
+        if trial_numbers is not None:
+            new_numbers[indices] = trial_numbers
+        if trial_positions is not None:
+            new_positions[indices] = trial_positions
+        expected = full_energy(session, new_numbers, new_positions, cell, pbc) - reference
+        error = max(error, abs(delta - expected))
+
+    # A few accepted moves; the cached energy follows the configuration
+    for i in rng.choice(len(numbers), 3, replace=False):
+        moved = state.positions[i] + rng.normal(0.0, 0.5, 3)
+        state.propose([int(i)], positions=[moved])
+        state.accept()
+    expected = full_energy(session, state.numbers, state.positions, cell, pbc)
+    error = max(error, abs(state.energy - expected))
+
+    largest = max(state.cluster_sizes)
+    print(f"MCState ({kind}): {len(numbers)} atoms, largest cluster {largest}, max |dE| {error:.2e} eV")
+    return error > 1e-9 or largest >= len(numbers)
+
+
+def check_frozen_region(session, rng, kind):
+    """Energy and forces of a few steps of the mobile atoms against full
+    evaluations; steps within skin/2 reuse the cluster, the last one does not"""
+    numbers, positions, cell, pbc = random_structure(rng, kind, 24.0)
+    center = positions.mean(axis=0)
+    frozen = np.linalg.norm(positions - center, axis=1) > 3.0
+    mobile = np.flatnonzero(~frozen)
+    error = 0.0
+    for skip_frozen_forces in (False, True):
+        region = mc.FrozenRegion(session, numbers, positions, cell, pbc, frozen,
+                                 skip_frozen_forces=skip_frozen_forces, skin=1.0)
+        current = positions.copy()
+        for step in (0.0, 0.15, 0.15, 0.6):
+            current[mobile] += rng.normal(0.0, step / np.sqrt(3.0), (len(mobile), 3))
+            # Frozen entries are ignored
+            trial = current + np.where(frozen[:, None], 1.0, 0.0)
+            energy, forces = region.compute(trial)
+            expected_energy, expected_forces = full_energy_forces(session, numbers, current, cell, pbc)
+            if skip_frozen_forces:
+                expected_forces[frozen] = 0.0
+            error = max(error, abs(energy - expected_energy), np.abs(forces - expected_forces).max())
+
+    size = region.cluster_size
+    print(f"FrozenRegion ({kind}): {len(numbers)} atoms, {len(mobile)} mobile, cluster {size}, "
+          f"{region.rebuilds} rebuilds, max error {error:.2e}")
+    return error > 1e-9 or size is None or size >= len(numbers) or region.rebuilds < 2
+
+
+def check_chunked(session, rng, kind):
+    """Blocked energy and forces against one evaluation of the whole system"""
+    numbers, positions, cell, pbc = random_structure(rng, kind, 32.0)
+    calculator = session.resident_calculator()
+    neighbors = DENSITY * 4.0 / 3.0 * np.pi * R_MAX ** 3
+    budget = 0.4 * len(numbers) * mc.graph_bytes_per_atom(calculator, neighbors)
+    expected_energy, expected_forces = full_energy_forces(session, numbers, positions, cell, pbc)
+
+    failed = False
+    for workers in (1, 2):
+        chunked = mc.ChunkedEvaluation(session, calculator, numbers, positions, cell, pbc,
+                                       max_bytes=budget, workers=workers)
+        energy, forces = chunked.compute()
+        error = max(abs(energy - expected_energy), np.abs(forces - expected_forces).max())
+        print(f"ChunkedEvaluation ({kind}, {workers} worker{'s' if workers > 1 else ''}): "
+              f"{len(numbers)} atoms, {chunked.num_blocks} blocks, max error {error:.2e}")
+        failed |= error > 1e-9 or chunked.num_blocks < 2
+    return failed
+
+
+def check_subset_forces(session, rng, kind):
+    """Forces on a few neighboring atoms and one far away against the
+    forces of one evaluation of the whole system"""
+    numbers, positions, cell, pbc = random_structure(rng, kind, 24.0)
+    center = rng.integers(len(numbers))
+    nearest = np.argsort(np.linalg.norm(positions - positions[center], axis=1))[:3]
+    subset = np.append(nearest, rng.integers(len(numbers)))
+
+    forces = session.compute_subset(positions, numbers, cell, pbc, subset)
+    _, expected = full_energy_forces(session, numbers, positions, cell, pbc)
+    error = np.abs(forces - expected[subset]).max()
+    print(f"subset_forces ({kind}): {len(numbers)} atoms, {len(subset)} in the subset, "
+          f"max |dF| {error:.2e} eV/A")
+    return error > 1e-9
+
+
+def check_atomic(session, rng, kind):
+    """Per-atom energies sum to the energy and per-atom virials to the total
+    virial: -stress * volume of a periodic evaluation, or sum_i r_i (x) F_i
+    for an isolated structure"""
+    numbers, positions, cell, pbc = random_structure(rng, kind, 12.0)
+    energy, forces, atom_energies, atom_virials = session.compute_atomic(
+        positions, numbers, cell, pbc, virials=True)
+    expected_energy, expected_forces, stress = mc.ResidentSystem(
+        session, numbers, positions, cell, pbc, skin=0.0).compute(compute_stress=kind == "periodic")
+    if kind == "periodic":
+        from ase.stress import voigt_6_to_full_3x3_stress
+        virial = -voigt_6_to_full_3x3_stress(stress) * abs(np.linalg.det(cell))
+    else:
+        virial = positions.T @ expected_forces
+
+    error = max(abs(energy - expected_energy), abs(atom_energies.sum() - expected_energy),
+                np.abs(forces - expected_forces).max())
+    virial_error = np.abs(atom_virials.sum(axis=0) - virial).max() / np.abs(virial).max()
+    print(f"per-atom energies and virials ({kind}): {len(numbers)} atoms, max error {error:.2e}, "
+          f"relative virial sum error {virial_error:.2e}")
+    return error > 1e-9 or virial_error > 1e-9
+
+
+def check_hessian(session, rng, h=1e-4):
+    """Hessian against central differences of the forces, against products
+    with every unit vector (H v, so the unsymmetrized rows must already be
+    symmetric) and random vectors, and the batched rows against the
+    row-by-row fallback"""
+    numbers, positions, cell, pbc = random_structure(rng, "periodic", 7.0)
+    n3 = 3 * len(numbers)
+    grad = torch.autograd.grad
+    batched = []
+
+    def record_batched(*args, **kwargs):
+        batched.append(kwargs.get("is_grads_batched", False))
+        return grad(*args, **kwargs)
+
+    def unbatchable(*args, **kwargs):
+        if kwargs.get("is_grads_batched", False):
+            raise RuntimeError("batched gradients unsupported")
+        return grad(*args, **kwargs)
+
+    try:
+        torch.autograd.grad = record_batched
+        forces, hessian = session.hessian(positions, numbers, cell, pbc)
+        torch.autograd.grad = unbatchable
+        _, fallback = session.hessian(positions, numbers, cell, pbc)
+    finally:
+        torch.autograd.grad = grad
+
+    reference = np.zeros((n3, n3))
+    for k in range(n3):
+        displaced = positions.copy().reshape(-1)
+        displaced[k] += h
+        _, plus = full_energy_forces(session, numbers, displaced.reshape(-1, 3), cell, pbc)
+        displaced[k] -= 2 * h
+        _, minus = full_energy_forces(session, numbers, displaced.reshape(-1, 3), cell, pbc)
+        reference[:, k] = -(plus - minus).reshape(-1) / (2 * h)
+
+    vectors = np.vstack([np.eye(n3), rng.normal(size=(4, n3))]).reshape(-1, len(numbers), 3)
+    _, products = session.hessian_vector_product(positions, numbers, cell, pbc, vectors)
+    products = products.reshape(-1, n3)
+    columns = products[:n3]
+
+    scale = np.abs(hessian).max()
+    fd_error = np.abs(hessian - reference).max() / scale
+    symmetry_error = np.abs(columns - columns.T).max() / scale
+    product_error = np.abs(products - vectors.reshape(-1, n3) @ hessian).max() / scale
+    fallback_error = np.abs(fallback - hessian).max() / scale
+    _, expected_forces = full_energy_forces(session, numbers, positions, cell, pbc)
+    force_error = np.abs(forces - expected_forces).max()
+    print(f"hessian: {len(numbers)} atoms, relative errors: central differences {fd_error:.2e}, "
+          f"asymmetry {symmetry_error:.2e}, H v {product_error:.2e}, row fallback {fallback_error:.2e}")
+    return (fd_error > 1e-5 or symmetry_error > 1e-12 or product_error > 1e-12 or fallback_error > 1e-12
+            or force_error > 1e-12 or not any(batched))
+
+
+def crystal(kind):
+    """Numbers, positions and cell of a 2x2x2 conventional fcc supercell (also
+    strained to tetragonal) or a conventional rocksalt cell"""
+    fcc = np.array([[0.0, 0.0, 0.0], [0.0, 0.5, 0.5], [0.5, 0.0, 0.5], [0.5, 0.5, 0.0]])
+    if kind == "rocksalt":
+        frac = np.vstack([fcc, fcc + 0.5]) % 1.0
+        numbers = np.array([8] * 4 + [1] * 4)
+        cell = np.diag([3.2] * 3)
+    else:
+        frac = np.vstack([(fcc + shift) / 2.0 for shift in np.ndindex(2, 2, 2)])
+        numbers = np.full(len(frac), 6)
+        cell = np.diag([5.0, 5.0, 5.5 if kind == "tetragonal" else 5.0])
+    return numbers, frac @ cell, cell
+
+
+def check_force_constants(session, kind, h=0.01):
+    """Symmetry-reduced force constants against central differences of the
+    forces for every atom and direction"""
+    numbers, positions, cell = crystal(kind)
+    n = len(numbers)
+    fc, num_displacements = mc.force_constants(session, numbers, positions, cell, displacement=h)
+
+    reference = np.zeros((3 * n, 3 * n))
+    for i in range(n):
+        for a in range(3):
+            displaced = positions.copy()
+            displaced[i, a] += h
+            _, plus = full_energy_forces(session, numbers, displaced, cell, [True] * 3)
+            displaced[i, a] -= 2 * h
+            _, minus = full_energy_forces(session, numbers, displaced, cell, [True] * 3)
+            reference[3 * i + a] = -(plus - minus).reshape(-1) / (2 * h)
+    reference = 0.5 * (reference + reference.T)
+
+    try:
+        import spglib  # noqa: F401
+        expected = {"fcc": 1, "tetragonal": 2, "rocksalt": 2}[kind]   # as phonopy
+    except ImportError:
+        expected = 6 * n    # no symmetry: every atom along +-x, +-y and +-z
+
+    error = np.abs(fc - reference).max()
+    print(f"force_constants ({kind}): {n} atoms, {num_displacements} displaced supercells "
+          f"(expected {expected}), max error {error:.2e} eV/A^2")
+    return error > 1e-8 or num_displacements != expected
+
+
+def check_bfloat16(rng, energy_tol=1e-2, force_tol=3e-2):
+    """bf16 interaction and product blocks against float64; the energy error
+    relative to the energy, force errors relative to the largest force"""
+    with warnings.catch_warnings():
+        warnings.simplefilter("ignore", RuntimeWarning)     # emulated without AMX
+        session = toy_session("bfloat16")
+    model = session.resident_calculator().models[0]
+    wrapped = all(isinstance(block, mc.BFloat16Block) for block in list(model.interactions) + list(model.products))
+
+    numbers, positions, cell, pbc = random_structure(rng, "periodic", 12.0)
+    energy, forces = full_energy_forces(session, numbers, positions, cell, pbc)
+    expected_energy, expected_forces = full_energy_forces(toy_session(), numbers, positions, cell, pbc)
+    energy_error = abs(energy - expected_energy) / abs(expected_energy)
+    force_error = np.abs(forces - expected_forces).max() / np.abs(expected_forces).max()
+    print(f"bfloat16: {len(numbers)} atoms, relative |dE| {energy_error:.2e}, relative max |dF| {force_error:.2e}")
+    return not wrapped or energy_error > energy_tol or force_error > force_tol or force_error == 0.0
+
+
+def check_float32(rng, energy_tol=1e-6, force_tol=1e-5):
+    """float32 model on float32 positions against float64, the energy error
+    per atom in eV and force errors relative to the largest force; the
+    positions must reach the model as float32 and the forces come back in
+    float32"""
+    session = toy_session("float32", full_evaluations=True)
+    model = session.resident_calculator().models[0]
+    seen = []
+
+    def forward(data, *args, **kwargs):
+        seen.append(data["positions"].dtype)
+        return type(model).forward(model, data, *args, **kwargs)
+
+    numbers, positions, cell, pbc = random_structure(rng, "periodic", 12.0)
+    model.forward = forward
+    try:
+        # As mace_calculate_periodic_f32 calls it
+        energy, forces = session.compute_array(positions.astype(np.float32), numbers, cell.astype(np.float32),
+                                               pbc, np.float32)
+    finally:
+        del model.forward
+    expected_energy, expected_forces = full_energy_forces(toy_session(), numbers, positions, cell, pbc)
+    energy_error = abs(energy - expected_energy) / len(numbers)
+    force_error = np.abs(forces - expected_forces).max() / np.abs(expected_forces).max()
+    print(f"float32: {len(numbers)} atoms, model positions {', '.join(map(str, seen))}, forces {forces.dtype}, "
+          f"|dE|/atom {energy_error:.2e} eV, relative max |dF| {force_error:.2e}")
+    return (seen != [torch.float32] or forces.dtype != np.float32
+            or energy_error > energy_tol or force_error > force_tol)
+
+
+def check_relax(session, rng, fmax=0.01):
+    """Relax an isolated cluster and confirm the largest model force at the
+    result is below fmax, with extrapolated forces in FIRE too"""
+    numbers, positions, cell, pbc = random_structure(rng, "isolated", 7.0)
+    failed = False
+    for method, extrapolate in (("fire", False), ("lbfgs", False), ("fire", True)):
+        session.set_force_extrapolation(0.5 * fmax if extrapolate else 0.0, max_skip=5)
+        result = session.relax(numbers, positions, cell, pbc, method=method, fmax=fmax, max_steps=1000)
+        _, forces = full_energy_forces(session, numbers, result["positions"], cell, pbc)
+        largest = np.linalg.norm(forces, axis=1).max()
+        skipped = session.extrapolation_stats.skipped
+        print(f"relax ({method}{' with extrapolation' if extrapolate else ''}): {len(numbers)} atoms, "
+              f"{result['steps']} steps, {skipped} extrapolated, max |F| {largest:.2e} eV/A")
+        failed |= not result["converged"] or largest > fmax or (extrapolate and skipped == 0)
+    session.set_force_extrapolation(0.0)
+    return failed
+
+
+def check_force_extrapolator(session, rng, force_tol=0.01, n_steps=80):
+    """Extrapolator on a smooth trajectory: predicted forces within the
+    estimated error of the model forces, and a model call exactly when the
+    estimate exceeds force_tol (the displacement and skip limits are off)"""
+    numbers, positions, cell, pbc = random_structure(rng, "isolated", 7.0)
+    velocity = rng.normal(0.0, 0.001, positions.shape)
+    acceleration = rng.normal(0.0, 1e-5, positions.shape)
+    system = mc.ResidentSystem(session, numbers, positions, cell, pbc)
+    extrapolator = mc.ForceExtrapolator(force_tol, max_displacement=np.inf, max_skip=n_steps)
+
+    failed, worst, forced = False, 0.0, 0
+    for step in range(n_steps):
+        system.update(positions + step * velocity + step ** 2 * acceleration)
+        estimate = None
+        if len(extrapolator.history) == extrapolator.order + 1:
+            t = extrapolator.path + np.linalg.norm(system.positions - extrapolator.previous)
+            estimate = extrapolator._predict(t)[2]
+        evaluations = extrapolator.stats.evaluations
+        _, forces = extrapolator(system)
+        evaluated = extrapolator.stats.evaluations > evaluations
+
+        if estimate is not None:
+            failed |= evaluated != (estimate > force_tol)
+            forced += evaluated
+        if not evaluated:
+            _, expected = full_energy_forces(session, numbers, system.positions, cell, pbc)
+            error = np.linalg.norm(forces - expected, axis=1).max()
+            worst = max(worst, error / estimate)
+            failed |= error > estimate
+
+    stats = extrapolator.stats
+    print(f"ForceExtrapolator: {len(numbers)} atoms, {n_steps} steps, {stats.skipped} extrapolated, "
+          f"{forced} evaluations past the tolerance, max error / estimate {worst:.2f}")
+    return failed or stats.skipped == 0 or forced == 0
+
+
+def check_pair_potential(session, rng, h=1e-5):
+    """Fitted pair potential forces against central differences of its
+    energy, and the native kernel against the numpy fallback when the
+    library's _mace_native module is loaded"""
+    numbers, positions, cell, pbc = random_structure(rng, "periodic", 10.0)
+    system = mc.ResidentSystem(session, numbers, positions, cell, pbc)
+    pair = mc.PairPotential(numbers, r_cut=R_MAX).fit(system)
+    energy, forces = pair.compute(system, R_MAX)
+
+    error = 0.0
+    for i in range(len(numbers)):
+        for a in range(3):
+            displaced = positions.copy()
+            displaced[i, a] += h
+            system.update(displaced)
+            plus, _ = pair.compute(system, R_MAX)
+            displaced[i, a] -= 2 * h
+            system.update(displaced)
+            minus, _ = pair.compute(system, R_MAX)
+            error = max(error, abs(forces[i, a] + (plus - minus) / (2 * h)))
+    system.update(positions)
+    print(f"PairPotential: {len(numbers)} atoms, E {energy:.4f} eV, "
+          f"max |F + dE/dx| {error:.2e} eV/A")
+    failed = error > 1e-7 or np.abs(forces).max() == 0.0
+
+    native = mc._mace_native
+    if native is None:
+        print("PairPotential: _mace_native not loaded, native kernel checked by `make test`")
+        return failed
+    mc._mace_native = None
+    try:
+        expected_energy, expected_forces = pair.compute(system, R_MAX)
+    finally:
+        mc._mace_native = native
+    error = max(abs(energy - expected_energy), np.abs(forces - expected_forces).max())
+    print(f"PairPotential: native kernel against numpy, max error {error:.2e}")
+    return failed or error > 1e-10
+
+
+def check_respa(session, rng, n_steps=20, timestep=0.5):
+    """NVE RESPA with one inner step against velocity Verlet: the inner
+    force cancels and both integrate the model forces"""
+    numbers, positions, cell, pbc = random_structure(rng, "isolated", 7.0)
+    velocities = rng.normal(0.0, 0.005, positions.shape)
+    respa = session.run_respa(numbers, positions, velocities, cell, pbc, n_steps,
+                              timestep=timestep, respa_steps=1)
+    verlet = session.run_md(numbers, positions, velocities, cell, pbc, n_steps, timestep=timestep)
+    error = max(np.abs(respa["positions"] - verlet["positions"]).max(),
+                np.abs(respa["velocities"] - verlet["velocities"]).max())
+    moved = np.abs(respa["positions"] - positions).max()
+    print(f"RESPA (1 inner step): {len(numbers)} atoms, {n_steps} steps, max displacement "
+          f"{moved:.2e} A, max difference from Verlet {error:.2e}")
+    return error > 1e-9 or moved < 1e-3
+
+
+def main():
+    session = toy_session()
+    rng = np.random.default_rng(0)
+
+    failed = False
+    for kind in ("periodic", "slab", "isolated"):
+        failed |= check_mc_state(session, rng, kind)
+    for kind in ("periodic", "slab", "isolated"):
+        failed |= check_frozen_region(session, rng, kind)
+    for kind in ("periodic", "slab", "isolated"):
+        failed |= check_chunked(session, rng, kind)
+    for kind in ("periodic", "slab", "isolated"):
+        failed |= check_subset_forces(session, rng, kind)
+    for kind in ("periodic", "isolated"):
+        failed |= check_atomic(session, rng, kind)
+    failed |= check_hessian(session, rng)
+    for kind in ("fcc", "tetragonal", "rocksalt"):
+        failed |= check_force_constants(session, kind)
+    failed |= check_bfloat16(rng)
+    failed |= check_float32(rng)
+    failed |= check_relax(session, rng)
+    # The error estimate is a heuristic that fails near force inflections:
+    # one fixed trajectory, independent of the checks before it
+    failed |= check_force_extrapolator(session, np.random.default_rng(1))
+    failed |= check_pair_potential(session, rng)
+    failed |= check_respa(session, rng)
+
+    print("FAILED" if failed else "All checks passed")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()